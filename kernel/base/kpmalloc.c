@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/* 
+ * Copyright (C) 2023 bmax121. All Rights Reserved.
+ */
+
+#include <kpmalloc.h>
+#include <symbol.h>
+#include <common.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// TLSF has no locking, and this can't use kernel locks because it is used before kernel symbols are resolved.
+typedef struct
+{
+    volatile uint32_t lock;
+} kp_mem_lock_t;
+
+#ifdef KP_HOST
+// host build for host/kpmstress.c: a thread stands in for a cpu and there are no irqs to mask
+static inline uint64_t kp_mem_lock(kp_mem_lock_t *lock)
+{
+    while (__atomic_exchange_n(&lock->lock, 1, __ATOMIC_ACQUIRE))
+        ;
+    return 0;
+}
+
+static inline void kp_mem_unlock(kp_mem_lock_t *lock, uint64_t flags)
+{
+    __atomic_store_n(&lock->lock, 0, __ATOMIC_RELEASE);
+}
+#else
+static inline uint64_t kp_mem_lock(kp_mem_lock_t *lock)
+{
+    uint64_t flags;
+    uint32_t val, tmp;
+    asm volatile("mrs %0, daif\n"
+                 "msr daifset, #3"
+                 : "=r"(flags)
+                 :
+                 : "memory");
+    asm volatile("sevl\n"
+                 "1: wfe\n"
+                 "2: ldaxr %w0, %2\n"
+                 "cbnz %w0, 1b\n"
+                 "stxr %w1, %w3, %2\n"
+                 "cbnz %w1, 2b"
+                 : "=&r"(val), "=&r"(tmp), "+Q"(lock->lock)
+                 : "r"(1)
+                 : "memory");
+    return flags;
+}
+
+static inline void kp_mem_unlock(kp_mem_lock_t *lock, uint64_t flags)
+{
+    asm volatile("stlr wzr, %0" : "=Q"(lock->lock) : : "memory");
+    asm volatile("msr daif, %0" : : "r"(flags) : "memory");
+}
+#endif
+
+static kp_mem_lock_t kp_rw_lock = { 0 };
+static kp_mem_lock_t kp_rox_lock = { 0 };
+
+// per-cpu magazines
+#define KP_MALLOC_CPUS 16
+#define KP_MALLOC_CLASSES 5
+#define KP_MALLOC_CLASS_MIN_SHIFT 4 // 16, 32, ... 256
+#define KP_MALLOC_CLASS_MAX (1 << (KP_MALLOC_CLASS_MIN_SHIFT + KP_MALLOC_CLASSES - 1))
+#define KP_MALLOC_MAG_SIZE 16
+#define KP_MALLOC_MAG_BATCH (KP_MALLOC_MAG_SIZE / 2)
+
+typedef struct
+{
+    kp_mem_lock_t lock;
+    uint32_t count[KP_MALLOC_CLASSES];
+    void *objs[KP_MALLOC_CLASSES][KP_MALLOC_MAG_SIZE];
+} __attribute__((aligned(64))) kp_magazine_t;
+
+static kp_magazine_t kp_magazines[KP_MALLOC_CPUS];
+
+static inline kp_magazine_t *this_magazine()
+{
+    return &kp_magazines[kp_cpu_slot(KP_MALLOC_CPUS)];
+}
+
+static inline int size_class(size_t bytes)
+{
+    if (bytes > KP_MALLOC_CLASS_MAX) return -1;
+    int cls = 0;
+    while (((size_t)1 << (KP_MALLOC_CLASS_MIN_SHIFT + cls)) < bytes)
+        cls++;
+    return cls;
+}
+
+// largest class the block can serve
+static inline int block_class(size_t block_size)
+{
+    if (block_size < (1 << KP_MALLOC_CLASS_MIN_SHIFT) || block_size >= 2 * KP_MALLOC_CLASS_MAX) return -1;
+    int cls = KP_MALLOC_CLASSES - 1;
+    while (((size_t)1 << (KP_MALLOC_CLASS_MIN_SHIFT + cls)) > block_size)
+        cls--;
+    return cls;
+}
+
+void *kp_malloc(size_t bytes)
+{
+    int cls = size_class(bytes);
+    if (cls < 0) {
+        uint64_t flags = kp_mem_lock(&kp_rw_lock);
+        void *ptr = tlsf_malloc(kp_rw_mem, bytes);
+        kp_mem_unlock(&kp_rw_lock, flags);
+        return ptr;
+    }
+
+    kp_magazine_t *mag = this_magazine();
+    uint64_t flags = kp_mem_lock(&mag->lock);
+    if (!mag->count[cls]) {
+        // refill a batch under one pool lock, keep the magazine lock so the slot can't change under us
+        size_t size = (size_t)1 << (KP_MALLOC_CLASS_MIN_SHIFT + cls);
+        uint64_t pflags = kp_mem_lock(&kp_rw_lock);
+        for (int i = 0; i < KP_MALLOC_MAG_BATCH; i++) {
+            void *obj = tlsf_malloc(kp_rw_mem, size);
+            if (!obj) break;
+            mag->objs[cls][mag->count[cls]++] = obj;
+        }
+        kp_mem_unlock(&kp_rw_lock, pflags);
+    }
+    void *ptr = mag->count[cls] ? mag->objs[cls][--mag->count[cls]] : 0;
+    kp_mem_unlock(&mag->lock, flags);
+    return ptr;
+}
+KP_EXPORT_SYMBOL(kp_malloc);
+
+void kp_free(void *ptr)
+{
+    if (!ptr) return;
+    int cls = block_class(tlsf_block_size(ptr));
+    if (cls < 0) {
+        uint64_t flags = kp_mem_lock(&kp_rw_lock);
+        tlsf_free(kp_rw_mem, ptr);
+        kp_mem_unlock(&kp_rw_lock, flags);
+        return;
+    }
+
+    kp_magazine_t *mag = this_magazine();
+    uint64_t flags = kp_mem_lock(&mag->lock);
+    if (mag->count[cls] == KP_MALLOC_MAG_SIZE) {
+        uint64_t pflags = kp_mem_lock(&kp_rw_lock);
+        for (int i = 0; i < KP_MALLOC_MAG_BATCH; i++) {
+            tlsf_free(kp_rw_mem, mag->objs[cls][--mag->count[cls]]);
+        }
+        kp_mem_unlock(&kp_rw_lock, pflags);
+    }
+    mag->objs[cls][mag->count[cls]++] = ptr;
+    kp_mem_unlock(&mag->lock, flags);
+}
+KP_EXPORT_SYMBOL(kp_free);
+
+void *kp_memalign(size_t align, size_t bytes)
+{
+    uint64_t flags = kp_mem_lock(&kp_rw_lock);
+    void *ptr = tlsf_memalign(kp_rw_mem, align, bytes);
+    kp_mem_unlock(&kp_rw_lock, flags);
+    return ptr;
+}
+KP_EXPORT_SYMBOL(kp_memalign);
+
+void *kp_realloc(void *ptr, size_t size)
+{
+    uint64_t flags = kp_mem_lock(&kp_rw_lock);
+    void *p = tlsf_realloc(kp_rw_mem, ptr, size);
+    kp_mem_unlock(&kp_rw_lock, flags);
+    return p;
+}
+KP_EXPORT_SYMBOL(kp_realloc);
+
+void *kp_malloc_exec(size_t bytes)
+{
+    uint64_t flags = kp_mem_lock(&kp_rox_lock);
+    void *ptr = tlsf_malloc(kp_rox_mem, bytes);
+    kp_mem_unlock(&kp_rox_lock, flags);
+    return ptr;
+}
+KP_EXPORT_SYMBOL(kp_malloc_exec);
+
+void *kp_memalign_exec(size_t align, size_t bytes)
+{
+    uint64_t flags = kp_mem_lock(&kp_rox_lock);
+    void *ptr = tlsf_memalign(kp_rox_mem, align, bytes);
+    kp_mem_unlock(&kp_rox_lock, flags);
+    return ptr;
+}
+KP_EXPORT_SYMBOL(kp_memalign_exec);
+
+void *kp_realloc_exec(void *ptr, size_t size)
+{
+    uint64_t flags = kp_mem_lock(&kp_rox_lock);
+    void *p = tlsf_realloc(kp_rox_mem, ptr, size);
+    kp_mem_unlock(&kp_rox_lock, flags);
+    return p;
+}
+KP_EXPORT_SYMBOL(kp_realloc_exec);
+
+void kp_free_exec(void *ptr)
+{
+    uint64_t flags = kp_mem_lock(&kp_rox_lock);
+    tlsf_free(kp_rox_mem, ptr);
+    kp_mem_unlock(&kp_rox_lock, flags);
+}
+KP_EXPORT_SYMBOL(kp_free_exec);
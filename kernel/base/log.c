@@ -1,12 +1,497 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later */
-/* 
+/*
  * Copyright (C) 2023 bmax121. All Rights Reserved.
  */
 
-#include <stdint.h>
+#include <log.h>
+#include <common.h>
+#include <ktypes.h>
+#include <compiler.h>
+#include <barrier.h>
+#include <symbol.h>
+#include <baselib.h>
+#include <stdarg.h>
+#include <uapi/scdefs.h>
 
-#define BOOT_LOG_SIZE 1024
+extern int (*vsnprintf)(char *buf, size_t size, const char *fmt, va_list args);
 
+#define KP_LOG_RING_RECS 256
+#define KP_LOG_BOOT_RECS 192
+#define KP_LOG_TEXT_LEN (KP_LOG_MAX_ARGS * sizeof(uint64_t))
+
+// console budget, lines per second, boot records are not limited
+#define KP_LOG_BURST 64
+
+#define KP_LOG_F_TEXT 1 // formatted text, the head of KP_LOG_CHUNKS(flags) slots
+#define KP_LOG_F_CONT 2 // text continuation or dropped record, never read on its own
+#define KP_LOG_CHUNKS_SHIFT 8
+#define KP_LOG_CHUNKS(flags) ((flags) >> KP_LOG_CHUNKS_SHIFT)
+#define KP_LOG_MAX_CHUNKS ((LOG_LINE_MAX + KP_LOG_TEXT_LEN - 1) / KP_LOG_TEXT_LEN)
+#define KP_LOG_TEXT_MAX (KP_LOG_MAX_CHUNKS * KP_LOG_TEXT_LEN)
+
+// seq of a slot while its writer fills it
+#define KP_LOG_BUSY (1ull << 63)
+
+typedef struct
+{
+    uint64_t seq; // KP_LOG_BUSY set while being written
+    uint64_t time;
+    const char *fmt;
+    uint32_t level;
+    uint32_t flags;
+    union
+    {
+        uint64_t args[KP_LOG_MAX_ARGS];
+        char text[KP_LOG_TEXT_LEN];
+    };
+} __attribute__((aligned(128))) kp_log_rec_t;
+
+static kp_log_rec_t ring[KP_LOG_RING_RECS];
+static uint64_t ring_head = 0;
+
+static kp_log_rec_t boot_recs[KP_LOG_BOOT_RECS];
+static int boot_recs_num = 0;
+
+#define BOOT_LOG_SIZE 0x2000
 static char boot_log[BOOT_LOG_SIZE] = { 0 };
-static int boot_log_len = 0;
-static int boot_log_fin = 0;
+static char boot_line[LOG_LINE_MAX];
+
+_Static_assert(sizeof(struct kp_log_entry) + KP_LOG_TEXT_MAX <= KP_LOG_ENTRY_MAX, "KP_LOG_ENTRY_MAX too small");
+
+/*
+ * Lines that must be formatted before they are stored, kept off the stack of whoever logs.
+ * Taken with irqs masked, from the cpu's own slot on, so only a cpu sharing the slot or a nested debug exception
+ * moves on to another one.
+ */
+#define KP_LOG_SCRATCH 16
+
+typedef struct
+{
+    uint64_t busy;
+    char line[LOG_LINE_MAX];
+} __attribute__((aligned(64))) kp_log_scratch_t;
+
+static kp_log_scratch_t scratch[KP_LOG_SCRATCH];
+
+static int ring_level = KP_LOG_V;
+#ifdef DEBUG
+static int console_level = KP_LOG_V;
+#else
+static int console_level = KP_LOG_I;
+#endif
+
+static uint64_t rate_window = 0;
+static uint32_t rate_printed = 0;
+static uint32_t rate_missed = 0;
+
+static inline uint64_t log_ticks()
+{
+    uint64_t cnt;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(cnt));
+    return cnt;
+}
+
+static inline uint64_t log_freq()
+{
+    uint64_t frq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frq));
+    return frq;
+}
+
+static inline uint64_t fetch_add(uint64_t *p, uint64_t n)
+{
+    uint64_t old, new;
+    uint32_t tmp;
+    asm volatile("1: ldxr %0, %3\n"
+                 "add %1, %0, %4\n"
+                 "stxr %w2, %1, %3\n"
+                 "cbnz %w2, 1b"
+                 : "=&r"(old), "=&r"(new), "=&r"(tmp), "+Q"(*p)
+                 : "r"(n));
+    return old;
+}
+
+static inline bool cas(uint64_t *p, uint64_t old, uint64_t new)
+{
+    uint64_t cur;
+    uint32_t tmp;
+    asm volatile("1: ldaxr %0, %2\n"
+                 "cmp %0, %3\n"
+                 "b.ne 2f\n"
+                 "stlxr %w1, %4, %2\n"
+                 "cbnz %w1, 1b\n"
+                 "2:"
+                 : "=&r"(cur), "=&r"(tmp), "+Q"(*p)
+                 : "r"(old), "r"(new)
+                 : "cc", "memory");
+    return cur == old;
+}
+
+static inline uint64_t irq_save()
+{
+    uint64_t flags;
+    asm volatile("mrs %0, daif\n"
+                 "msr daifset, #3"
+                 : "=r"(flags)
+                 :
+                 : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint64_t flags)
+{
+    asm volatile("msr daif, %0" : : "r"(flags) : "memory");
+}
+
+// irqs must be masked, NULL if every line is taken
+static kp_log_scratch_t *get_scratch()
+{
+    int slot = kp_cpu_slot(KP_LOG_SCRATCH);
+    for (int i = 0; i < KP_LOG_SCRATCH; i++) {
+        kp_log_scratch_t *s = &scratch[(slot + i) & (KP_LOG_SCRATCH - 1)];
+        if (!*(volatile uint64_t *)&s->busy && cas(&s->busy, 0, 1)) return s;
+    }
+    return NULL;
+}
+
+static inline void put_scratch(kp_log_scratch_t *s)
+{
+    smp_store_release(&s->busy, 0);
+}
+
+static int render(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    int ret = vsnprintf(buf, size, fmt, va);
+    va_end(va);
+    return ret;
+}
+
+static inline bool is_fmt_modifier(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == ' ' || c == '#' || c == '.' || c == '*' ||
+           c == 'l' || c == 'h' || c == 'z' || c == 't' || c == 'j';
+}
+
+/*
+ * Deferring a record is only safe if the format and every %s argument outlive it.
+ * Our own strings live in the text area, anything else (stack buffers, module strings) is formatted now.
+ */
+static bool can_defer(const char *fmt, int nargs, const uint64_t *args)
+{
+    if (!is_kp_text_area((unsigned long)fmt)) return false;
+    int idx = 0;
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') continue;
+        if (*++p == '%') continue;
+        for (; is_fmt_modifier(*p); p++) {
+            if (*p == '*') idx++;
+        }
+        if (!*p) break;
+        if (*p == 's' && idx < nargs && !is_kp_text_area(args[idx])) return false;
+        idx++;
+    }
+    return true;
+}
+
+typedef kp_log_rec_t *(*rec_slot_f)(uint64_t seq);
+
+static kp_log_rec_t *ring_slot(uint64_t seq)
+{
+    return &ring[seq & (KP_LOG_RING_RECS - 1)];
+}
+
+static kp_log_rec_t *boot_slot(uint64_t seq)
+{
+    return &boot_recs[seq - 1];
+}
+
+/*
+ * A slot goes to the newest seq that wants it. A writer finding an older one still busy takes over its mark
+ * and gives up, the older writer then publishes the newer seq as a dropped record, see commit_rec().
+ * So a writer preempted for a whole lap never publishes its record over a newer one.
+ */
+static bool claim_rec(kp_log_rec_t *rec, uint64_t seq)
+{
+    for (;;) {
+        uint64_t old = *(volatile uint64_t *)&rec->seq;
+        if ((old & ~KP_LOG_BUSY) >= seq) return false;
+        if (cas(&rec->seq, old, seq | KP_LOG_BUSY)) {
+            smp_wmb();
+            return !(old & KP_LOG_BUSY);
+        }
+    }
+}
+
+static void commit_rec(kp_log_rec_t *rec, uint64_t seq)
+{
+    if (cas(&rec->seq, seq | KP_LOG_BUSY, seq)) return;
+    rec->flags = KP_LOG_F_CONT;
+    for (;;) {
+        uint64_t cur = *(volatile uint64_t *)&rec->seq;
+        if (cas(&rec->seq, cur, cur & ~KP_LOG_BUSY)) return;
+    }
+}
+
+static inline int text_chunks(int len)
+{
+    int n = (len + KP_LOG_TEXT_LEN - 1) / KP_LOG_TEXT_LEN;
+    return n > KP_LOG_MAX_CHUNKS ? KP_LOG_MAX_CHUNKS : n;
+}
+
+/*
+ * Store a deferred record at seq, or len bytes of text, nul included, over text_chunks(len) slots from seq on.
+ * If any slot can't be claimed, the ones that were are published as dropped.
+ */
+static void put_rec(rec_slot_f slot, uint64_t seq, int level, const char *fmt, int nargs, const uint64_t *args,
+                    const char *text, int len)
+{
+    int n = text ? text_chunks(len) : 1;
+    uint32_t claimed = 0;
+    for (int k = 0; k < n; k++) {
+        if (claim_rec(slot(seq + k), seq + k)) claimed |= 1u << k;
+    }
+    bool whole = claimed == (1u << n) - 1;
+
+    uint64_t time = log_ticks();
+    for (int k = 0; k < n; k++) {
+        if (!(claimed & (1u << k))) continue;
+        kp_log_rec_t *rec = slot(seq + k);
+        rec->time = time;
+        rec->level = level;
+        rec->fmt = fmt;
+        if (!whole) {
+            rec->flags = KP_LOG_F_CONT;
+        } else if (!text) {
+            rec->flags = 0;
+            for (int i = 0; i < KP_LOG_MAX_ARGS; i++)
+                rec->args[i] = i < nargs ? args[i] : 0;
+        } else {
+            int off = k * KP_LOG_TEXT_LEN;
+            int cplen = len - off < KP_LOG_TEXT_LEN ? len - off : KP_LOG_TEXT_LEN;
+            rec->flags = k ? KP_LOG_F_CONT : KP_LOG_F_TEXT | (n << KP_LOG_CHUNKS_SHIFT);
+            lib_memcpy(rec->text, text + off, cplen);
+            lib_memset(rec->text + cplen, 0, KP_LOG_TEXT_LEN - cplen);
+        }
+        commit_rec(rec, seq + k);
+    }
+}
+
+enum
+{
+    REC_OK,
+    REC_WAIT, // not committed yet
+    REC_SKIP, // overwritten, dropped or not a record head
+    REC_NOROOM, // text longer than the buffer
+};
+
+static int check_seq(kp_log_rec_t *rec, uint64_t seq)
+{
+    uint64_t s1 = smp_load_acquire(&rec->seq);
+    if ((s1 & ~KP_LOG_BUSY) < seq || s1 == (seq | KP_LOG_BUSY)) return REC_WAIT;
+    return s1 == seq ? REC_OK : REC_SKIP;
+}
+
+/*
+ * Copy the record at seq to rec and its text, gathered from all its slots, to text of size bytes.
+ * *used is the number of slots it takes.
+ */
+static int read_rec(rec_slot_f slot, uint64_t seq, kp_log_rec_t *rec, char *text, int size, int *used)
+{
+    *used = 1;
+    kp_log_rec_t *r = slot(seq);
+    int rc = check_seq(r, seq);
+    if (rc != REC_OK) return rc;
+    lib_memcpy(rec, r, sizeof(*rec));
+    smp_rmb();
+    if (*(volatile uint64_t *)&r->seq != seq) return REC_SKIP;
+    if (rec->flags & KP_LOG_F_CONT) return REC_SKIP;
+    if (!(rec->flags & KP_LOG_F_TEXT)) return REC_OK;
+
+    int n = KP_LOG_CHUNKS(rec->flags);
+    if (n * KP_LOG_TEXT_LEN > size) return REC_NOROOM;
+    lib_memcpy(text, rec->text, KP_LOG_TEXT_LEN);
+    for (int k = 1; k < n; k++) {
+        r = slot(seq + k);
+        rc = check_seq(r, seq + k);
+        if (rc != REC_OK) return rc;
+        lib_memcpy(text + k * KP_LOG_TEXT_LEN, r->text, KP_LOG_TEXT_LEN);
+        smp_rmb();
+        if (*(volatile uint64_t *)&r->seq != seq + k) return REC_SKIP;
+    }
+    text[n * KP_LOG_TEXT_LEN - 1] = '\0';
+    *used = n;
+    return REC_OK;
+}
+
+static int render_rec(const kp_log_rec_t *rec, const char *text, char *buf, size_t size)
+{
+    if (rec->flags & KP_LOG_F_TEXT) return render(buf, size, "%s", text);
+    const uint64_t *a = rec->args;
+    return render(buf, size, rec->fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+}
+
+/*
+ * The window state is updated without a lock, racing cpus can print a few lines over budget.
+ */
+static bool console_allow()
+{
+    uint64_t now = log_ticks();
+    uint64_t frq = log_freq();
+    if (now - rate_window >= frq) {
+        uint32_t missed = rate_missed;
+        rate_window = now;
+        rate_printed = 0;
+        rate_missed = 0;
+        if (missed) printk("[-] KP W %d log lines suppressed\n", missed);
+    }
+    if (rate_printed >= KP_LOG_BURST) {
+        rate_missed++;
+        return false;
+    }
+    rate_printed++;
+    return true;
+}
+
+static void log_args(int nargs, va_list va, uint64_t *args)
+{
+    if (nargs > KP_LOG_MAX_ARGS) nargs = KP_LOG_MAX_ARGS;
+    for (int i = 0; i < KP_LOG_MAX_ARGS; i++)
+        args[i] = i < nargs ? va_arg(va, uint64_t) : 0;
+}
+
+void kp_log(int level, const char *fmt, int nargs, ...)
+{
+    bool to_ring = level >= ring_level;
+    bool to_console = level >= console_level;
+    if (!to_ring && !to_console) return;
+
+    uint64_t a[KP_LOG_MAX_ARGS];
+    va_list va;
+    va_start(va, nargs);
+    log_args(nargs, va, a);
+    va_end(va);
+
+    if (to_ring) {
+        if (can_defer(fmt, nargs, a)) {
+            uint64_t seq = fetch_add(&ring_head, 1) + 1;
+            put_rec(ring_slot, seq, level, fmt, nargs, a, NULL, 0);
+        } else {
+            uint64_t flags = irq_save();
+            kp_log_scratch_t *sc = get_scratch();
+            // all taken, nested too deep, keep what fits in one slot
+            char short_line[KP_LOG_TEXT_LEN];
+            char *line = sc ? sc->line : short_line;
+            int size = sc ? sizeof(sc->line) : sizeof(short_line);
+            int len = render(line, size, fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10],
+                             a[11]);
+            len = (len < 0 ? 0 : len >= size ? size - 1 : len) + 1;
+            uint64_t seq = fetch_add(&ring_head, text_chunks(len)) + 1;
+            put_rec(ring_slot, seq, level, fmt, nargs, a, line, len);
+            if (sc) put_scratch(sc);
+            irq_restore(flags);
+        }
+    }
+
+    if (to_console && console_allow()) {
+        printk(fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+    }
+}
+KP_EXPORT_SYMBOL(kp_log);
+
+void kp_log_set_level(int ring, int console)
+{
+    ring_level = ring;
+    console_level = console;
+}
+
+void kp_log_boot(const char *fmt, int nargs, ...)
+{
+    uint64_t a[KP_LOG_MAX_ARGS];
+    va_list va;
+    va_start(va, nargs);
+    log_args(nargs, va, a);
+    va_end(va);
+
+    int len = render(boot_line, sizeof(boot_line), fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+                     a[10], a[11]);
+    len = (len < 0 ? 0 : len >= sizeof(boot_line) ? sizeof(boot_line) - 1 : len) + 1;
+
+    // the text of deferred records is not kept
+    const char *text = can_defer(fmt, nargs, a) ? NULL : boot_line;
+    int n = text ? text_chunks(len) : 1;
+    if (boot_recs_num + n <= KP_LOG_BOOT_RECS) {
+        uint64_t idx = boot_recs_num + 1;
+        boot_recs_num += n;
+        put_rec(boot_slot, idx, KP_LOG_I, fmt, nargs, a, text, len);
+    }
+    uint64_t seq = fetch_add(&ring_head, n) + 1;
+    put_rec(ring_slot, seq, KP_LOG_I, fmt, nargs, a, text, len);
+
+    printk("KP %s", boot_line);
+}
+
+const char *get_boot_log()
+{
+    static char text[KP_LOG_TEXT_MAX];
+    kp_log_rec_t rec;
+    int off = 0, used;
+    boot_log[0] = '\0';
+    for (uint64_t seq = 1; seq <= boot_recs_num && off < sizeof(boot_log) - 1; seq += used) {
+        if (read_rec(boot_slot, seq, &rec, text, sizeof(text), &used) != REC_OK) continue;
+        int ret = render_rec(&rec, text, boot_log + off, sizeof(boot_log) - off);
+        if (ret < 0) continue;
+        if (ret >= sizeof(boot_log) - off) break;
+        off += ret;
+    }
+    return boot_log;
+}
+
+/*
+ * Records are rendered and gathered straight into buf, nothing but the record copy is on the stack.
+ * One that doesn't fit in what is left of buf ends the read, it is the first of the next one.
+ */
+int kp_log_read(uint64_t *seq, void *buf, int len)
+{
+    uint64_t head = smp_load_acquire(&ring_head);
+    uint64_t s = *seq ? *seq : 1;
+    if (head >= KP_LOG_RING_RECS && s <= head - KP_LOG_RING_RECS) s = head - KP_LOG_RING_RECS + 1;
+
+    uint64_t frq = log_freq();
+    int off = 0, used;
+    kp_log_rec_t rec;
+    for (; s <= head; s += used) {
+        struct kp_log_entry *entry = (struct kp_log_entry *)((char *)buf + off);
+        int room = len - off - (int)sizeof(*entry);
+        if (room <= 0) break;
+
+        int rc = read_rec(ring_slot, s, &rec, entry->text, room, &used);
+        if (rc == REC_WAIT || rc == REC_NOROOM) break;
+        if (rc == REC_SKIP) continue;
+
+        int tlen;
+        if (rec.flags & KP_LOG_F_TEXT) {
+            tlen = lib_strnlen(entry->text, room);
+        } else {
+            int max = room < LOG_LINE_MAX ? room : LOG_LINE_MAX;
+            tlen = render_rec(&rec, NULL, entry->text, max);
+            if (tlen < 0) tlen = 0;
+            if (tlen >= max) {
+                if (max < LOG_LINE_MAX) break;
+                tlen = max - 1;
+            }
+        }
+        int size = (sizeof(struct kp_log_entry) + tlen + 7) & ~7;
+        if (off + size > len) break;
+
+        entry->seq = s;
+        entry->time_ns = rec.time / frq * 1000000000ul + rec.time % frq * 1000000000ul / frq;
+        entry->level = rec.level;
+        entry->len = tlen;
+        lib_memset(entry->text + tlen, 0, size - sizeof(*entry) - tlen);
+        off += size;
+    }
+    *seq = s;
+    return off;
+}
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2024 bmax121. All Rights Reserved.
+ */
+
+#include <lz4.h>
+#include <baselib.h>
+
+static int lz4_length(const uint8_t **ip, const uint8_t *iend, int len)
+{
+    uint8_t b;
+    if (len != 15) return len;
+    do {
+        if (*ip >= iend) return -1;
+        b = *(*ip)++;
+        len += b;
+        if (len > (1 << 28)) return -1;
+    } while (b == 255);
+    return len;
+}
+
+int lz4_decompress(const void *src, int src_len, void *dst, int dst_len)
+{
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + src_len;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + dst_len;
+
+    while (ip < iend) {
+        int token = *ip++;
+
+        // literals
+        int len = lz4_length(&ip, iend, token >> 4);
+        if (len < 0 || len > iend - ip || len > oend - op) return -1;
+        lib_memcpy(op, ip, len);
+        ip += len;
+        op += len;
+        // the last sequence has no match
+        if (op == oend) break;
+
+        // match
+        if (iend - ip < 2) return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > op - (uint8_t *)dst) return -1;
+        len = lz4_length(&ip, iend, token & 15);
+        if (len < 0) return -1;
+        len += 4;
+        if (len > oend - op) return -1;
+        // may overlap the output, byte by byte
+        const uint8_t *match = op - offset;
+        while (len--) *op++ = *match++;
+    }
+    return op - (uint8_t *)dst;
+}
@@ -26,16 +26,52 @@ static const char bstr[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz
 static uint64_t _rand_next = 1000000007;
 static bool enable_root_key = false;
 
+// fingerprints of keys that failed the root key check
+#define AUTH_MISS_SLOTS 8
+
+static uint64_t auth_seed = 0;
+static uint64_t auth_miss[AUTH_MISS_SLOTS] = { 0 };
+static uint32_t auth_miss_next = 0;
+
+static uint64_t key_fingerprint(const char *key)
+{
+    uint64_t hash = auth_seed;
+    for (int i = 0; i < SUPER_KEY_LEN && key[i]; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash | 1;
+}
+
+static void clear_auth_miss()
+{
+    for (int i = 0; i < AUTH_MISS_SLOTS; i++) {
+        auth_miss[i] = 0;
+    }
+}
+
+/*
+ * The superkey is compared up to and including its terminator, every byte regardless of earlier mismatches.
+ * SHA-256 of the root key check only runs for keys not rejected before, callers retrying "su" or a wrong key
+ * hit the fingerprint slots instead. Once the root key passes it becomes the superkey and the check is off.
+ * The slot updates race, which can only cost an extra hash.
+ */
 int auth_superkey(const char *key)
 {
     int rc = 0;
-    for (int i = 0; superkey[i]; i++) {
+    int i = 0;
+    do {
         rc |= (superkey[i] ^ key[i]);
-    }
+    } while (superkey[i++]);
     if (!rc) goto out;
 
     if (!enable_root_key) goto out;
 
+    uint64_t fp = key_fingerprint(key);
+    for (int j = 0; j < AUTH_MISS_SLOTS; j++) {
+        if (auth_miss[j] == fp) goto out;
+    }
+
     BYTE hash[SHA256_BLOCK_SIZE];
     SHA256_CTX ctx;
     sha256_init(&ctx);
@@ -44,8 +80,13 @@ int auth_superkey(const char *key)
     int len = SHA256_BLOCK_SIZE > ROOT_SUPER_KEY_HASH_LEN ? ROOT_SUPER_KEY_HASH_LEN : SHA256_BLOCK_SIZE;
     rc = lib_memcmp(root_superkey, hash, len);
 
+    if (rc) {
+        auth_miss[auth_miss_next++ % AUTH_MISS_SLOTS] = fp;
+        goto out;
+    }
+
     static bool first_time = true;
-    if (!rc && first_time) {
+    if (first_time) {
         first_time = false;
         reset_superkey(key);
         enable_root_key = false;
@@ -58,11 +99,13 @@ out:
 void reset_superkey(const char *key)
 {
     lib_strlcpy(superkey, key, SUPER_KEY_LEN);
+    clear_auth_miss();
     dsb(ish);
 }
 
 void enable_auth_root_key(bool enable)
 {
+    clear_auth_miss();
     enable_root_key = enable;
 }
 
@@ -82,6 +125,26 @@ const char *get_build_time()
     return setup_header->compile_time;
 }
 
+static bool extra_item_valid(const patch_extra_item_t *item)
+{
+    uint64_t addr = (uint64_t)item;
+    if (addr < _kp_extra_start || addr + sizeof(*item) > _kp_extra_end) return false;
+    if (lib_strncmp(item->magic, EXTRA_HDR_MAGIC, sizeof(item->magic))) return false;
+    if (item->args_size < 0 || item->con_size < 0) return false;
+    return addr + sizeof(*item) + item->args_size + item->con_size <= _kp_extra_end;
+}
+
+static bool extra_item_verify(const patch_extra_item_t *item, const void *con)
+{
+    if (!(item->flags & EXTRA_FLAG_SHA256)) return true;
+    BYTE digest[SHA256_BLOCK_SIZE];
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, (const BYTE *)con, item->con_size);
+    sha256_final(&ctx, digest);
+    return !lib_memcmp(digest, item->digest, sizeof(digest));
+}
+
 int on_each_extra_item(int (*callback)(const patch_extra_item_t *extra, const char *arg, const void *con, void *udata),
                        void *udata)
 {
@@ -95,7 +158,7 @@ int on_each_extra_item(int (*callback)(const patch_extra_item_t *extra, const ch
         }
         const char *args = item->args_size > 0 ? (const char *)(item_addr + sizeof(patch_extra_item_t)) : 0;
         const void *con = (void *)(item_addr + sizeof(patch_extra_item_t) + item->args_size);
-        rc = callback(item, args, con, udata);
+        if (item->type != EXTRA_TYPE_INDEX) rc = callback(item, args, con, udata);
         if (rc) break;
         item_addr += sizeof(patch_extra_item_t);
         item_addr += item->args_size;
@@ -104,6 +167,71 @@ int on_each_extra_item(int (*callback)(const patch_extra_item_t *extra, const ch
     return rc;
 }
 
+struct extra_event_walk
+{
+    const char *event;
+    bool is_default;
+    int (*callback)(const patch_extra_item_t *extra, const char *arg, const void *con, void *udata);
+    void *udata;
+};
+
+static int extra_event_filter(const patch_extra_item_t *item, const char *args, const void *con, void *udata)
+{
+    struct extra_event_walk *walk = (struct extra_event_walk *)udata;
+    if (!extra_item_valid(item)) {
+        // sizes past a bad header can't be trusted, stop the walk
+        log_boot("extra: bad item at 0x%llx\n", (uint64_t)item - _kp_extra_start);
+        return -1;
+    }
+    if (item->event[0] ? lib_strncmp(item->event, walk->event, EXTRA_EVENT_LEN) : !walk->is_default) return 0;
+    if (!extra_item_verify(item, con)) {
+        log_boot("extra %s: digest mismatch\n", item->name);
+        return 0;
+    }
+    return walk->callback(item, args, con, walk->udata);
+}
+
+int on_each_extra_event(const char *event,
+                        int (*callback)(const patch_extra_item_t *extra, const char *arg, const void *con, void *udata),
+                        void *udata)
+{
+    const patch_extra_item_t *index = (const patch_extra_item_t *)_kp_extra_start;
+    bool is_default = !lib_strcmp(event, EXTRA_EVENT_KPM_DEFAULT);
+
+    // images patched by older tools have no index, walk all items
+    if (!extra_item_valid(index) || index->type != EXTRA_TYPE_INDEX) {
+        if (_kp_extra_start >= _kp_extra_end) return 0;
+        log_boot("extra: no index, scanning items for %s\n", event);
+        struct extra_event_walk walk = { event, is_default, callback, udata };
+        return on_each_extra_item(extra_event_filter, &walk);
+    }
+
+    const patch_extra_index_t *entries = (const patch_extra_index_t *)((uint64_t)(index + 1) + index->args_size);
+    int num = index->con_size / sizeof(patch_extra_index_t);
+
+    // only the index is touched for items of other events
+    for (int i = 0; i < num; i++) {
+        const patch_extra_index_t *entry = &entries[i];
+        if (entry->type == EXTRA_TYPE_NONE) break;
+        if (entry->event[0] ? lib_strncmp(entry->event, event, EXTRA_EVENT_LEN) : !is_default) continue;
+
+        const patch_extra_item_t *item = (const patch_extra_item_t *)(_kp_extra_start + entry->offset);
+        if (entry->offset < 0 || !extra_item_valid(item)) {
+            log_boot("extra index %d: bad offset 0x%x\n", i, entry->offset);
+            continue;
+        }
+        const char *args = item->args_size > 0 ? (const char *)(item + 1) : 0;
+        const void *con = (const char *)(item + 1) + item->args_size;
+        if (!extra_item_verify(item, con)) {
+            log_boot("extra %s: digest mismatch\n", item->name);
+            continue;
+        }
+        int rc = callback(item, args, con, udata);
+        if (rc) return rc;
+    }
+    return 0;
+}
+
 void predata_init()
 {
     superkey = (char *)start_preset.superkey;
@@ -121,6 +249,7 @@ void predata_init()
     if (*(uint64_t *)(root_superkey)) _rand_next *= *(uint64_t *)(root_superkey);
 
     enable_root_key = false;
+    auth_seed = rand_next();
 
     // random key
     if (lib_strnlen(superkey, SUPER_KEY_LEN) <= 0) {
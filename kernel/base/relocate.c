@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/* 
+ * Copyright (C) 2023 bmax121. All Rights Reserved.
+ */
+
+#include <hook.h>
+#include <compiler.h>
+#include <symbol.h>
+#include "relocate.h"
+
+// branch_from_to() at most
+#define JUMP_BACK_INST_NUM 4
+
+// static uint64_t sign_extend(uint64_t x, uint32_t len)
+// {
+//     char sign_bit = bit(x, len - 1);
+//     unsigned long sign_mask = 0 - sign_bit;
+//     x |= ((sign_mask >> len) << len);
+//     return x;
+// }
+
+static int is_in_tramp(hook_t *hook, uint64_t addr)
+{
+    uint64_t tramp_start = hook->origin_addr;
+    uint64_t tramp_end = tramp_start + hook->tramp_insts_num * 4;
+    if (addr >= tramp_start && addr < tramp_end) {
+        return 1;
+    }
+    return 0;
+}
+
+static uint64_t relo_in_tramp(hook_t *hook, uint64_t addr)
+{
+    uint64_t tramp_start = hook->origin_addr;
+    uint64_t tramp_end = tramp_start + hook->tramp_insts_num * 4;
+    if (!(addr >= tramp_start && addr < tramp_end)) return addr;
+    uint32_t addr_inst_index = (addr - tramp_start) / 4;
+    uint64_t fix_addr = hook->relo_addr;
+    for (int i = 0; i < addr_inst_index; i++) {
+        fix_addr += pcrel_relo_len[pcrel_class(hook->origin_insts[i])] * 4;
+    }
+    return fix_addr;
+}
+
+static __noinline hook_err_t relo_b(hook_t *hook, uint64_t inst_addr, uint32_t inst, int type)
+{
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+    uint64_t imm64;
+    if (type == PCREL_BC) {
+        uint64_t imm19 = bits32(inst, 23, 5);
+        imm64 = sign64_extend(imm19 << 2u, 21u);
+    } else {
+        uint64_t imm26 = bits32(inst, 25, 0);
+        imm64 = sign64_extend(imm26 << 2u, 28u);
+    }
+    uint64_t addr = inst_addr + imm64;
+    addr = relo_in_tramp(hook, addr);
+
+    uint32_t idx = 0;
+    if (type == PCREL_BC) {
+        buf[idx++] = (inst & 0xFF00001F) | 0x40u; // B.<cond> #8
+        buf[idx++] = 0x14000006; // B #24
+    }
+    buf[idx++] = 0x58000051; // LDR X17, #8
+    buf[idx++] = 0x14000003; // B #12
+    buf[idx++] = addr & 0xFFFFFFFF;
+    buf[idx++] = addr >> 32u;
+    if (type == PCREL_BL) {
+        buf[idx++] = 0x1000001E; // ADR X30, .
+        buf[idx++] = 0x910033DE; // ADD X30, X30, #12
+        buf[idx++] = 0xD65F0220; // RET X17
+    } else {
+        buf[idx++] = 0xD65F0220; // RET X17
+    }
+    buf[idx++] = ARM64_NOP;
+    return HOOK_NO_ERR;
+}
+
+static __noinline hook_err_t relo_adr(hook_t *hook, uint64_t inst_addr, uint32_t inst, int type)
+{
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+
+    uint32_t xd = bits32(inst, 4, 0);
+    uint64_t immlo = bits32(inst, 30, 29);
+    uint64_t immhi = bits32(inst, 23, 5);
+    uint64_t addr;
+
+    if (type == PCREL_ADR) {
+        addr = inst_addr + sign64_extend((immhi << 2u) | immlo, 21u);
+    } else {
+        addr = (inst_addr + sign64_extend((immhi << 14u) | (immlo << 12u), 33u)) & 0xFFFFFFFFFFFFF000;
+        if (is_in_tramp(hook, addr)) return -HOOK_BAD_RELO;
+    }
+    buf[0] = 0x58000040u | xd; // LDR Xd, #8
+    buf[1] = 0x14000003; // B #12
+    buf[2] = addr & 0xFFFFFFFF;
+    buf[3] = addr >> 32u;
+    return HOOK_NO_ERR;
+}
+
+static __noinline hook_err_t relo_ldr(hook_t *hook, uint64_t inst_addr, uint32_t inst, int type)
+{
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+
+    uint32_t rt = bits32(inst, 4, 0);
+    uint64_t imm19 = bits32(inst, 23, 5);
+    uint64_t offset = sign64_extend((imm19 << 2u), 21u);
+    uint64_t addr = inst_addr + offset;
+
+    if (is_in_tramp(hook, addr) && type != PCREL_PRFM) return -HOOK_BAD_RELO;
+
+    addr = relo_in_tramp(hook, addr);
+
+    if (type == PCREL_LDR_32 || type == PCREL_LDR_64 || type == PCREL_LDRSW) {
+        buf[0] = 0x58000080u | rt; // LDR Xt, #16
+        if (type == PCREL_LDR_32) {
+            buf[1] = 0xB9400000 | rt | (rt << 5u); // LDR Wt, [Xt]
+        } else if (type == PCREL_LDR_64) {
+            buf[1] = 0xF9400000 | rt | (rt << 5u); // LDR Xt, [Xt]
+        } else {
+            // LDRSW_LIT
+            buf[1] = 0xB9800000 | rt | (rt << 5u); // LDRSW Xt, [Xt]
+        }
+        buf[2] = 0x14000004; // B #16
+        buf[3] = ARM64_NOP;
+        buf[4] = addr & 0xFFFFFFFF;
+        buf[5] = addr >> 32u;
+    } else {
+        buf[0] = 0xA93F47F0; // STP X16, X17, [SP, -0x10]
+        buf[1] = 0x580000B1; // LDR X17, #20
+        if (type == PCREL_PRFM) {
+            buf[2] = 0xF9800220 | rt; // PRFM Rt, [X17]
+        } else if (type == PCREL_LDR_SIMD_32) {
+            buf[2] = 0xBD400220 | rt; // LDR St, [X17]
+        } else if (type == PCREL_LDR_SIMD_64) {
+            buf[2] = 0xFD400220 | rt; // LDR Dt, [X17]
+        } else {
+            // LDR_SIMD_128
+            buf[2] = 0x3DC00220u | rt; // LDR Qt, [X17]
+        }
+        buf[3] = 0xF85F83F1; // LDR X17, [SP, -0x8]
+        buf[4] = 0x14000004; // B #16
+        buf[5] = ARM64_NOP;
+        buf[6] = addr & 0xFFFFFFFF;
+        buf[7] = addr >> 32u;
+    }
+    return HOOK_NO_ERR;
+}
+
+static __noinline hook_err_t relo_cb(hook_t *hook, uint64_t inst_addr, uint32_t inst, int type)
+{
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+
+    uint64_t imm19 = bits32(inst, 23, 5);
+    uint64_t offset = sign64_extend((imm19 << 2u), 21u);
+    uint64_t addr = inst_addr + offset;
+    addr = relo_in_tramp(hook, addr);
+
+    buf[0] = (inst & 0xFF00001F) | 0x40u; // CB(N)Z Rt, #8
+    buf[1] = 0x14000005; // B #20
+    buf[2] = 0x58000051; // LDR X17, #8
+    buf[3] = 0xD65F0220; // RET X17
+    buf[4] = addr & 0xFFFFFFFF;
+    buf[5] = addr >> 32u;
+    return HOOK_NO_ERR;
+}
+
+static __noinline hook_err_t relo_tb(hook_t *hook, uint64_t inst_addr, uint32_t inst, int type)
+{
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+
+    uint64_t imm14 = bits32(inst, 18, 5);
+    uint64_t offset = sign64_extend((imm14 << 2u), 16u);
+    uint64_t addr = inst_addr + offset;
+    addr = relo_in_tramp(hook, addr);
+
+    buf[0] = (inst & 0xFFF8001F) | 0x40u; // TB(N)Z Rt, #<imm>, #8
+    buf[1] = 0x14000005; // B #20
+    buf[2] = 0x58000051; // LDR X17, #8
+    buf[3] = 0xd61f0220; // RET X17
+    buf[4] = addr & 0xFFFFFFFF;
+    buf[5] = addr >> 32u;
+    return HOOK_NO_ERR;
+}
+
+static __noinline hook_err_t relo_ignore(hook_t *hook, uint64_t inst_addr, uint32_t inst, int type)
+{
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+    buf[0] = inst;
+    buf[1] = ARM64_NOP;
+    return HOOK_NO_ERR;
+}
+
+static uint32_t can_b_rel(uint64_t src_addr, uint64_t dst_addr)
+{
+#define B_REL_RANGE ((1 << 25) << 2)
+    return ((dst_addr >= src_addr) & (dst_addr - src_addr <= B_REL_RANGE)) ||
+           ((src_addr >= dst_addr) & (src_addr - dst_addr <= B_REL_RANGE));
+}
+
+int32_t branch_relative(uint32_t *buf, uint64_t src_addr, uint64_t dst_addr)
+{
+    if (can_b_rel(src_addr, dst_addr)) {
+        buf[0] = 0x14000000u | (((dst_addr - src_addr) & 0x0FFFFFFFu) >> 2u); // B <label>
+        buf[1] = ARM64_NOP;
+        return 2;
+    }
+    return 0;
+}
+KP_EXPORT_SYMBOL(branch_relative);
+
+int32_t branch_absolute(uint32_t *buf, uint64_t addr)
+{
+    buf[0] = 0x58000051; // LDR X17, #8
+    buf[1] = 0xd61f0220; // BR X17
+    buf[2] = addr & 0xFFFFFFFF;
+    buf[3] = addr >> 32u;
+    return 4;
+}
+KP_EXPORT_SYMBOL(branch_absolute);
+
+int32_t ret_absolute(uint32_t *buf, uint64_t addr)
+{
+    buf[0] = 0x58000051; // LDR X17, #8
+    buf[1] = 0xD65F0220; // RET X17
+    buf[2] = addr & 0xFFFFFFFF;
+    buf[3] = addr >> 32u;
+    return 4;
+}
+KP_EXPORT_SYMBOL(ret_absolute);
+
+int32_t branch_from_to(uint32_t *tramp_buf, uint64_t src_addr, uint64_t dst_addr)
+{
+#if 0
+    uint32_t len = branch_relative(tramp_buf, src_addr, dst_addr);
+    if (len) return len;
+#else
+#if 0
+    return branch_absolute(tramp_buf, dst_addr);
+#else
+    return ret_absolute(tramp_buf, dst_addr);
+#endif
+#endif
+}
+
+static __noinline hook_err_t relocate_inst(hook_t *hook, uint64_t inst_addr, uint32_t inst)
+{
+    hook_err_t rc = HOOK_NO_ERR;
+    int it = pcrel_class(inst);
+    int len = pcrel_relo_len[it];
+
+    // a pac prologue and four long relocations don't fit with the jump back
+    if (hook->relo_insts_num + len + JUMP_BACK_INST_NUM > RELOCATE_INST_NUM) return -HOOK_BAD_RELO;
+
+    switch (it) {
+    case PCREL_B:
+    case PCREL_BC:
+    case PCREL_BL:
+        rc = relo_b(hook, inst_addr, inst, it);
+        break;
+    case PCREL_ADR:
+    case PCREL_ADRP:
+        rc = relo_adr(hook, inst_addr, inst, it);
+        break;
+    case PCREL_LDR_32:
+    case PCREL_LDR_64:
+    case PCREL_LDRSW:
+    case PCREL_PRFM:
+    case PCREL_LDR_SIMD_32:
+    case PCREL_LDR_SIMD_64:
+    case PCREL_LDR_SIMD_128:
+        rc = relo_ldr(hook, inst_addr, inst, it);
+        break;
+    case PCREL_CBZ:
+    case PCREL_CBNZ:
+        rc = relo_cb(hook, inst_addr, inst, it);
+        break;
+    case PCREL_TBZ:
+    case PCREL_TBNZ:
+        rc = relo_tb(hook, inst_addr, inst, it);
+        break;
+    case PCREL_NONE:
+    default:
+        rc = relo_ignore(hook, inst_addr, inst, it);
+        break;
+    }
+
+    hook->relo_insts_num += len;
+
+    return rc;
+}
+
+hook_err_t hook_relocate(hook_t *hook)
+{
+    // trampline to replace_addr
+    if (hook->origin_insts[0] == ARM64_PACIASP || hook->origin_insts[0] == ARM64_PACIBSP) {
+        hook->tramp_insts_num = branch_from_to(&hook->tramp_insts[1], hook->origin_addr, hook->replace_addr);
+        hook->tramp_insts[0] = ARM64_BTI_JC;
+        hook->tramp_insts_num++;
+    } else {
+        hook->tramp_insts_num = branch_from_to(hook->tramp_insts, hook->origin_addr, hook->replace_addr);
+    }
+
+    // relocate
+    hook->relo_insts_num = 0;
+    for (int i = 0; i < sizeof(hook->relo_insts) / sizeof(hook->relo_insts[0]); i++) {
+        hook->relo_insts[i] = ARM64_NOP;
+    }
+
+    for (int i = 0; i < hook->tramp_insts_num; i++) {
+        uint64_t inst_addr = hook->origin_addr + i * 4;
+        uint32_t inst = hook->origin_insts[i];
+        hook_err_t relo_res = relocate_inst(hook, inst_addr, inst);
+        if (relo_res) {
+            return -HOOK_BAD_RELO;
+        }
+    }
+
+    // jump back
+    uint64_t back_src_addr = hook->relo_addr + hook->relo_insts_num * 4;
+    uint64_t back_dst_addr = hook->origin_addr + hook->tramp_insts_num * 4;
+    uint32_t *buf = hook->relo_insts + hook->relo_insts_num;
+    hook->relo_insts_num += branch_from_to(buf, back_src_addr, back_dst_addr);
+    return HOOK_NO_ERR;
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/* 
+ * Copyright (C) 2023 bmax121. All Rights Reserved.
+ */
+
+#ifndef _KP_RELOCATE_H_
+#define _KP_RELOCATE_H_
+
+#include <stdint.h>
+#include <hook.h>
+#include <pcrel.h>
+
+#define bits32(n, high, low) ((uint32_t)((n) << (31u - (high))) >> (31u - (high) + (low)))
+#define bit(n, st) (((n) >> (st)) & 1)
+#define sign64_extend(n, len) \
+    (((uint64_t)((n) << (63u - (len - 1))) >> 63u) ? ((n) | (0xFFFFFFFFFFFFFFFF << (len))) : n)
+#define align_ceil(x, align) (((u64)(x) + (u64)(align) - 1) & ~((u64)(align) - 1))
+
+/**
+ * Build the trampoline and relocate the backed up hook->origin_insts.
+ * Only hook->origin_insts and the in addresses are read, no memory at those addresses is touched,
+ * so this also runs on the host against an emulated text buffer.
+ */
+hook_err_t hook_relocate(hook_t *hook);
+
+#endif
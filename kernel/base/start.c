@@ -98,10 +98,6 @@ uint64_t kernel_stext_va = 0;
 tlsf_t kp_rw_mem = 0;
 tlsf_t kp_rox_mem = 0;
 
-#define BOOT_LOG_SIZE 0x2000
-static char boot_log[BOOT_LOG_SIZE] = { 0 };
-static int boot_log_offset = 0;
-
 static inline bool hw_dirty()
 {
     uint64_t tcr_el1;
@@ -109,21 +105,6 @@ static inline bool hw_dirty()
     return tcr_el1 & 0x10000000000;
 }
 
-const char *get_boot_log()
-{
-    return boot_log;
-}
-
-void log_boot(const char *fmt, ...)
-{
-    va_list va;
-    va_start(va, fmt);
-    int ret = vsnprintf(boot_log + boot_log_offset, sizeof(boot_log) - boot_log_offset, fmt, va);
-    va_end(va);
-    printk("KP %s", boot_log + boot_log_offset);
-    boot_log_offset += ret;
-}
-
 uint64_t *pgtable_entry(uint64_t pgd, uint64_t va)
 {
     uint64_t pxd_bits = page_shift - 3;
@@ -6,6 +6,7 @@
 #include <symbol.h>
 #include <log.h>
 #include <stdint.h>
+#include <kpmalloc.h>
 
 #include "start.h"
 #include "setup.h"
@@ -15,6 +16,10 @@ extern void _kp_symbol_end();
 static uint64_t symbol_start = 0;
 static uint64_t symbol_end = 0;
 
+// open addressing over the exported symbols, slot holds symbol index + 1, 0 is empty
+static uint32_t *symbol_index = 0;
+static uint32_t symbol_index_mask = 0;
+
 // DJB2
 static unsigned long sym_hash(const char *str)
 {
@@ -42,6 +47,16 @@ int local_strcmp(const char *s1, const char *s2)
 unsigned long symbol_lookup_name(const char *name)
 {
     unsigned long hash = sym_hash(name);
+    kp_symbol_t *symbols = (kp_symbol_t *)symbol_start;
+    if (symbol_index) {
+        for (uint32_t i = hash & symbol_index_mask; symbol_index[i]; i = (i + 1) & symbol_index_mask) {
+            kp_symbol_t *symbol = symbols + symbol_index[i] - 1;
+            if (hash == symbol->hash && !local_strcmp(name, symbol->name)) {
+                return symbol->addr;
+            }
+        }
+        return 0;
+    }
     for (uint64_t addr = symbol_start; addr < symbol_end; addr += sizeof(kp_symbol_t)) {
         kp_symbol_t *symbol = (kp_symbol_t *)addr;
         if (hash == symbol->hash && !local_strcmp(name, symbol->name)) {
@@ -51,6 +66,32 @@ unsigned long symbol_lookup_name(const char *name)
     return 0;
 }
 
+static void symbol_index_init()
+{
+    uint32_t num = (symbol_end - symbol_start) / sizeof(kp_symbol_t);
+    uint32_t size = 16;
+    while (size < num * 2)
+        size <<= 1;
+
+    symbol_index = kp_malloc(size * sizeof(uint32_t));
+    if (!symbol_index) {
+        log_boot("Symbol index alloc failed, fall back to linear lookup\n");
+        return;
+    }
+    for (uint32_t i = 0; i < size; i++)
+        symbol_index[i] = 0;
+    symbol_index_mask = size - 1;
+
+    kp_symbol_t *symbols = (kp_symbol_t *)symbol_start;
+    for (uint32_t n = 0; n < num; n++) {
+        uint32_t i = symbols[n].hash & symbol_index_mask;
+        while (symbol_index[i])
+            i = (i + 1) & symbol_index_mask;
+        symbol_index[i] = n + 1;
+    }
+    log_boot("Symbol index: %d, %d\n", num, size);
+}
+
 void symbol_init()
 {
     symbol_start = (uint64_t)_kp_symbol_start;
@@ -61,4 +102,5 @@ void symbol_init()
         symbol->addr = symbol->addr - link_base_addr + runtime_base_addr;
         symbol->hash = sym_hash(symbol->name);
     }
+    symbol_index_init();
 }
\ No newline at end of file
@@ -0,0 +1,624 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Host build of base/relocate.c against an emulated text buffer.
+ *
+ * fuzz: random prologues are relocated and every original instruction is
+ * compared with its relocated sequence on a small A64 interpreter, which
+ * only knows the instructions the relocator reads and writes.
+ * bench: hook_relocate() throughput.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "relocate.h"
+
+#define TEXT_BASE 0xffffffc008000000ul
+#define RELO_BASE 0xffffffc0f0000000ul
+#define REPLACE_BASE 0xffffffc0f8000000ul
+#define MAX_STEPS 64
+#define STACK_SLOTS 4
+
+/*
+ * Reference decoder, the mask/value chain the relocator used before pcrel.h.
+ * The fuzzer decodes with it so it doesn't share a table with the code under test.
+ */
+#define INST_B 0x14000000
+#define INST_BC 0x54000000
+#define INST_BL 0x94000000
+#define INST_ADR 0x10000000
+#define INST_ADRP 0x90000000
+#define INST_LDR_32 0x18000000
+#define INST_LDR_64 0x58000000
+#define INST_LDRSW_LIT 0x98000000
+#define INST_PRFM_LIT 0xD8000000
+#define INST_LDR_SIMD_32 0x1C000000
+#define INST_LDR_SIMD_64 0x5C000000
+#define INST_LDR_SIMD_128 0x9C000000
+#define INST_CBZ 0x34000000
+#define INST_CBNZ 0x35000000
+#define INST_TBZ 0x36000000
+#define INST_TBNZ 0x37000000
+
+#define MASK_B 0xFC000000
+#define MASK_BC 0xFF000010
+#define MASK_BL 0xFC000000
+#define MASK_ADR 0x9F000000
+#define MASK_ADRP 0x9F000000
+#define MASK_LDR_32 0xFF000000
+#define MASK_LDR_64 0xFF000000
+#define MASK_LDRSW_LIT 0xFF000000
+#define MASK_PRFM_LIT 0xFF000000
+#define MASK_LDR_SIMD_32 0xFF000000
+#define MASK_LDR_SIMD_64 0xFF000000
+#define MASK_LDR_SIMD_128 0xFF000000
+#define MASK_CBZ 0x7F000000u
+#define MASK_CBNZ 0x7F000000u
+#define MASK_TBZ 0x7F000000u
+#define MASK_TBNZ 0x7F000000u
+
+typedef struct
+{
+    hook_t hook;
+    uint32_t canary[16];
+} hook_box_t;
+
+typedef struct
+{
+    uint64_t x[32]; // x[31] is sp, xzr is handled by reg()/set_reg()
+    uint64_t v[32][2];
+    uint64_t pc;
+    uint32_t nzcv;
+    // two slots below sp are all the relocator touches
+    uint64_t stack_addr[STACK_SLOTS];
+    uint64_t stack_val[STACK_SLOTS];
+    // opaque instructions in execution order
+    uint32_t trace[8];
+    int trace_num;
+} cpu_t;
+
+static const hook_t *cur;
+static uint64_t rng_state;
+
+static uint64_t rnd()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static inline uint32_t rnd_bits(int n)
+{
+    return n >= 32 ? (uint32_t)rnd() : (uint32_t)rnd() & ((1u << n) - 1);
+}
+
+// Index in the chain, -1 for none. Matches enum pcrel_class - 1
+static int classify(uint32_t inst)
+{
+    static const uint32_t m[] = { MASK_B,          MASK_BC,          MASK_BL,          MASK_ADR,
+                                     MASK_ADRP,       MASK_LDR_32,      MASK_LDR_64,      MASK_LDRSW_LIT,
+                                     MASK_PRFM_LIT,   MASK_LDR_SIMD_32, MASK_LDR_SIMD_64, MASK_LDR_SIMD_128,
+                                     MASK_CBZ,        MASK_CBNZ,        MASK_TBZ,         MASK_TBNZ };
+    static const uint32_t t[] = { INST_B,          INST_BC,          INST_BL,          INST_ADR,
+                                     INST_ADRP,       INST_LDR_32,      INST_LDR_64,      INST_LDRSW_LIT,
+                                     INST_PRFM_LIT,   INST_LDR_SIMD_32, INST_LDR_SIMD_64, INST_LDR_SIMD_128,
+                                     INST_CBZ,        INST_CBNZ,        INST_TBZ,         INST_TBNZ };
+    for (int i = 0; i < sizeof(m) / sizeof(m[0]); i++) {
+        if ((inst & m[i]) == t[i]) return i;
+    }
+    return -1;
+}
+
+// Data memory is a hash of the address, code reads come from the hook
+static uint32_t mem32(cpu_t *c, uint64_t addr)
+{
+    const hook_t *h = cur;
+    if (addr >= h->relo_addr && addr < h->relo_addr + RELOCATE_INST_NUM * 4 && !(addr & 3))
+        return h->relo_insts[(addr - h->relo_addr) / 4];
+    if (addr >= h->origin_addr && addr < h->origin_addr + TRAMPOLINE_MAX_NUM * 4 && !(addr & 3))
+        return h->origin_insts[(addr - h->origin_addr) / 4];
+    for (int i = 0; i < STACK_SLOTS; i++) {
+        if (c->stack_addr[i] == (addr & ~7ul)) return c->stack_val[i] >> ((addr & 4) * 8);
+    }
+    uint64_t z = addr * 0x9E3779B97F4A7C15ul;
+    return (uint32_t)(z >> 32) ^ (uint32_t)z;
+}
+
+static uint64_t mem64(cpu_t *c, uint64_t addr)
+{
+    return mem32(c, addr) | (uint64_t)mem32(c, addr + 4) << 32;
+}
+
+static void store64(cpu_t *c, uint64_t addr, uint64_t val)
+{
+    for (int i = 0; i < STACK_SLOTS; i++) {
+        if (!c->stack_addr[i] || c->stack_addr[i] == addr) {
+            c->stack_addr[i] = addr;
+            c->stack_val[i] = val;
+            return;
+        }
+    }
+}
+
+static inline uint64_t reg(cpu_t *c, int r)
+{
+    return r == 31 ? 0 : c->x[r];
+}
+
+static inline void set_reg(cpu_t *c, int r, uint64_t val)
+{
+    if (r != 31) c->x[r] = val;
+}
+
+static int cond_holds(cpu_t *c, int cond)
+{
+    int n = c->nzcv >> 3 & 1, z = c->nzcv >> 2 & 1, cf = c->nzcv >> 1 & 1, v = c->nzcv & 1;
+    int r;
+    switch (cond >> 1) {
+    case 0: r = z; break;
+    case 1: r = cf; break;
+    case 2: r = n; break;
+    case 3: r = v; break;
+    case 4: r = cf && !z; break;
+    case 5: r = n == v; break;
+    case 6: r = n == v && !z; break;
+    default: r = 1; break;
+    }
+    if ((cond & 1) && cond != 0xf) r = !r;
+    return r;
+}
+
+/*
+ * Execute one instruction at c->pc.
+ * Returns: 0, or -1 for an instruction the relocator never emits and reads as PC-relative.
+ */
+static int step(cpu_t *c)
+{
+    uint64_t pc = c->pc;
+    uint32_t inst = mem32(c, pc);
+    int rt = inst & 0x1f;
+    int rn = (inst >> 5) & 0x1f;
+    uint64_t next = pc + 4;
+
+    switch (classify(inst)) {
+    case 0: // B
+        next = pc + sign64_extend((uint64_t)bits32(inst, 25, 0) << 2u, 28u);
+        break;
+    case 1: // B.cond
+        if (cond_holds(c, inst & 0xf)) next = pc + sign64_extend((uint64_t)bits32(inst, 23, 5) << 2u, 21u);
+        break;
+    case 2: // BL
+        c->x[30] = pc + 4;
+        next = pc + sign64_extend((uint64_t)bits32(inst, 25, 0) << 2u, 28u);
+        break;
+    case 3: // ADR
+        set_reg(c, rt, pc + sign64_extend((uint64_t)(bits32(inst, 23, 5) << 2u | bits32(inst, 30, 29)), 21u));
+        break;
+    case 4: // ADRP
+        set_reg(c, rt,
+                (pc & ~0xffful) +
+                    sign64_extend((uint64_t)bits32(inst, 23, 5) << 14u | (uint64_t)bits32(inst, 30, 29) << 12u, 33u));
+        break;
+    case 5 ... 11: { // LDR (literal)
+        uint64_t addr = pc + sign64_extend((uint64_t)bits32(inst, 23, 5) << 2u, 21u);
+        uint32_t t = inst & 0xff000000;
+        if (t == INST_LDR_32) set_reg(c, rt, mem32(c, addr));
+        if (t == INST_LDR_64) set_reg(c, rt, mem64(c, addr));
+        if (t == INST_LDRSW_LIT) set_reg(c, rt, (int64_t)(int32_t)mem32(c, addr));
+        if (t == INST_LDR_SIMD_32) c->v[rt][0] = mem32(c, addr), c->v[rt][1] = 0;
+        if (t == INST_LDR_SIMD_64) c->v[rt][0] = mem64(c, addr), c->v[rt][1] = 0;
+        if (t == INST_LDR_SIMD_128) c->v[rt][0] = mem64(c, addr), c->v[rt][1] = mem64(c, addr + 8);
+        break;
+    }
+    case 12: // CBZ
+    case 13: { // CBNZ
+        uint64_t val = reg(c, rt);
+        if (!(inst >> 31)) val = (uint32_t)val;
+        if ((val == 0) == !(inst & 0x01000000))
+            next = pc + sign64_extend((uint64_t)bits32(inst, 23, 5) << 2u, 21u);
+        break;
+    }
+    case 14: // TBZ
+    case 15: { // TBNZ
+        int b = (inst >> 31) << 5 | bits32(inst, 23, 19);
+        if ((reg(c, rt) >> b & 1) == !!(inst & 0x01000000))
+            next = pc + sign64_extend((uint64_t)bits32(inst, 18, 5) << 2u, 16u);
+        break;
+    }
+    default:
+        if (inst == ARM64_NOP || inst == ARM64_BTI_C || inst == ARM64_BTI_J || inst == ARM64_BTI_JC) {
+        } else if ((inst & 0xfffffc1f) == 0xd65f0000 || (inst & 0xfffffc1f) == 0xd61f0000) {
+            // RET Xn, BR Xn
+            next = c->x[rn];
+        } else if ((inst & 0xffc00000) == 0x91000000 && rt == rn && rt == 30) {
+            // ADD X30, X30, #imm
+            c->x[30] += bits32(inst, 21, 10);
+        } else if (inst == 0xA93F47F0) {
+            // STP X16, X17, [SP, #-0x10]
+            store64(c, c->x[31] - 16, c->x[16]);
+            store64(c, c->x[31] - 8, c->x[17]);
+        } else if (inst == 0xF85F83F1) {
+            // LDUR X17, [SP, #-0x8]
+            c->x[17] = mem64(c, c->x[31] - 8);
+        } else if ((inst & 0xffc00000) == 0xB9400000 && bits32(inst, 21, 10) == 0) {
+            set_reg(c, rt, mem32(c, rn == 31 ? c->x[31] : c->x[rn]));
+        } else if ((inst & 0xffc00000) == 0xF9400000 && bits32(inst, 21, 10) == 0) {
+            set_reg(c, rt, mem64(c, rn == 31 ? c->x[31] : c->x[rn]));
+        } else if ((inst & 0xffc00000) == 0xB9800000 && bits32(inst, 21, 10) == 0) {
+            set_reg(c, rt, (int64_t)(int32_t)mem32(c, rn == 31 ? c->x[31] : c->x[rn]));
+        } else if ((inst & 0xffffffe0) == 0xBD400220) {
+            c->v[rt][0] = mem32(c, c->x[17]), c->v[rt][1] = 0;
+        } else if ((inst & 0xffffffe0) == 0xFD400220) {
+            c->v[rt][0] = mem64(c, c->x[17]), c->v[rt][1] = 0;
+        } else if ((inst & 0xffffffe0) == 0x3DC00220) {
+            c->v[rt][0] = mem64(c, c->x[17]), c->v[rt][1] = mem64(c, c->x[17] + 8);
+        } else if ((inst & 0xffffffe0) == 0xF9800220) {
+            // PRFM [X17], no architectural effect
+        } else if (c->trace_num < sizeof(c->trace) / sizeof(c->trace[0])) {
+            // anything else is taken verbatim from the origin, only its order matters
+            c->trace[c->trace_num++] = inst;
+        } else {
+            return -1;
+        }
+        break;
+    }
+    c->pc = next;
+    return 0;
+}
+
+static void random_cpu(cpu_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    for (int i = 0; i < 31; i++) {
+        // a zero half the time so CBZ takes both ways
+        c->x[i] = (rnd() & 1) ? 0 : rnd();
+    }
+    c->x[31] = 0xffffffc012340000ul + (rnd_bits(12) << 4);
+    for (int i = 0; i < 32; i++) c->v[i][0] = rnd(), c->v[i][1] = rnd();
+    c->nzcv = rnd_bits(4);
+}
+
+/*
+ * Map a relocated pc back to the origin address it stands for, pcs outside the
+ * relocated code are returned unchanged.
+ */
+static uint64_t canonical_pc(const hook_t *h, const int *starts, uint64_t pc)
+{
+    if (pc < h->relo_addr || pc >= h->relo_addr + RELOCATE_INST_NUM * 4) return pc;
+    int off = (pc - h->relo_addr) / 4;
+    // trailing NOPs of a chunk fall through to the next one
+    while (off < h->relo_insts_num && h->relo_insts[off] == ARM64_NOP) {
+        for (int i = 0; i <= h->tramp_insts_num; i++) {
+            if (starts[i] == off) return h->origin_addr + i * 4;
+        }
+        off++;
+    }
+    for (int i = 0; i <= h->tramp_insts_num; i++) {
+        if (starts[i] == off) return h->origin_addr + i * 4;
+    }
+    return pc | 1; // inside a chunk, never equal to an origin address
+}
+
+// Run until pc leaves [lo, hi) or comes back to lo, as a branch to itself does
+static int run_until_exit(cpu_t *c, uint64_t lo, uint64_t hi)
+{
+    for (int n = 0; n < MAX_STEPS; n++) {
+        if (c->pc < lo || c->pc >= hi || (n && c->pc == lo)) return 0;
+        if (step(c)) return -1;
+    }
+    return -1;
+}
+
+static int report(const hook_t *h, const char *what, int idx)
+{
+    printf("FAIL %s at inst %d\n  origin:", what, idx);
+    for (int i = 0; i < TRAMPOLINE_MAX_NUM; i++) printf(" %08x", h->origin_insts[i]);
+    printf("\n  relo:");
+    for (int i = 0; i < h->relo_insts_num; i++) printf("%s%08x", i % 8 ? " " : "\n    ", h->relo_insts[i]);
+    printf("\n");
+    return 1;
+}
+
+/*
+ * Property: executing relocated chunk idx from any start state ends at the
+ * same place with the same registers as executing origin instruction idx,
+ * x17 excepted, which the relocator may use as scratch.
+ */
+static int check_inst(const hook_t *h, const int *starts, int idx)
+{
+    cpu_t ref, rel;
+    random_cpu(&ref);
+    rel = ref;
+    uint64_t x17 = ref.x[17];
+
+    ref.pc = h->origin_addr + idx * 4;
+    if (step(&ref)) return 0;
+    rel.pc = h->relo_addr + starts[idx] * 4;
+    if (run_until_exit(&rel, rel.pc, h->relo_addr + starts[idx + 1] * 4))
+        return report(h, "relocated code runs away", idx);
+
+    if (canonical_pc(h, starts, rel.pc) != ref.pc) return report(h, "exit pc", idx);
+    for (int r = 0; r < 31; r++) {
+        if (r == 17 && ref.x[17] == x17) continue;
+        uint64_t a = ref.x[r], b = rel.x[r];
+        if (r == 30) a = canonical_pc(h, starts, a), b = canonical_pc(h, starts, b);
+        if (a != b) return report(h, "register", idx);
+    }
+    if (rel.x[31] != ref.x[31]) return report(h, "sp", idx);
+    if (memcmp(ref.v, rel.v, sizeof(ref.v))) return report(h, "simd register", idx);
+    if (ref.trace_num != rel.trace_num || memcmp(ref.trace, rel.trace, ref.trace_num * 4))
+        return report(h, "opaque instruction", idx);
+    return 0;
+}
+
+static int check_hook(hook_box_t *box)
+{
+    hook_t *h = &box->hook;
+    int starts[TRAMPOLINE_MAX_NUM + 1];
+
+    for (int i = 0; i < sizeof(box->canary) / sizeof(box->canary[0]); i++) {
+        if (box->canary[i] != 0xdeadbeef) return report(h, "relo_insts overflow", -1);
+    }
+    if (h->relo_insts_num > RELOCATE_INST_NUM) return report(h, "relo_insts_num", -1);
+
+    // chunk boundaries: each chunk ends with its NOP padding
+    starts[0] = 0;
+    for (int i = 0; i < h->tramp_insts_num; i++) {
+        int len;
+        switch (classify(h->origin_insts[i])) {
+        case 0: len = 6; break;
+        case 1: case 2: len = 8; break;
+        case 3: case 4: len = 4; break;
+        case 8 ... 11: len = 8; break;
+        case -1: len = 2; break;
+        default: len = 6; break;
+        }
+        starts[i + 1] = starts[i] + len;
+    }
+
+    // trampoline reaches replace_addr
+    cpu_t c;
+    random_cpu(&c);
+    uint32_t saved[TRAMPOLINE_MAX_NUM];
+    memcpy(saved, h->origin_insts, sizeof(saved));
+    memcpy(h->origin_insts, h->tramp_insts, h->tramp_insts_num * 4);
+    c.pc = h->origin_addr;
+    int rc = run_until_exit(&c, h->origin_addr, h->origin_addr + h->tramp_insts_num * 4);
+    memcpy(h->origin_insts, saved, sizeof(saved));
+    if (rc || c.pc != h->replace_addr) return report(h, "trampoline", -1);
+
+    // jump back reaches the first origin instruction after the trampoline
+    random_cpu(&c);
+    c.pc = h->relo_addr + starts[h->tramp_insts_num] * 4;
+    if (run_until_exit(&c, h->relo_addr, h->relo_addr + RELOCATE_INST_NUM * 4) ||
+        c.pc != h->origin_addr + h->tramp_insts_num * 4)
+        return report(h, "jump back", -1);
+
+    for (int i = 0; i < h->tramp_insts_num; i++) {
+        for (int k = 0; k < 4; k++) {
+            if (check_inst(h, starts, i)) return 1;
+        }
+    }
+    return 0;
+}
+
+// Branch and literal offsets, mostly far, sometimes back into the trampoline
+static int32_t rnd_off(int bits, int idx)
+{
+    if (rnd_bits(2) == 0) return (int32_t)rnd_bits(3) - idx;
+    int32_t v = rnd_bits(bits);
+    return (v << (32 - bits)) >> (32 - bits);
+}
+
+static uint32_t rnd_inst(int idx)
+{
+    uint32_t rt = rnd_bits(5);
+    switch (rnd_bits(5)) {
+    case 0: return INST_B | (rnd_off(26, idx) & 0x3ffffff);
+    case 1: return INST_BC | (rnd_off(19, idx) & 0x7ffff) << 5 | rnd_bits(4);
+    case 2: return INST_BL | (rnd_off(26, idx) & 0x3ffffff);
+    case 3: return INST_ADR | rnd_bits(2) << 29 | rnd_bits(19) << 5 | rt;
+    case 4: return INST_ADRP | rnd_bits(2) << 29 | rnd_bits(19) << 5 | rt;
+    case 5: return INST_LDR_32 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 6: return INST_LDR_64 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 7: return INST_LDRSW_LIT | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 8: return INST_PRFM_LIT | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 9: return INST_LDR_SIMD_32 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 10: return INST_LDR_SIMD_64 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 11: return INST_LDR_SIMD_128 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 12: return INST_CBZ | rnd_bits(1) << 31 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 13: return INST_CBNZ | rnd_bits(1) << 31 | (rnd_off(19, idx) & 0x7ffff) << 5 | rt;
+    case 14: return INST_TBZ | rnd_bits(1) << 31 | rnd_bits(5) << 19 | (rnd_off(14, idx) & 0x3fff) << 5 | rt;
+    case 15: return INST_TBNZ | rnd_bits(1) << 31 | rnd_bits(5) << 19 | (rnd_off(14, idx) & 0x3fff) << 5 | rt;
+    case 16: return 0xa9bf7bfd; // stp x29, x30, [sp, #-16]!
+    case 17: return 0x910003fd; // mov x29, sp
+    case 18: return 0xd10043ff; // sub sp, sp, #16
+    default:
+        for (;;) {
+            uint32_t inst = rnd_bits(32);
+            if (classify(inst) < 0 && inst != ARM64_NOP) return inst;
+        }
+    }
+}
+
+static void random_hook(hook_box_t *box)
+{
+    hook_t *h = &box->hook;
+    memset(box, 0, sizeof(*box));
+    for (int i = 0; i < sizeof(box->canary) / sizeof(box->canary[0]); i++) box->canary[i] = 0xdeadbeef;
+
+    h->origin_addr = TEXT_BASE + (rnd_bits(24) << 2);
+    h->func_addr = h->origin_addr;
+    h->replace_addr = REPLACE_BASE + (rnd_bits(20) << 2);
+    h->relo_addr = RELO_BASE + (rnd_bits(20) << 3);
+    for (int i = 0; i < TRAMPOLINE_MAX_NUM; i++) h->origin_insts[i] = rnd_inst(i);
+    if (rnd_bits(2) == 0) h->origin_insts[0] = rnd_bits(1) ? ARM64_PACIASP : ARM64_PACIBSP;
+}
+
+static int fuzz(long iters)
+{
+    hook_box_t box;
+    long ok = 0, rejected = 0;
+    for (long i = 0; i < iters; i++) {
+        random_hook(&box);
+        cur = &box.hook;
+        hook_err_t err = hook_relocate(&box.hook);
+        if (err == -HOOK_BAD_RELO) {
+            rejected++;
+            continue;
+        }
+        if (err) {
+            printf("FAIL unexpected error %d\n", err);
+            return 1;
+        }
+        if (check_hook(&box)) return 1;
+        ok++;
+    }
+    printf("fuzz: %ld relocated, %ld rejected, all checks passed\n", ok, rejected);
+    return 0;
+}
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int bench(long iters)
+{
+    // a typical pac prologue, and random ones
+    static const uint32_t typical[TRAMPOLINE_MAX_NUM] = { ARM64_PACIASP, 0xa9bf7bfd, 0x910003fd,
+                                                          0xf9000bf3, 0xb0000008, 0xd10043ff };
+    enum
+    {
+        NPRO = 256
+    };
+    static hook_box_t boxes[NPRO];
+    for (int i = 0; i < NPRO; i++) random_hook(&boxes[i]);
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0) {
+            for (int i = 0; i < NPRO; i++) memcpy(boxes[i].hook.origin_insts, typical, sizeof(typical));
+        } else {
+            for (int i = 0; i < NPRO; i++) random_hook(&boxes[i]);
+        }
+        long ok = 0;
+        uint64_t start = now_ns();
+        for (long i = 0; i < iters; i++) ok += !hook_relocate(&boxes[i % NPRO].hook);
+        uint64_t ns = now_ns() - start;
+        printf("bench %-8s %10.1f ns/hook %12.0f hooks/s (%ld of %ld relocated)\n", pass ? "random" : "typical",
+               (double)ns / iters, iters * 1e9 / ns, ok, iters);
+    }
+    return 0;
+}
+
+// Target offsets the way relocate.c decoded them before pcrel.h
+static int64_t ref_offset(uint32_t inst, int idx)
+{
+    switch (idx) {
+    case 0:
+    case 2:
+        return sign64_extend((uint64_t)bits32(inst, 25, 0) << 2u, 28u);
+    case 3:
+        return sign64_extend((uint64_t)(bits32(inst, 23, 5) << 2u | bits32(inst, 30, 29)), 21u);
+    case 4:
+        return sign64_extend((uint64_t)bits32(inst, 23, 5) << 14u | (uint64_t)bits32(inst, 30, 29) << 12u, 33u);
+    case 14:
+    case 15:
+        return sign64_extend((uint64_t)bits32(inst, 18, 5) << 2u, 16u);
+    default:
+        return sign64_extend((uint64_t)bits32(inst, 23, 5) << 2u, 21u);
+    }
+}
+
+/*
+ * Classify every word of a kernel image, or of a 40 MB random buffer, with the
+ * reference chain and with pcrel_class(), check they agree and time both.
+ */
+static int decode(const char *path, int passes)
+{
+    size_t size = 40ul << 20;
+    uint32_t *text;
+    if (path) {
+        FILE *fp = fopen(path, "rb");
+        if (!fp) {
+            printf("open %s failed\n", path);
+            return 1;
+        }
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp) & ~3ul;
+        fseek(fp, 0, SEEK_SET);
+        text = malloc(size);
+        if (!text || fread(text, 1, size, fp) != size) {
+            printf("read %s failed\n", path);
+            fclose(fp);
+            return 1;
+        }
+        fclose(fp);
+    } else {
+        text = malloc(size);
+        if (!text) return 1;
+        for (size_t i = 0; i < size / 4; i++) text[i] = rnd_bits(32);
+    }
+    size_t words = size / 4;
+
+    long hist[PCREL_CLASS_NUM] = { 0 };
+    for (size_t i = 0; i < words; i++) {
+        uint32_t inst = text[i];
+        int cls = pcrel_class(inst);
+        if (cls != classify(inst) + 1) {
+            printf("FAIL decode %08x: table %d, chain %d\n", inst, cls, classify(inst) + 1);
+            return 1;
+        }
+        if (cls && pcrel_offset(inst, cls) != ref_offset(inst, cls - 1)) {
+            printf("FAIL offset %08x: %lld, want %lld\n", inst, (long long)pcrel_offset(inst, cls),
+                   (long long)ref_offset(inst, cls - 1));
+            return 1;
+        }
+        hist[cls]++;
+    }
+
+    for (int way = 0; way < 2; way++) {
+        volatile long sink = 0;
+        uint64_t start = now_ns();
+        for (int p = 0; p < passes; p++) {
+            long n = 0;
+            if (way) {
+                for (size_t i = 0; i < words; i++) n += pcrel_class(text[i]);
+            } else {
+                for (size_t i = 0; i < words; i++) n += classify(text[i]);
+            }
+            sink += n;
+        }
+        double ms = (now_ns() - start) / 1e6 / passes;
+        printf("decode %-6s %8.1f ms per %zu MB %8.2f ns/inst\n", way ? "table" : "chain", ms, size >> 20,
+               ms * 1e6 / words);
+    }
+    printf("decode: %zu instructions, %ld pc-relative, table and chain agree\n", words, words - hist[PCREL_NONE]);
+    free(text);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || (strcmp(argv[1], "fuzz") && strcmp(argv[1], "bench") && strcmp(argv[1], "decode"))) {
+        printf("Usage: %s fuzz|bench [iterations] [seed]\n", argv[0]);
+        printf("       %s decode [Image] [passes]\n", argv[0]);
+        return 1;
+    }
+    if (!strcmp(argv[1], "decode")) {
+        rng_state = 0x2545F4914F6CDD1Dul;
+        return decode(argc > 2 ? argv[2] : NULL, argc > 3 ? atoi(argv[3]) : 3);
+    }
+    long iters = argc > 2 ? strtol(argv[2], NULL, 0) : 100000;
+    rng_state = argc > 3 ? strtoull(argv[3], NULL, 0) : 0x2545F4914F6CDD1Dul;
+    if (!rng_state) rng_state = 1;
+    if (iters <= 0) iters = 100000;
+
+    if (!strcmp(argv[1], "fuzz")) return fuzz(iters);
+    return bench(iters);
+}
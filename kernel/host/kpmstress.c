@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Host build of base/kpmalloc.c over base/tlsf.c, threads standing in for cpus.
+ *
+ * Each thread allocates and frees bursts of one size around the class edges, long enough to cross
+ * the magazine refill and drain points, and hands some blocks to other threads to free.
+ * Every block is filled with a pattern derived from a unique tag and checked before it is freed,
+ * then poisoned, so overlapping or reused live blocks show up as corruption.
+ * At the end the pool must pass tlsf_check() and hold no more used blocks than the magazines can.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <kpmalloc.h>
+
+#define POOL_SIZE (64 << 20)
+#define MAX_THREADS 64
+#define LIVE_SLOTS 512
+#define MAILBOX_SLOTS 64
+#define MAX_BURST 34 // two magazines and a bit, see KP_MALLOC_MAG_SIZE
+#define MAG_CAPACITY (16 * 5 * 16) // KP_MALLOC_CPUS * KP_MALLOC_CLASSES * KP_MALLOC_MAG_SIZE
+#define HDR_SIZE 16
+#define POISON 0xdb
+#define MAX_REPORTS 8
+
+tlsf_t kp_rw_mem = 0;
+tlsf_t kp_rox_mem = 0;
+void (*printk)(const char *fmt, ...) = 0;
+__thread uint64_t kp_host_mpidr = 0;
+
+void kp_log(int level, const char *fmt, int nargs, ...)
+{
+}
+
+// class edges and sizes that bypass the magazines or land in one on free
+static const size_t sizes[] = { 1, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 255, 256, 257, 400, 511, 512, 513, 4096 };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+struct live
+{
+    uint8_t *ptr;
+    size_t size;
+    uint64_t tag;
+};
+
+static void *mailbox[MAILBOX_SLOTS];
+static int errors = 0;
+static uint64_t total_ops = 0;
+
+static inline uint64_t rand_next(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static inline uint8_t pattern(uint64_t tag, size_t i)
+{
+    return (uint8_t)((tag >> ((i & 7) * 8)) ^ (i * 131));
+}
+
+static void report(const char *what, uint64_t tag, const void *ptr, size_t size, size_t at)
+{
+    if (__atomic_fetch_add(&errors, 1, __ATOMIC_RELAXED) < MAX_REPORTS) {
+        fprintf(stderr, "%s: tag %016llx block %p size %zu at %zu\n", what, (unsigned long long)tag, ptr, size, at);
+    }
+}
+
+// blocks of HDR_SIZE and up carry their tag and size so any thread can check them
+static void fill(uint8_t *p, size_t size, uint64_t tag)
+{
+    size_t i = 0;
+    if (size >= HDR_SIZE) {
+        memcpy(p, &tag, 8);
+        memcpy(p + 8, &size, 8);
+        i = HDR_SIZE;
+    }
+    for (; i < size; i++)
+        p[i] = pattern(tag, i);
+}
+
+static void check_and_free(uint8_t *p, size_t size, uint64_t tag)
+{
+    size_t i = 0;
+    if (size >= HDR_SIZE) {
+        uint64_t htag, hsize;
+        memcpy(&htag, p, 8);
+        memcpy(&hsize, p + 8, 8);
+        if (htag != tag || hsize != size) {
+            report("header overwritten", tag, p, size, 0);
+            goto out;
+        }
+        i = HDR_SIZE;
+    }
+    for (; i < size; i++) {
+        if (p[i] != pattern(tag, i)) {
+            report(p[i] == POISON ? "freed while live" : "corrupt", tag, p, size, i);
+            break;
+        }
+    }
+out:
+    memset(p, POISON, size);
+    kp_free(p);
+}
+
+struct worker
+{
+    pthread_t thread;
+    int id;
+    long iters;
+    uint64_t seed;
+    uint64_t ops;
+    struct live live[LIVE_SLOTS];
+};
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    uint64_t rnd = w->seed * 0x9e3779b97f4a7c15ull + w->id + 1;
+    uint64_t seq = 0;
+
+    // aff0/aff1 like a two cluster part, several threads share a magazine once there are more than 16
+    kp_host_mpidr = (w->id & 3) | ((uint64_t)(w->id >> 2) << 8);
+
+    for (long it = 0; it < w->iters; it++) {
+        size_t size = sizes[rand_next(&rnd) % NUM_SIZES];
+        int burst = 1 + rand_next(&rnd) % MAX_BURST;
+        int start = rand_next(&rnd) % LIVE_SLOTS;
+        int op = rand_next(&rnd) % 8;
+
+        if (op < 4) {
+            for (int k = 0; k < burst; k++) {
+                struct live *l = &w->live[(start + k) % LIVE_SLOTS];
+                if (l->ptr) continue;
+                l->ptr = kp_malloc(size);
+                if (!l->ptr) {
+                    report("out of memory", 0, 0, size, 0);
+                    return 0;
+                }
+                l->size = size;
+                l->tag = ((uint64_t)(w->id + 1) << 48) | ++seq;
+                fill(l->ptr, size, l->tag);
+                w->ops++;
+            }
+        } else if (op < 7) {
+            for (int k = 0; k < burst; k++) {
+                struct live *l = &w->live[(start + k) % LIVE_SLOTS];
+                if (!l->ptr) continue;
+                check_and_free(l->ptr, l->size, l->tag);
+                l->ptr = 0;
+                w->ops++;
+            }
+        } else {
+            // pass a block on and free whatever another thread left, onto this thread's magazine
+            struct live *l = &w->live[start];
+            int slot = rand_next(&rnd) % MAILBOX_SLOTS;
+            void *give = l->ptr && l->size >= HDR_SIZE ? l->ptr : 0;
+            void *got = __atomic_exchange_n(&mailbox[slot], give, __ATOMIC_ACQ_REL);
+            if (give) l->ptr = 0;
+            if (got) {
+                uint64_t tag, gsize;
+                memcpy(&tag, got, 8);
+                memcpy(&gsize, (uint8_t *)got + 8, 8);
+                if (gsize < HDR_SIZE || gsize > sizes[NUM_SIZES - 1]) {
+                    report("bad handoff header", tag, got, gsize, 8);
+                } else {
+                    check_and_free(got, gsize, tag);
+                }
+                w->ops++;
+            }
+        }
+    }
+
+    for (int i = 0; i < LIVE_SLOTS; i++) {
+        struct live *l = &w->live[i];
+        if (l->ptr) check_and_free(l->ptr, l->size, l->tag);
+    }
+    return 0;
+}
+
+static void count_used(void *ptr, size_t size, int used, void *user)
+{
+    if (used) (*(int *)user)++;
+}
+
+int main(int argc, char **argv)
+{
+    int nthreads = argc > 1 ? atoi(argv[1]) : 8;
+    long iters = argc > 2 ? atol(argv[2]) : 100000;
+    uint64_t seed = argc > 3 ? strtoull(argv[3], 0, 0) : 1;
+
+    if (nthreads < 1 || nthreads > MAX_THREADS) {
+        fprintf(stderr, "usage: %s [threads <= %d] [iters] [seed]\n", argv[0], MAX_THREADS);
+        return 2;
+    }
+
+    void *pool = aligned_alloc(4096, POOL_SIZE);
+    if (!pool) return 2;
+    kp_rw_mem = tlsf_create_with_pool(pool, POOL_SIZE);
+
+    struct worker *workers = calloc(nthreads, sizeof(*workers));
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].id = i;
+        workers[i].iters = iters;
+        workers[i].seed = seed;
+        pthread_create(&workers[i].thread, 0, worker_main, &workers[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(workers[i].thread, 0);
+        total_ops += workers[i].ops;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    for (int i = 0; i < MAILBOX_SLOTS; i++) {
+        uint8_t *p = mailbox[i];
+        if (!p) continue;
+        uint64_t tag, size;
+        memcpy(&tag, p, 8);
+        memcpy(&size, p + 8, 8);
+        check_and_free(p, size, tag);
+    }
+
+    int check = tlsf_check(kp_rw_mem);
+    if (check) {
+        fprintf(stderr, "tlsf_check: %d\n", check);
+        errors++;
+    }
+    int used = 0;
+    tlsf_walk_pool(tlsf_get_pool(kp_rw_mem), count_used, &used);
+    if (used > MAG_CAPACITY) {
+        fprintf(stderr, "leak: %d used blocks, magazines hold at most %d\n", used, MAG_CAPACITY);
+        errors++;
+    }
+
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("kpmstress: %d threads, %llu ops, %.1f Mops/s, %d blocks left in magazines, %d errors\n", nthreads,
+           (unsigned long long)total_ops, total_ops / secs / 1e6, used, errors);
+    free(workers);
+    free(pool);
+    return errors ? 1 : 0;
+}
@@ -59,4 +59,32 @@ static inline bool is_kpm_rox_area(unsigned long addr)
     return addr >= (unsigned long)_kp_rox_start && addr < (unsigned long)_kp_rox_end;
 }
 
+#ifdef KP_HOST
+// host builds, see host/kpmstress.c, set it per thread
+extern __thread uint64_t kp_host_mpidr;
+#endif
+
+static inline uint64_t kp_read_mpidr()
+{
+#ifdef KP_HOST
+    return kp_host_mpidr;
+#else
+    uint64_t mpidr;
+    asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return mpidr;
+#endif
+}
+
+/*
+ * Per-cpu slot of the current cpu out of n, a power of two, for the kp_malloc magazines and other per-cpu arrays.
+ * Aff0 on classic layouts, Aff1 on DynamIQ ones. Two cpus can map to one slot, so slot updates must still be
+ * exclusive, sharing only costs contention.
+ */
+static inline int kp_cpu_slot(int n)
+{
+    uint64_t mpidr = kp_read_mpidr();
+    uint64_t idx = (mpidr & 0xff) + ((mpidr >> 8) & 0xff) + ((mpidr >> 16) & 0xff) * 8;
+    return idx & (n - 1);
+}
+
 #endif
\ No newline at end of file
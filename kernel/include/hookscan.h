@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2023 bmax121. All Rights Reserved.
+ */
+
+#ifndef _KP_HOOKSCAN_H_
+#define _KP_HOOKSCAN_H_
+
+#include <stdint.h>
+
+/*
+ * Hookability table written by kptools --hookscan.
+ * Only functions that are not plainly hookable are listed, sorted by offset from _text,
+ * so a module can embed it and ask before hooking. It only holds for the image it was scanned from.
+ */
+
+#define HOOKSCAN_MAGIC 0x5348504b // "KPHS"
+#define HOOKSCAN_VERSION 1
+
+enum hookscan_status
+{
+    HOOKSCAN_OK = 0, // no pc-relative instruction under the trampoline
+    HOOKSCAN_RELO, // hookable, some instructions get relocated
+    HOOKSCAN_BAD, // hook_prepare() will fail or the hook will break the function
+};
+
+enum hookscan_reason
+{
+    HOOKSCAN_R_NONE = 0,
+    HOOKSCAN_R_SHORT, // function shorter than the trampoline
+    HOOKSCAN_R_BRANCH_IN, // a branch in the function lands inside the trampoline
+    HOOKSCAN_R_LITERAL, // literal load inside the trampoline
+    HOOKSCAN_R_RELO_LEN, // relocated instructions don't fit in relo_insts
+    HOOKSCAN_R_OUT, // entry or trampoline outside the image
+};
+
+#define HOOKSCAN_F_PAC 0x1 // starts with paciasp/pacibsp, trampoline is one instruction longer
+#define HOOKSCAN_F_BTI 0x2 // bti landing pad skipped, trampoline goes after it
+#define HOOKSCAN_F_FOLLOW 0x4 // starts with b, trampoline goes at the branch target
+
+struct hookscan_entry
+{
+    uint32_t offset;
+    uint8_t status;
+    uint8_t reason;
+    uint8_t flags;
+    uint8_t relo_num; // instructions relocated, jump back excluded
+};
+
+struct hookscan_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t func_num; // functions scanned
+    uint32_t entry_num;
+    struct hookscan_entry entries[];
+};
+
+static inline const struct hookscan_entry *hookscan_find(const struct hookscan_header *hdr, uint32_t offset)
+{
+    if (!hdr || hdr->magic != HOOKSCAN_MAGIC || hdr->version != HOOKSCAN_VERSION) return 0;
+    uint32_t lo = 0, hi = hdr->entry_num;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t cur = hdr->entries[mid].offset;
+        if (cur == offset) return &hdr->entries[mid];
+        if (cur < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+/**
+ * Status of the function at offset from _text, HOOKSCAN_OK if it isn't listed
+ */
+static inline int hookscan_status(const struct hookscan_header *hdr, uint32_t offset)
+{
+    const struct hookscan_entry *entry = hookscan_find(hdr, offset);
+    return entry ? entry->status : HOOKSCAN_OK;
+}
+
+#endif
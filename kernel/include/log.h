@@ -1,5 +1,5 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later */
-/* 
+/*
  * Copyright (C) 2023 bmax121. All Rights Reserved.
  */
 
@@ -13,25 +13,64 @@
 
 extern void (*printk)(const char *fmt, ...);
 
-#define logkv(fmt, ...) printk("[+] KP V " fmt, ##__VA_ARGS__)
-// #define logkv(fmt, ...)
+#define KP_LOG_V 0
+#define KP_LOG_D 1
+#define KP_LOG_I 2
+#define KP_LOG_W 3
+#define KP_LOG_E 4
 
-// #define logkfv(fmt, ...) printk("[+] KP V %s: " fmt, __func__, ##__VA_ARGS__)
-#define logkfv(fmt, ...)
+// Calls below this level are compiled out
+#ifndef KP_LOG_MIN_LEVEL
+#define KP_LOG_MIN_LEVEL KP_LOG_V
+#endif
 
-#define logkd(fmt, ...) printk("[+] KP D " fmt, ##__VA_ARGS__)
-#define logkfd(fmt, ...) printk("[+] KP D %s: " fmt, __func__, ##__VA_ARGS__)
+// Arguments kept per record, all integers or pointers
+#define KP_LOG_MAX_ARGS 12
 
-#define logki(fmt, ...) printk("[+] KP I " fmt, ##__VA_ARGS__)
-#define logkfi(fmt, ...) printk("[+] KP I %s: " fmt, __func__, ##__VA_ARGS__)
+#define __KP_LOG_NARGS(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, n, ...) n
+#define KP_LOG_NARGS(...) __KP_LOG_NARGS(0, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
 
-#define logkw(fmt, ...) printk("[-] KP W " fmt, ##__VA_ARGS__)
-#define logkfw(fmt, ...) printk("[-] KP W %s: " fmt, __func__, ##__VA_ARGS__)
+/*
+ * Records go to a binary ring as (format, arguments) and are only formatted when read.
+ * Records at or above the console level are also printed, rate limited.
+ */
+void kp_log(int level, const char *fmt, int nargs, ...);
+
+#define __logk(level, fmt, ...)                                                                     \
+    do {                                                                                            \
+        _Static_assert(KP_LOG_NARGS(__VA_ARGS__) <= KP_LOG_MAX_ARGS, "too many log arguments");  \
+        if ((level) >= KP_LOG_MIN_LEVEL) kp_log(level, fmt, KP_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+
+#define logkv(fmt, ...) __logk(KP_LOG_V, "[+] KP V " fmt, ##__VA_ARGS__)
+#define logkfv(fmt, ...) __logk(KP_LOG_V, "[+] KP V %s: " fmt, __func__, ##__VA_ARGS__)
+
+#define logkd(fmt, ...) __logk(KP_LOG_D, "[+] KP D " fmt, ##__VA_ARGS__)
+#define logkfd(fmt, ...) __logk(KP_LOG_D, "[+] KP D %s: " fmt, __func__, ##__VA_ARGS__)
+
+#define logki(fmt, ...) __logk(KP_LOG_I, "[+] KP I " fmt, ##__VA_ARGS__)
+#define logkfi(fmt, ...) __logk(KP_LOG_I, "[+] KP I %s: " fmt, __func__, ##__VA_ARGS__)
+
+#define logkw(fmt, ...) __logk(KP_LOG_W, "[-] KP W " fmt, ##__VA_ARGS__)
+#define logkfw(fmt, ...) __logk(KP_LOG_W, "[-] KP W %s: " fmt, __func__, ##__VA_ARGS__)
+
+#define logke(fmt, ...) __logk(KP_LOG_E, "[-] KP E " fmt, ##__VA_ARGS__)
+#define logkfe(fmt, ...) __logk(KP_LOG_E, "[-] KP E %s: " fmt, __func__, ##__VA_ARGS__)
+
+// Runtime levels, records below ring_level are dropped, below console_level are not printed
+void kp_log_set_level(int ring_level, int console_level);
+
+// Largest entry kp_log_read() writes, a buffer of this size always takes at least one
+#define KP_LOG_ENTRY_MAX 1152
+
+// Format ring records from *seq on into buf as struct kp_log_entry, *seq is moved past the last one copied
+// Returns: bytes written
+int kp_log_read(uint64_t *seq, void *buf, int len);
 
-#define logke(fmt, ...) printk("[-] KP E " fmt, ##__VA_ARGS__)
-#define logkfe(fmt, ...) printk("[-] KP E %s: " fmt, __func__, ##__VA_ARGS__)
+// Boot records are also kept apart from the ring, get_boot_log() formats them
+void kp_log_boot(const char *fmt, int nargs, ...);
+#define log_boot(fmt, ...) kp_log_boot(fmt, KP_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__)
 
-void log_boot(const char *fmt, ...);
 const char *get_boot_log();
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2024 bmax121. All Rights Reserved.
+ */
+
+#ifndef _KP_LZ4_H_
+#define _KP_LZ4_H_
+
+#include <ktypes.h>
+
+/**
+ * Decompress one lz4 block, the format kptools compresses extra items with.
+ * Stops once dst_len bytes are written, so src may carry alignment padding.
+ * Returns the bytes written, or -1 if src is malformed or doesn't fit.
+ */
+int lz4_decompress(const void *src, int src_len, void *dst, int dst_len);
+
+#endif
@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2023 bmax121. All Rights Reserved.
+ */
+
+#ifndef _KP_PCREL_H_
+#define _KP_PCREL_H_
+
+#include <stdint.h>
+
+/*
+ * A64 instructions that address relative to their own pc and can't be copied elsewhere as is.
+ * Header only, shared by the hook relocator, module relocation and kptools.
+ */
+enum pcrel_class
+{
+    PCREL_NONE = 0,
+    PCREL_B,
+    PCREL_BC,
+    PCREL_BL,
+    PCREL_ADR,
+    PCREL_ADRP,
+    PCREL_LDR_32,
+    PCREL_LDR_64,
+    PCREL_LDRSW,
+    PCREL_PRFM,
+    PCREL_LDR_SIMD_32,
+    PCREL_LDR_SIMD_64,
+    PCREL_LDR_SIMD_128,
+    PCREL_CBZ,
+    PCREL_CBNZ,
+    PCREL_TBZ,
+    PCREL_TBNZ,
+    PCREL_CLASS_NUM,
+};
+
+// Every class is decided by bits 31:24
+static const uint8_t pcrel_table[256] = {
+    [0x14 ... 0x17] = PCREL_B,
+    [0x94 ... 0x97] = PCREL_BL,
+    [0x54] = PCREL_BC,
+    [0x10] = PCREL_ADR,
+    [0x30] = PCREL_ADR,
+    [0x50] = PCREL_ADR,
+    [0x70] = PCREL_ADR,
+    [0x90] = PCREL_ADRP,
+    [0xB0] = PCREL_ADRP,
+    [0xD0] = PCREL_ADRP,
+    [0xF0] = PCREL_ADRP,
+    [0x18] = PCREL_LDR_32,
+    [0x58] = PCREL_LDR_64,
+    [0x98] = PCREL_LDRSW,
+    [0xD8] = PCREL_PRFM,
+    [0x1C] = PCREL_LDR_SIMD_32,
+    [0x5C] = PCREL_LDR_SIMD_64,
+    [0x9C] = PCREL_LDR_SIMD_128,
+    [0x34] = PCREL_CBZ,
+    [0xB4] = PCREL_CBZ,
+    [0x35] = PCREL_CBNZ,
+    [0xB5] = PCREL_CBNZ,
+    [0x36] = PCREL_TBZ,
+    [0xB6] = PCREL_TBZ,
+    [0x37] = PCREL_TBNZ,
+    [0xB7] = PCREL_TBNZ,
+};
+
+// Instructions hook_relocate() emits for each class, padded with NOPs to an even number
+static const int8_t pcrel_relo_len[PCREL_CLASS_NUM] = {
+    [PCREL_NONE] = 2,
+    [PCREL_B] = 6,
+    [PCREL_BC] = 8,
+    [PCREL_BL] = 8,
+    [PCREL_ADR] = 4,
+    [PCREL_ADRP] = 4,
+    [PCREL_LDR_32] = 6,
+    [PCREL_LDR_64] = 6,
+    [PCREL_LDRSW] = 6,
+    [PCREL_PRFM] = 8,
+    [PCREL_LDR_SIMD_32] = 8,
+    [PCREL_LDR_SIMD_64] = 8,
+    [PCREL_LDR_SIMD_128] = 8,
+    [PCREL_CBZ] = 6,
+    [PCREL_CBNZ] = 6,
+    [PCREL_TBZ] = 6,
+    [PCREL_TBNZ] = 6,
+};
+
+static inline int pcrel_class(uint32_t inst)
+{
+    int cls = pcrel_table[inst >> 24];
+    // bit 4 set is BC.cond, not handled
+    if (cls == PCREL_BC && (inst & 0x10)) return PCREL_NONE;
+    return cls;
+}
+
+/**
+ * Byte offset of the target from the instruction, from its 4K page for ADRP.
+ * Returns 0 for PCREL_NONE.
+ */
+static inline int64_t pcrel_offset(uint32_t inst, int cls)
+{
+    switch (cls) {
+    case PCREL_B:
+    case PCREL_BL:
+        return ((int64_t)((uint64_t)inst << 38) >> 38) * 4;
+    case PCREL_TBZ:
+    case PCREL_TBNZ:
+        return ((int64_t)((uint64_t)inst << 45) >> 50) * 4;
+    case PCREL_ADR:
+        return ((int64_t)((uint64_t)inst << 40) >> 45) * 4 + ((inst >> 29) & 3);
+    case PCREL_ADRP:
+        return (((int64_t)((uint64_t)inst << 40) >> 45) * 4 + ((inst >> 29) & 3)) * 4096;
+    case PCREL_NONE:
+        return 0;
+    default:
+        return ((int64_t)((uint64_t)inst << 40) >> 45) * 4;
+    }
+}
+
+static inline uint64_t pcrel_target(uint32_t inst, int cls, uint64_t pc)
+{
+    if (cls == PCREL_ADRP) pc &= ~0xFFFul;
+    return pc + pcrel_offset(inst, cls);
+}
+
+#endif
@@ -22,6 +22,15 @@ uint64_t rand_next();
 int on_each_extra_item(int (*callback)(const patch_extra_item_t *extra, const char *arg, const void *data, void *udata),
                        void *udata);
 
+/**
+ * Items whose event is event, or have none and event is the default one, looked up in the index.
+ * Without an index, as in images from older tools, all items are walked instead.
+ * Digests are verified, lz4 content is passed as stored, see EXTRA_FLAG_LZ4.
+ */
+int on_each_extra_event(const char *event,
+                        int (*callback)(const patch_extra_item_t *extra, const char *arg, const void *data, void *udata),
+                        void *udata);
+
 void predata_init();
 
 #endif
\ No newline at end of file
@@ -150,6 +150,7 @@ typedef int32_t extra_item_type;
 #define EXTRA_TYPE_EXEC 3
 #define EXTRA_TYPE_RAW 4
 #define EXTRA_TYPE_ANDROID_RC 5
+#define EXTRA_TYPE_INDEX 6
 
 #define EXTRA_TYPE_NONE_STR "none"
 #define EXTRA_TYPE_KPM_STR "kpm"
@@ -157,6 +158,12 @@ typedef int32_t extra_item_type;
 #define EXTRA_TYPE_EXEC_STR "exec"
 #define EXTRA_TYPE_RAW_STR "raw"
 #define EXTRA_TYPE_ANDROID_RC_STR "android_rc"
+#define EXTRA_TYPE_INDEX_STR "index"
+
+#define EXTRA_FLAG_LZ4 0x1 // content is an lz4 block, raw_size bytes once decompressed
+#define EXTRA_FLAG_SHA256 0x2 // digest is the sha256 of the stored content
+
+#define EXTRA_DIGEST_LEN 32
 
 // todo
 #define EXTRA_EVENT_PAGING_INIT "paging-init"
@@ -187,12 +194,27 @@ struct _patch_extra_item
             extra_item_type type;
             char name[EXTRA_NAME_LEN];
             char event[EXTRA_EVENT_LEN];
+            int32_t flags;
+            int32_t raw_size;
+            uint8_t digest[EXTRA_DIGEST_LEN];
         };
         char _cap[PATCH_EXTRA_ITEM_LEN];
     };
 };
 typedef struct _patch_extra_item patch_extra_item_t;
 _Static_assert(sizeof(patch_extra_item_t) == PATCH_EXTRA_ITEM_LEN, "sizeof patch_extra_item_t mismatch");
+
+// Content of the EXTRA_TYPE_INDEX item, the first one, an entry for each item after it
+struct _patch_extra_index
+{
+    int32_t offset; // item header, from the start of extras
+    extra_item_type type;
+    int32_t flags;
+    int32_t _;
+    char event[EXTRA_EVENT_LEN];
+};
+typedef struct _patch_extra_index patch_extra_index_t;
+_Static_assert(sizeof(patch_extra_index_t) % EXTRA_ALIGN == 0, "sizeof patch_extra_index_t not aligned");
 #endif
 
 #ifndef __ASSEMBLY__
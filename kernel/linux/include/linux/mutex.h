@@ -0,0 +1,49 @@
+#ifndef __LINUX_MUTEX_H
+#define __LINUX_MUTEX_H
+
+#include <ktypes.h>
+#include <compiler.h>
+#include <stdint.h>
+#include <ksyms.h>
+
+struct lock_class_key;
+
+// Never touched by KernelPatch, sized over the largest layout seen, debug mutexes and spinlocks with lockdep
+#define MUTEX_OPAQUE_SIZE 256
+
+struct mutex
+{
+    uint64_t __opaque[MUTEX_OPAQUE_SIZE / sizeof(uint64_t)];
+};
+
+_Static_assert(sizeof(struct mutex) == MUTEX_OPAQUE_SIZE, "struct mutex size");
+
+extern void kfunc_def(__mutex_init)(struct mutex *lock, const char *name, struct lock_class_key *key);
+extern void kfunc_def(mutex_lock)(struct mutex *lock);
+extern int kfunc_def(mutex_trylock)(struct mutex *lock);
+extern void kfunc_def(mutex_unlock)(struct mutex *lock);
+// >= 5.1 with lockdep, makes a key outside kernel data acceptable to lockdep
+extern void kfunc_def(lockdep_register_key)(struct lock_class_key *key);
+
+static inline void __mutex_init(struct mutex *lock, const char *name, struct lock_class_key *key)
+{
+    kfunc_call_void(__mutex_init, lock, name, key);
+}
+
+static inline void mutex_lock(struct mutex *lock)
+{
+    kfunc_call_void(mutex_lock, lock);
+}
+
+static inline int mutex_trylock(struct mutex *lock)
+{
+    kfunc_call(mutex_trylock, lock);
+    return 0;
+}
+
+static inline void mutex_unlock(struct mutex *lock)
+{
+    kfunc_call_void(mutex_unlock, lock);
+}
+
+#endif
@@ -60,4 +60,16 @@ extern long kfunc_def(strnlen_user_nofault)(const void __user *unsafe_addr, long
 extern long kfunc_def(strnlen_unsafe_user)(const void __user *unsafe_addr, long count);
 extern long kfunc_def(strnlen_user)(const char __user *str, long n);
 
+// checked copy, only out of line when the arch doesn't inline it, returns the number of bytes NOT copied.
+extern unsigned long kfunc_def(_copy_from_user)(void *to, const void __user *from, unsigned long n);
+
+// >= 5.8, checked and with pagefaults disabled, returns 0 or -EFAULT.
+extern long kfunc_def(copy_from_user_nofault)(void *dst, const void __user *src, size_t size);
+// 5.3 - 5.7, the same as copy_from_user_nofault
+extern long kfunc_def(probe_user_read)(void *dst, const void __user *src, size_t size);
+
+// arm64 raw user copy, unchecked, returns the number of bytes NOT copied.
+// Before 5.11 it enables uaccess (PAN, TTBR0) itself, later raw_copy_from_user() does.
+extern unsigned long kfunc_def(__arch_copy_from_user)(void *to, const void __user *from, unsigned long n);
+
 #endif
\ No newline at end of file
@@ -32,6 +32,7 @@
 #include <linux/umh.h>
 #include <uapi/scdefs.h>
 #include <uapi/linux/stat.h>
+#include <module.h>
 
 #define ORIGIN_RC_FILE "/system/etc/init/atrace.rc"
 #define REPLACE_RC_FILE "/dev/user_init.rc"
@@ -115,15 +116,15 @@ out:
     return off;
 }
 
+// extra_event() for it is in before_first_exec()
 static void pre_user_exec_init()
 {
-    log_boot("event: %s\n", EXTRA_EVENT_PRE_EXEC_INIT);
     kernel_write_file(USER_INIT_SH_PATH, user_init, sizeof(user_init), 0700);
 }
 
 static void pre_init_second_stage()
 {
-    log_boot("event: %s\n", EXTRA_EVENT_PRE_SECOND_STAGE);
+    extra_event(EXTRA_EVENT_PRE_SECOND_STAGE);
 }
 
 static void on_first_app_process()
@@ -158,41 +159,43 @@ static void handle_before_execve(hook_local_t *hook_local, char **__user u_filen
             pre_user_exec_init();
         }
 
-        if (!init_second_stage_executed) {
-            for (int i = 1;; i++) {
-                const char __user *p1 = get_user_arg_ptr(0, *uargv, i);
-                if (!p1 || IS_ERR(p1)) break;
-
-                char arg[16] = { '\0' };
-                if (compat_strncpy_from_user(arg, p1, sizeof(arg)) <= 0) break;
+        char arena[1024];
+        const char *args[16];
 
-                if (!strcmp(arg, "second_stage") || !strcmp(arg, "--second-stage")) {
-                    log_boot("exec %s second stage 0\n", filename);
-                    pre_init_second_stage();
-                    init_second_stage_executed = 1;
+        if (!init_second_stage_executed) {
+            for (int i = 1;;) {
+                int n = get_user_arg_strs(0, *uargv, i, args, sizeof(args) / sizeof(args[0]), arena, sizeof(arena));
+                if (n <= 0) break;
+                for (int j = 0; j < n; j++) {
+                    if (!strcmp(args[j], "second_stage") || !strcmp(args[j], "--second-stage")) {
+                        log_boot("exec %s second stage 0\n", filename);
+                        pre_init_second_stage();
+                        init_second_stage_executed = 1;
+                    }
                 }
+                i += n;
             }
         }
 
         if (!init_second_stage_executed) {
-            for (int i = 0;; i++) {
-                const char *__user uenv = get_user_arg_ptr(0, *uenvp, i);
-                if (!uenv || IS_ERR(uenv)) break;
-
-                char env[256];
-                if (compat_strncpy_from_user(env, uenv, sizeof(env)) <= 0) break;
-                char *env_name = env;
-                char *env_value = strchr(env, '=');
-                if (env_value) {
-                    *env_value = '\0';
-                    env_value++;
-                    if (!strcmp(env_name, "INIT_SECOND_STAGE") &&
-                        (!strcmp(env_value, "1") || !strcmp(env_value, "true"))) {
-                        log_boot("exec %s second stage 1\n", filename);
-                        pre_init_second_stage();
-                        init_second_stage_executed = 1;
+            for (int i = 0;;) {
+                int n = get_user_arg_strs(0, *uenvp, i, args, sizeof(args) / sizeof(args[0]), arena, sizeof(arena));
+                if (n <= 0) break;
+                for (int j = 0; j < n; j++) {
+                    char *env_name = (char *)args[j];
+                    char *env_value = strchr(env_name, '=');
+                    if (env_value) {
+                        *env_value = '\0';
+                        env_value++;
+                        if (!strcmp(env_name, "INIT_SECOND_STAGE") &&
+                            (!strcmp(env_value, "1") || !strcmp(env_value, "true"))) {
+                            log_boot("exec %s second stage 1\n", filename);
+                            pre_init_second_stage();
+                            init_second_stage_executed = 1;
+                        }
                     }
                 }
+                i += n;
             }
         }
     }
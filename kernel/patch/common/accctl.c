@@ -170,31 +170,95 @@ out:
     return rc;
 }
 
-static int (*avc_denied_backup)(struct selinux_state *state, void *ssid, void *tsid, void *tclass, void *requested,
-                                void *driver, void *xperm, void *flags, struct av_decision *avd) = 0;
+#define SEL_STATS_CPUS 16
+#define SEL_STATS_NUM (sizeof(struct sel_stats) / sizeof(uint64_t))
 
-static int avc_denied_replace(struct selinux_state *_state, void *_ssid, void *_tsid, void *_tclass, void *_requested,
-                              void *_driver, void *_xperm, void *_flags, struct av_decision *_avd)
+// decisions, in the field order of struct sel_stats
+#define SEL_ALL_ALLOW 0
+#define SEL_TASK_ALLOW 1
+#define SEL_FORWARD 2
+
+// first counter of each hook
+#define SEL_STAT_AVC 0
+#define SEL_STAT_AUDIT 3
+
+typedef struct
+{
+    uint64_t cnt[SEL_STATS_NUM];
+} __attribute__((aligned(64))) sel_stats_slot_t;
+
+static sel_stats_slot_t sel_stats_slots[SEL_STATS_CPUS];
+
+/*
+ * Counters are spread over kp_cpu_slot() slots.
+ * Two cpus can share a slot so the adds are still exclusive, but no line is shared by every cpu.
+ */
+static inline void sel_stat_inc(int which)
+{
+    uint64_t val;
+    uint32_t tmp;
+    uint64_t *cnt = &sel_stats_slots[kp_cpu_slot(SEL_STATS_CPUS)].cnt[which];
+    asm volatile("1: ldxr %0, %2\n"
+                 "add %0, %0, #1\n"
+                 "stxr %w1, %0, %2\n"
+                 "cbnz %w1, 1b"
+                 : "=&r"(val), "=&r"(tmp), "+Q"(*cnt));
+}
+
+void get_sel_stats(struct sel_stats *stats)
+{
+    uint64_t *out = (uint64_t *)stats;
+    for (int i = 0; i < SEL_STATS_NUM; i++) {
+        out[i] = 0;
+        for (int cpu = 0; cpu < SEL_STATS_CPUS; cpu++) {
+            out[i] += READ_ONCE(sel_stats_slots[cpu].cnt[i]);
+        }
+    }
+}
+
+void reset_sel_stats()
+{
+    for (int cpu = 0; cpu < SEL_STATS_CPUS; cpu++) {
+        for (int i = 0; i < SEL_STATS_NUM; i++) {
+            WRITE_ONCE(sel_stats_slots[cpu].cnt[i], 0);
+        }
+    }
+}
+
+/*
+ * Shared by avc_denied and slow_avc_audit, both take (state, ssid, ...) on new kernels and (ssid, ...) on old ones.
+ * The result depends on the current task, not only on (ssid, tsid, tclass), so it can't be cached per sid.
+ */
+static __always_inline int sel_decide(struct selinux_state *_state, void *_ssid)
 {
     if (all_allow_sid != SECSID_NULL) {
         u32 ssid = (u32)(u64)_ssid;
         if ((uint64_t)_state <= 0xffffffffL) {
             ssid = (u32)(u64)_state;
         }
-        if (ssid == all_allow_sid) {
-            goto allow;
-        }
+        if (ssid == all_allow_sid) return SEL_ALL_ALLOW;
     }
 
     struct task_ext *ext = get_current_task_ext();
-    if (unlikely(task_ext_valid(ext) && (ext->sel_allow || ext->priv_sel_allow))) {
-        goto allow;
-    }
+    if (unlikely(task_ext_valid(ext) && (ext->sel_allow || ext->priv_sel_allow))) return SEL_TASK_ALLOW;
 
-    int rc = avc_denied_backup(_state, _ssid, _tsid, _tclass, _requested, _driver, _xperm, _flags, _avd);
-    return rc;
+    return SEL_FORWARD;
+}
+
+static int (*avc_denied_backup)(struct selinux_state *state, void *ssid, void *tsid, void *tclass, void *requested,
+                                void *driver, void *xperm, void *flags, struct av_decision *avd) = 0;
+
+static int avc_denied_replace(struct selinux_state *_state, void *_ssid, void *_tsid, void *_tclass, void *_requested,
+                              void *_driver, void *_xperm, void *_flags, struct av_decision *_avd)
+{
+    int decision = sel_decide(_state, _ssid);
+    sel_stat_inc(SEL_STAT_AVC + decision);
+
+    if (likely(decision == SEL_FORWARD)) {
+        int rc = avc_denied_backup(_state, _ssid, _tsid, _tclass, _requested, _driver, _xperm, _flags, _avd);
+        return rc;
+    }
 
-allow:
     struct av_decision *avd = (struct av_decision *)_avd;
     if ((uint64_t)_state <= 0xffffffffL) {
         avd = (struct av_decision *)_flags;
@@ -213,20 +277,10 @@ static int slow_avc_audit_replace(struct selinux_state *_state, void *_ssid, voi
                                   void *_requested, void *_audited, void *_denied, void *_result,
                                   struct common_audit_data *_a)
 {
-    if (all_allow_sid != SECSID_NULL) {
-        u32 ssid = (u64)_ssid;
-        if ((uint64_t)_state <= 0xffffffffL) {
-            ssid = (u64)_state;
-        }
-        if (ssid == all_allow_sid) {
-            return 0;
-        }
-    }
+    int decision = sel_decide(_state, _ssid);
+    sel_stat_inc(SEL_STAT_AUDIT + decision);
 
-    struct task_ext *ext = get_current_task_ext();
-    if (unlikely(task_ext_valid(ext) && (ext->sel_allow || ext->priv_sel_allow))) {
-        return 0;
-    }
+    if (decision != SEL_FORWARD) return 0;
 
     int rc = slow_avc_audit_backup(_state, _ssid, _tsid, _tclass, _requested, _audited, _denied, _result, _a);
     return rc;
@@ -0,0 +1,1134 @@
+/* Generated by sysname.sh, do not edit. */
+
+#if SYSCALL_NAME_TABLE_SIZE != 460
+#error "rerun sysname.sh"
+#endif
+
+static const char syscall_names[] = ""
+                                   "\0sys_io_setup"
+                                   "\0sys_io_destroy"
+                                   "\0sys_io_submit"
+                                   "\0sys_io_cancel"
+                                   "\0sys_io_getevents"
+                                   "\0sys_setxattr"
+                                   "\0sys_lsetxattr"
+                                   "\0sys_fsetxattr"
+                                   "\0sys_getxattr"
+                                   "\0sys_lgetxattr"
+                                   "\0sys_fgetxattr"
+                                   "\0sys_listxattr"
+                                   "\0sys_llistxattr"
+                                   "\0sys_flistxattr"
+                                   "\0sys_removexattr"
+                                   "\0sys_lremovexattr"
+                                   "\0sys_fremovexattr"
+                                   "\0sys_getcwd"
+                                   "\0sys_eventfd2"
+                                   "\0sys_epoll_create1"
+                                   "\0sys_epoll_ctl"
+                                   "\0sys_epoll_pwait"
+                                   "\0sys_dup"
+                                   "\0sys_dup3"
+                                   "\0sys_fcntl"
+                                   "\0sys_inotify_init1"
+                                   "\0sys_inotify_add_watch"
+                                   "\0sys_inotify_rm_watch"
+                                   "\0sys_ioctl"
+                                   "\0sys_ioprio_set"
+                                   "\0sys_ioprio_get"
+                                   "\0sys_flock"
+                                   "\0sys_mknodat"
+                                   "\0sys_mkdirat"
+                                   "\0sys_unlinkat"
+                                   "\0sys_symlinkat"
+                                   "\0sys_linkat"
+                                   "\0sys_renameat"
+                                   "\0sys_umount"
+                                   "\0sys_mount"
+                                   "\0sys_pivot_root"
+                                   "\0sys_statfs"
+                                   "\0sys_fstatfs"
+                                   "\0sys_truncate"
+                                   "\0sys_ftruncate"
+                                   "\0sys_fallocate"
+                                   "\0sys_faccessat"
+                                   "\0sys_chdir"
+                                   "\0sys_fchdir"
+                                   "\0sys_chroot"
+                                   "\0sys_fchmod"
+                                   "\0sys_fchmodat"
+                                   "\0sys_fchownat"
+                                   "\0sys_fchown"
+                                   "\0sys_openat"
+                                   "\0sys_close"
+                                   "\0sys_vhangup"
+                                   "\0sys_pipe2"
+                                   "\0sys_quotactl"
+                                   "\0sys_getdents64"
+                                   "\0sys_lseek"
+                                   "\0sys_read"
+                                   "\0sys_write"
+                                   "\0sys_readv"
+                                   "\0sys_writev"
+                                   "\0sys_pread64"
+                                   "\0sys_pwrite64"
+                                   "\0sys_preadv"
+                                   "\0sys_pwritev"
+                                   "\0sys_sendfile64"
+                                   "\0sys_pselect6"
+                                   "\0sys_ppoll"
+                                   "\0sys_signalfd4"
+                                   "\0sys_vmsplice"
+                                   "\0sys_splice"
+                                   "\0sys_tee"
+                                   "\0sys_readlinkat"
+                                   "\0sys_newfstatat"
+                                   "\0sys_newfstat"
+                                   "\0sys_sync"
+                                   "\0sys_fsync"
+                                   "\0sys_fdatasync"
+                                   "\0sys_sync_file_range"
+                                   "\0sys_timerfd_create"
+                                   "\0sys_timerfd_settime"
+                                   "\0sys_timerfd_gettime"
+                                   "\0sys_utimensat"
+                                   "\0sys_acct"
+                                   "\0sys_capget"
+                                   "\0sys_capset"
+                                   "\0sys_arm64_personality"
+                                   "\0sys_exit"
+                                   "\0sys_exit_group"
+                                   "\0sys_waitid"
+                                   "\0sys_set_tid_address"
+                                   "\0sys_unshare"
+                                   "\0sys_futex"
+                                   "\0sys_set_robust_list"
+                                   "\0sys_get_robust_list"
+                                   "\0sys_nanosleep"
+                                   "\0sys_getitimer"
+                                   "\0sys_setitimer"
+                                   "\0sys_kexec_load"
+                                   "\0sys_init_module"
+                                   "\0sys_delete_module"
+                                   "\0sys_timer_create"
+                                   "\0sys_timer_gettime"
+                                   "\0sys_timer_getoverrun"
+                                   "\0sys_timer_settime"
+                                   "\0sys_timer_delete"
+                                   "\0sys_clock_settime"
+                                   "\0sys_clock_gettime"
+                                   "\0sys_clock_getres"
+                                   "\0sys_clock_nanosleep"
+                                   "\0sys_syslog"
+                                   "\0sys_ptrace"
+                                   "\0sys_sched_setparam"
+                                   "\0sys_sched_setscheduler"
+                                   "\0sys_sched_getscheduler"
+                                   "\0sys_sched_getparam"
+                                   "\0sys_sched_setaffinity"
+                                   "\0sys_sched_getaffinity"
+                                   "\0sys_sched_yield"
+                                   "\0sys_sched_get_priority_max"
+                                   "\0sys_sched_get_priority_min"
+                                   "\0sys_sched_rr_get_interval"
+                                   "\0sys_restart_syscall"
+                                   "\0sys_kill"
+                                   "\0sys_tkill"
+                                   "\0sys_tgkill"
+                                   "\0sys_sigaltstack"
+                                   "\0sys_rt_sigsuspend"
+                                   "\0sys_rt_sigaction"
+                                   "\0sys_rt_sigprocmask"
+                                   "\0sys_rt_sigpending"
+                                   "\0sys_rt_sigtimedwait"
+                                   "\0sys_rt_sigqueueinfo"
+                                   "\0sys_rt_sigreturn"
+                                   "\0sys_setpriority"
+                                   "\0sys_getpriority"
+                                   "\0sys_reboot"
+                                   "\0sys_setregid"
+                                   "\0sys_setgid"
+                                   "\0sys_setreuid"
+                                   "\0sys_setuid"
+                                   "\0sys_setresuid"
+                                   "\0sys_getresuid"
+                                   "\0sys_setresgid"
+                                   "\0sys_getresgid"
+                                   "\0sys_setfsuid"
+                                   "\0sys_setfsgid"
+                                   "\0sys_times"
+                                   "\0sys_setpgid"
+                                   "\0sys_getpgid"
+                                   "\0sys_getsid"
+                                   "\0sys_setsid"
+                                   "\0sys_getgroups"
+                                   "\0sys_setgroups"
+                                   "\0sys_newuname"
+                                   "\0sys_sethostname"
+                                   "\0sys_setdomainname"
+                                   "\0sys_getrlimit"
+                                   "\0sys_setrlimit"
+                                   "\0sys_getrusage"
+                                   "\0sys_umask"
+                                   "\0sys_prctl"
+                                   "\0sys_getcpu"
+                                   "\0sys_gettimeofday"
+                                   "\0sys_settimeofday"
+                                   "\0sys_adjtimex"
+                                   "\0sys_getpid"
+                                   "\0sys_getppid"
+                                   "\0sys_getuid"
+                                   "\0sys_geteuid"
+                                   "\0sys_getgid"
+                                   "\0sys_getegid"
+                                   "\0sys_gettid"
+                                   "\0sys_sysinfo"
+                                   "\0sys_mq_open"
+                                   "\0sys_mq_unlink"
+                                   "\0sys_mq_timedsend"
+                                   "\0sys_mq_timedreceive"
+                                   "\0sys_mq_notify"
+                                   "\0sys_mq_getsetattr"
+                                   "\0sys_msgget"
+                                   "\0sys_msgctl"
+                                   "\0sys_msgrcv"
+                                   "\0sys_msgsnd"
+                                   "\0sys_semget"
+                                   "\0sys_semctl"
+                                   "\0sys_semtimedop"
+                                   "\0sys_semop"
+                                   "\0sys_shmget"
+                                   "\0sys_shmctl"
+                                   "\0sys_shmat"
+                                   "\0sys_shmdt"
+                                   "\0sys_socket"
+                                   "\0sys_socketpair"
+                                   "\0sys_bind"
+                                   "\0sys_listen"
+                                   "\0sys_accept"
+                                   "\0sys_connect"
+                                   "\0sys_getsockname"
+                                   "\0sys_getpeername"
+                                   "\0sys_sendto"
+                                   "\0sys_recvfrom"
+                                   "\0sys_setsockopt"
+                                   "\0sys_getsockopt"
+                                   "\0sys_shutdown"
+                                   "\0sys_sendmsg"
+                                   "\0sys_recvmsg"
+                                   "\0sys_readahead"
+                                   "\0sys_brk"
+                                   "\0sys_munmap"
+                                   "\0sys_mremap"
+                                   "\0sys_add_key"
+                                   "\0sys_request_key"
+                                   "\0sys_keyctl"
+                                   "\0sys_clone"
+                                   "\0sys_execve"
+                                   "\0sys_mmap"
+                                   "\0sys_fadvise64_64"
+                                   "\0sys_swapon"
+                                   "\0sys_swapoff"
+                                   "\0sys_mprotect"
+                                   "\0sys_msync"
+                                   "\0sys_mlock"
+                                   "\0sys_munlock"
+                                   "\0sys_mlockall"
+                                   "\0sys_munlockall"
+                                   "\0sys_mincore"
+                                   "\0sys_madvise"
+                                   "\0sys_remap_file_pages"
+                                   "\0sys_mbind"
+                                   "\0sys_get_mempolicy"
+                                   "\0sys_set_mempolicy"
+                                   "\0sys_migrate_pages"
+                                   "\0sys_move_pages"
+                                   "\0sys_rt_tgsigqueueinfo"
+                                   "\0sys_perf_event_open"
+                                   "\0sys_accept4"
+                                   "\0sys_recvmmsg"
+                                   "\0sys_wait4"
+                                   "\0sys_prlimit64"
+                                   "\0sys_fanotify_init"
+                                   "\0sys_fanotify_mark"
+                                   "\0sys_name_to_handle_at"
+                                   "\0sys_open_by_handle_at"
+                                   "\0sys_clock_adjtime"
+                                   "\0sys_syncfs"
+                                   "\0sys_setns"
+                                   "\0sys_sendmmsg"
+                                   "\0sys_process_vm_readv"
+                                   "\0sys_process_vm_writev"
+                                   "\0sys_kcmp"
+                                   "\0sys_finit_module"
+                                   "\0sys_sched_setattr"
+                                   "\0sys_sched_getattr"
+                                   "\0sys_renameat2"
+                                   "\0sys_seccomp"
+                                   "\0sys_getrandom"
+                                   "\0sys_memfd_create"
+                                   "\0sys_bpf"
+                                   "\0sys_execveat"
+                                   "\0sys_userfaultfd"
+                                   "\0sys_membarrier"
+                                   "\0sys_mlock2"
+                                   "\0sys_copy_file_range"
+                                   "\0sys_preadv2"
+                                   "\0sys_pwritev2"
+                                   "\0sys_pkey_mprotect"
+                                   "\0sys_pkey_alloc"
+                                   "\0sys_pkey_free"
+                                   "\0sys_statx"
+                                   "\0sys_io_pgetevents"
+                                   "\0sys_rseq"
+                                   "\0sys_kexec_file_load"
+                                   "\0sys_pidfd_send_signal"
+                                   "\0sys_io_uring_setup"
+                                   "\0sys_io_uring_enter"
+                                   "\0sys_io_uring_register"
+                                   "\0sys_open_tree"
+                                   "\0sys_move_mount"
+                                   "\0sys_fsopen"
+                                   "\0sys_fsconfig"
+                                   "\0sys_fsmount"
+                                   "\0sys_fspick"
+                                   "\0sys_pidfd_open"
+                                   "\0sys_clone3"
+                                   "\0sys_close_range"
+                                   "\0sys_openat2"
+                                   "\0sys_pidfd_getfd"
+                                   "\0sys_faccessat2"
+                                   "\0sys_process_madvise"
+                                   "\0sys_epoll_pwait2"
+                                   "\0sys_mount_setattr"
+                                   "\0sys_quotactl_fd"
+                                   "\0sys_landlock_create_ruleset"
+                                   "\0sys_landlock_add_rule"
+                                   "\0sys_landlock_restrict_self"
+                                   "\0sys_memfd_secret"
+                                   "\0sys_process_mrelease"
+                                   "\0sys_futex_waitv"
+                                   "\0sys_set_mempolicy_home_node"
+                                   "\0sys_cachestat"
+                                   "\0sys_fork"
+                                   "\0sys_open"
+                                   "\0sys_creat"
+                                   "\0sys_link"
+                                   "\0sys_unlink"
+                                   "\0sys_mknod"
+                                   "\0sys_chmod"
+                                   "\0sys_lchown16"
+                                   "\0sys_setuid16"
+                                   "\0sys_getuid16"
+                                   "\0sys_pause"
+                                   "\0sys_access"
+                                   "\0sys_nice"
+                                   "\0sys_rename"
+                                   "\0sys_mkdir"
+                                   "\0sys_rmdir"
+                                   "\0sys_pipe"
+                                   "\0sys_setgid16"
+                                   "\0sys_getgid16"
+                                   "\0sys_geteuid16"
+                                   "\0sys_getegid16"
+                                   "\0sys_ustat"
+                                   "\0sys_dup2"
+                                   "\0sys_getpgrp"
+                                   "\0sys_sigaction"
+                                   "\0sys_setreuid16"
+                                   "\0sys_setregid16"
+                                   "\0sys_sigsuspend"
+                                   "\0sys_sigpending"
+                                   "\0sys_getgroups16"
+                                   "\0sys_setgroups16"
+                                   "\0sys_symlink"
+                                   "\0sys_readlink"
+                                   "\0sys_uselib"
+                                   "\0sys_fchown16"
+                                   "\0sys_newstat"
+                                   "\0sys_newlstat"
+                                   "\0sys_sigreturn"
+                                   "\0sys_adjtimex_time32"
+                                   "\0sys_sigprocmask"
+                                   "\0sys_sysfs"
+                                   "\0sys_personality"
+                                   "\0sys_setfsuid16"
+                                   "\0sys_setfsgid16"
+                                   "\0sys_llseek"
+                                   "\0sys_getdents"
+                                   "\0sys_select"
+                                   "\0sys_sched_rr_get_interval_time32"
+                                   "\0sys_nanosleep_time32"
+                                   "\0sys_setresuid16"
+                                   "\0sys_getresuid16"
+                                   "\0sys_poll"
+                                   "\0sys_setresgid16"
+                                   "\0sys_getresgid16"
+                                   "\0sys_rt_sigtimedwait_time32"
+                                   "\0sys_aarch32_pread64"
+                                   "\0sys_aarch32_pwrite64"
+                                   "\0sys_chown16"
+                                   "\0sys_sendfile"
+                                   "\0sys_vfork"
+                                   "\0sys_aarch32_mmap2"
+                                   "\0sys_aarch32_truncate64"
+                                   "\0sys_aarch32_ftruncate64"
+                                   "\0sys_stat64"
+                                   "\0sys_lstat64"
+                                   "\0sys_fstat64"
+                                   "\0sys_lchown"
+                                   "\0sys_chown"
+                                   "\0sys_fcntl64"
+                                   "\0sys_aarch32_readahead"
+                                   "\0sys_futex_time32"
+                                   "\0sys_io_getevents_time32"
+                                   "\0sys_epoll_create"
+                                   "\0sys_epoll_wait"
+                                   "\0sys_timer_settime32"
+                                   "\0sys_timer_gettime32"
+                                   "\0sys_clock_settime32"
+                                   "\0sys_clock_gettime32"
+                                   "\0sys_clock_getres_time32"
+                                   "\0sys_clock_nanosleep_time32"
+                                   "\0sys_aarch32_statfs64"
+                                   "\0sys_aarch32_fstatfs64"
+                                   "\0sys_utimes_time32"
+                                   "\0sys_aarch32_fadvise64_64"
+                                   "\0sys_pciconfig_read"
+                                   "\0sys_pciconfig_write"
+                                   "\0sys_mq_timedsend_time32"
+                                   "\0sys_mq_timedreceive_time32"
+                                   "\0sys_send"
+                                   "\0sys_recv"
+                                   "\0sys_old_semctl"
+                                   "\0sys_old_msgctl"
+                                   "\0sys_old_shmctl"
+                                   "\0sys_semtimedop_time32"
+                                   "\0sys_inotify_init"
+                                   "\0sys_futimesat_time32"
+                                   "\0sys_fstatat64"
+                                   "\0sys_pselect6_time32"
+                                   "\0sys_ppoll_time32"
+                                   "\0sys_aarch32_sync_file_range2"
+                                   "\0sys_utimensat_time32"
+                                   "\0sys_signalfd"
+                                   "\0sys_eventfd"
+                                   "\0sys_aarch32_fallocate"
+                                   "\0sys_timerfd_settime32"
+                                   "\0sys_timerfd_gettime32"
+                                   "\0sys_recvmmsg_time32"
+                                   "\0sys_clock_adjtime32"
+                                   "\0sys_pselect6_time64"
+                                   "\0sys_ppoll_time64"
+                                   "\0sys_recvmmsg_time64"
+                                   "\0sys_rt_sigtimedwait_time64"
+                                   "\0";
+
+static const uint16_t syscall_name_offs[SYSCALL_NAME_TABLE_SIZE] = {
+    [0] = 1,
+    [1] = 14,
+    [2] = 29,
+    [3] = 43,
+    [4] = 57,
+    [5] = 74,
+    [6] = 87,
+    [7] = 101,
+    [8] = 115,
+    [9] = 128,
+    [10] = 142,
+    [11] = 156,
+    [12] = 170,
+    [13] = 185,
+    [14] = 200,
+    [15] = 216,
+    [16] = 233,
+    [17] = 250,
+    [19] = 261,
+    [20] = 274,
+    [21] = 292,
+    [22] = 306,
+    [23] = 322,
+    [24] = 330,
+    [25] = 339,
+    [26] = 349,
+    [27] = 367,
+    [28] = 389,
+    [29] = 410,
+    [30] = 420,
+    [31] = 435,
+    [32] = 450,
+    [33] = 460,
+    [34] = 472,
+    [35] = 484,
+    [36] = 497,
+    [37] = 511,
+    [38] = 522,
+    [39] = 535,
+    [40] = 546,
+    [41] = 556,
+    [43] = 571,
+    [44] = 582,
+    [45] = 594,
+    [46] = 607,
+    [47] = 621,
+    [48] = 635,
+    [49] = 649,
+    [50] = 659,
+    [51] = 670,
+    [52] = 681,
+    [53] = 692,
+    [54] = 705,
+    [55] = 718,
+    [56] = 729,
+    [57] = 740,
+    [58] = 750,
+    [59] = 762,
+    [60] = 772,
+    [61] = 785,
+    [62] = 800,
+    [63] = 810,
+    [64] = 819,
+    [65] = 829,
+    [66] = 839,
+    [67] = 850,
+    [68] = 862,
+    [69] = 875,
+    [70] = 886,
+    [71] = 898,
+    [72] = 913,
+    [73] = 926,
+    [74] = 936,
+    [75] = 950,
+    [76] = 963,
+    [77] = 974,
+    [78] = 982,
+    [79] = 997,
+    [80] = 1012,
+    [81] = 1025,
+    [82] = 1034,
+    [83] = 1044,
+    [84] = 1058,
+    [85] = 1078,
+    [86] = 1097,
+    [87] = 1117,
+    [88] = 1137,
+    [89] = 1151,
+    [90] = 1160,
+    [91] = 1171,
+    [92] = 1182,
+    [93] = 1204,
+    [94] = 1213,
+    [95] = 1228,
+    [96] = 1239,
+    [97] = 1259,
+    [98] = 1271,
+    [99] = 1281,
+    [100] = 1301,
+    [101] = 1321,
+    [102] = 1335,
+    [103] = 1349,
+    [104] = 1363,
+    [105] = 1378,
+    [106] = 1394,
+    [107] = 1412,
+    [108] = 1429,
+    [109] = 1447,
+    [110] = 1468,
+    [111] = 1486,
+    [112] = 1503,
+    [113] = 1521,
+    [114] = 1539,
+    [115] = 1556,
+    [116] = 1576,
+    [117] = 1587,
+    [118] = 1598,
+    [119] = 1617,
+    [120] = 1640,
+    [121] = 1663,
+    [122] = 1682,
+    [123] = 1704,
+    [124] = 1726,
+    [125] = 1742,
+    [126] = 1769,
+    [127] = 1796,
+    [128] = 1822,
+    [129] = 1842,
+    [130] = 1851,
+    [131] = 1861,
+    [132] = 1872,
+    [133] = 1888,
+    [134] = 1906,
+    [135] = 1923,
+    [136] = 1942,
+    [137] = 1960,
+    [138] = 1980,
+    [139] = 2000,
+    [140] = 2017,
+    [141] = 2033,
+    [142] = 2049,
+    [143] = 2060,
+    [144] = 2073,
+    [145] = 2084,
+    [146] = 2097,
+    [147] = 2108,
+    [148] = 2122,
+    [149] = 2136,
+    [150] = 2150,
+    [151] = 2164,
+    [152] = 2177,
+    [153] = 2190,
+    [154] = 2200,
+    [155] = 2212,
+    [156] = 2224,
+    [157] = 2235,
+    [158] = 2246,
+    [159] = 2260,
+    [160] = 2274,
+    [161] = 2287,
+    [162] = 2303,
+    [163] = 2321,
+    [164] = 2335,
+    [165] = 2349,
+    [166] = 2363,
+    [167] = 2373,
+    [168] = 2383,
+    [169] = 2394,
+    [170] = 2411,
+    [171] = 2428,
+    [172] = 2441,
+    [173] = 2452,
+    [174] = 2464,
+    [175] = 2475,
+    [176] = 2487,
+    [177] = 2498,
+    [178] = 2510,
+    [179] = 2521,
+    [180] = 2533,
+    [181] = 2545,
+    [182] = 2559,
+    [183] = 2576,
+    [184] = 2596,
+    [185] = 2610,
+    [186] = 2628,
+    [187] = 2639,
+    [188] = 2650,
+    [189] = 2661,
+    [190] = 2672,
+    [191] = 2683,
+    [192] = 2694,
+    [193] = 2709,
+    [194] = 2719,
+    [195] = 2730,
+    [196] = 2741,
+    [197] = 2751,
+    [198] = 2761,
+    [199] = 2772,
+    [200] = 2787,
+    [201] = 2796,
+    [202] = 2807,
+    [203] = 2818,
+    [204] = 2830,
+    [205] = 2846,
+    [206] = 2862,
+    [207] = 2873,
+    [208] = 2886,
+    [209] = 2901,
+    [210] = 2916,
+    [211] = 2929,
+    [212] = 2941,
+    [213] = 2953,
+    [214] = 2967,
+    [215] = 2975,
+    [216] = 2986,
+    [217] = 2997,
+    [218] = 3009,
+    [219] = 3025,
+    [220] = 3036,
+    [221] = 3046,
+    [222] = 3057,
+    [223] = 3066,
+    [224] = 3083,
+    [225] = 3094,
+    [226] = 3106,
+    [227] = 3119,
+    [228] = 3129,
+    [229] = 3139,
+    [230] = 3151,
+    [231] = 3164,
+    [232] = 3179,
+    [233] = 3191,
+    [234] = 3203,
+    [235] = 3224,
+    [236] = 3234,
+    [237] = 3252,
+    [238] = 3270,
+    [239] = 3288,
+    [240] = 3303,
+    [241] = 3325,
+    [242] = 3345,
+    [243] = 3357,
+    [260] = 3370,
+    [261] = 3380,
+    [262] = 3394,
+    [263] = 3412,
+    [264] = 3430,
+    [265] = 3452,
+    [266] = 3474,
+    [267] = 3492,
+    [268] = 3503,
+    [269] = 3513,
+    [270] = 3526,
+    [271] = 3547,
+    [272] = 3569,
+    [273] = 3578,
+    [274] = 3595,
+    [275] = 3613,
+    [276] = 3631,
+    [277] = 3645,
+    [278] = 3657,
+    [279] = 3671,
+    [280] = 3688,
+    [281] = 3696,
+    [282] = 3709,
+    [283] = 3725,
+    [284] = 3740,
+    [285] = 3751,
+    [286] = 3771,
+    [287] = 3783,
+    [288] = 3796,
+    [289] = 3814,
+    [290] = 3829,
+    [291] = 3843,
+    [292] = 3853,
+    [293] = 3871,
+    [294] = 3880,
+    [424] = 3900,
+    [425] = 3922,
+    [426] = 3941,
+    [427] = 3960,
+    [428] = 3982,
+    [429] = 3996,
+    [430] = 4011,
+    [431] = 4022,
+    [432] = 4035,
+    [433] = 4047,
+    [434] = 4058,
+    [435] = 4073,
+    [436] = 4084,
+    [437] = 4100,
+    [438] = 4112,
+    [439] = 4128,
+    [440] = 4143,
+    [441] = 4163,
+    [442] = 4180,
+    [443] = 4198,
+    [444] = 4214,
+    [445] = 4242,
+    [446] = 4264,
+    [447] = 4291,
+    [448] = 4308,
+    [449] = 4329,
+    [450] = 4345,
+    [451] = 4373,
+};
+
+static const uint16_t compat_syscall_name_offs[SYSCALL_NAME_TABLE_SIZE] = {
+    [0] = 1822,
+    [1] = 1204,
+    [2] = 4387,
+    [3] = 810,
+    [4] = 819,
+    [5] = 4396,
+    [6] = 740,
+    [8] = 4405,
+    [9] = 4415,
+    [10] = 4424,
+    [11] = 3046,
+    [12] = 649,
+    [14] = 4435,
+    [15] = 4445,
+    [16] = 4455,
+    [19] = 800,
+    [20] = 2441,
+    [21] = 546,
+    [23] = 4468,
+    [24] = 4481,
+    [26] = 1587,
+    [29] = 4494,
+    [33] = 4504,
+    [34] = 4515,
+    [36] = 1025,
+    [37] = 1842,
+    [38] = 4524,
+    [39] = 4535,
+    [40] = 4545,
+    [41] = 322,
+    [42] = 4555,
+    [43] = 2190,
+    [45] = 2967,
+    [46] = 4564,
+    [47] = 4577,
+    [49] = 4590,
+    [50] = 4604,
+    [51] = 1151,
+    [52] = 535,
+    [54] = 410,
+    [55] = 339,
+    [57] = 2200,
+    [60] = 2363,
+    [61] = 670,
+    [62] = 4618,
+    [63] = 4628,
+    [64] = 2452,
+    [65] = 4637,
+    [66] = 2235,
+    [67] = 4649,
+    [70] = 4663,
+    [71] = 4678,
+    [72] = 4693,
+    [73] = 4708,
+    [74] = 2287,
+    [75] = 2335,
+    [77] = 2349,
+    [78] = 2394,
+    [79] = 2411,
+    [80] = 4723,
+    [81] = 4739,
+    [83] = 4755,
+    [85] = 4767,
+    [86] = 4780,
+    [87] = 3083,
+    [88] = 2049,
+    [91] = 2975,
+    [92] = 594,
+    [93] = 607,
+    [94] = 681,
+    [95] = 4791,
+    [96] = 2033,
+    [97] = 2017,
+    [99] = 571,
+    [100] = 582,
+    [103] = 1576,
+    [104] = 1349,
+    [105] = 1335,
+    [106] = 4804,
+    [107] = 4816,
+    [108] = 1012,
+    [111] = 750,
+    [114] = 3370,
+    [115] = 3094,
+    [116] = 2521,
+    [118] = 1034,
+    [119] = 4829,
+    [120] = 3036,
+    [121] = 2303,
+    [122] = 2274,
+    [124] = 4843,
+    [125] = 3106,
+    [126] = 4863,
+    [128] = 1378,
+    [129] = 1394,
+    [131] = 772,
+    [132] = 2212,
+    [133] = 659,
+    [135] = 4879,
+    [136] = 4889,
+    [138] = 4905,
+    [139] = 4920,
+    [140] = 4935,
+    [141] = 4946,
+    [142] = 4959,
+    [143] = 450,
+    [144] = 3119,
+    [145] = 829,
+    [146] = 839,
+    [147] = 2224,
+    [148] = 1044,
+    [150] = 3129,
+    [151] = 3139,
+    [152] = 3151,
+    [153] = 3164,
+    [154] = 1598,
+    [155] = 1663,
+    [156] = 1617,
+    [157] = 1640,
+    [158] = 1726,
+    [159] = 1742,
+    [160] = 1769,
+    [161] = 4970,
+    [162] = 5003,
+    [163] = 2986,
+    [164] = 5024,
+    [165] = 5040,
+    [168] = 5056,
+    [170] = 5065,
+    [171] = 5081,
+    [172] = 2373,
+    [173] = 2000,
+    [174] = 1906,
+    [175] = 1923,
+    [176] = 1942,
+    [177] = 5097,
+    [178] = 1980,
+    [179] = 1888,
+    [180] = 5124,
+    [181] = 5144,
+    [182] = 5165,
+    [183] = 250,
+    [184] = 1160,
+    [185] = 1171,
+    [186] = 1872,
+    [187] = 5177,
+    [190] = 5190,
+    [191] = 2321,
+    [192] = 5200,
+    [193] = 5218,
+    [194] = 5241,
+    [195] = 5265,
+    [196] = 5276,
+    [197] = 5288,
+    [198] = 5300,
+    [199] = 2464,
+    [200] = 2487,
+    [201] = 2475,
+    [202] = 2498,
+    [203] = 2084,
+    [204] = 2060,
+    [205] = 2246,
+    [206] = 2260,
+    [207] = 718,
+    [208] = 2108,
+    [209] = 2122,
+    [210] = 2136,
+    [211] = 2150,
+    [212] = 5311,
+    [213] = 2097,
+    [214] = 2073,
+    [215] = 2164,
+    [216] = 2177,
+    [217] = 785,
+    [218] = 556,
+    [219] = 3179,
+    [220] = 3191,
+    [221] = 5321,
+    [224] = 2510,
+    [225] = 5333,
+    [226] = 74,
+    [227] = 87,
+    [228] = 101,
+    [229] = 115,
+    [230] = 128,
+    [231] = 142,
+    [232] = 156,
+    [233] = 170,
+    [234] = 185,
+    [235] = 200,
+    [236] = 216,
+    [237] = 233,
+    [238] = 1851,
+    [239] = 898,
+    [240] = 5355,
+    [241] = 1682,
+    [242] = 1704,
+    [243] = 1,
+    [244] = 14,
+    [245] = 5372,
+    [246] = 29,
+    [247] = 43,
+    [248] = 1213,
+    [250] = 5396,
+    [251] = 292,
+    [252] = 5413,
+    [253] = 3203,
+    [256] = 1239,
+    [257] = 1412,
+    [258] = 5428,
+    [259] = 5448,
+    [260] = 1447,
+    [261] = 1486,
+    [262] = 5468,
+    [263] = 5488,
+    [264] = 5508,
+    [265] = 5532,
+    [266] = 5559,
+    [267] = 5580,
+    [268] = 1861,
+    [269] = 5602,
+    [270] = 5620,
+    [272] = 5645,
+    [273] = 5664,
+    [274] = 2533,
+    [275] = 2545,
+    [276] = 5684,
+    [277] = 5708,
+    [278] = 2596,
+    [279] = 2610,
+    [280] = 1228,
+    [281] = 2761,
+    [282] = 2787,
+    [283] = 2818,
+    [284] = 2796,
+    [285] = 2807,
+    [286] = 2830,
+    [287] = 2846,
+    [288] = 2772,
+    [289] = 5735,
+    [290] = 2862,
+    [291] = 5744,
+    [292] = 2873,
+    [293] = 2916,
+    [294] = 2886,
+    [295] = 2901,
+    [296] = 2929,
+    [297] = 2941,
+    [298] = 2709,
+    [299] = 2672,
+    [300] = 5753,
+    [301] = 2661,
+    [302] = 2650,
+    [303] = 2628,
+    [304] = 5768,
+    [305] = 2741,
+    [306] = 2751,
+    [307] = 2719,
+    [308] = 5783,
+    [309] = 2997,
+    [310] = 3009,
+    [311] = 3025,
+    [312] = 5798,
+    [314] = 420,
+    [315] = 435,
+    [316] = 5820,
+    [317] = 367,
+    [318] = 389,
+    [319] = 3224,
+    [320] = 3234,
+    [321] = 3252,
+    [322] = 729,
+    [323] = 472,
+    [324] = 460,
+    [325] = 705,
+    [326] = 5837,
+    [327] = 5858,
+    [328] = 484,
+    [329] = 522,
+    [330] = 511,
+    [331] = 497,
+    [332] = 982,
+    [333] = 692,
+    [334] = 635,
+    [335] = 5872,
+    [336] = 5892,
+    [337] = 1259,
+    [338] = 1281,
+    [339] = 1301,
+    [340] = 963,
+    [341] = 5909,
+    [342] = 974,
+    [343] = 950,
+    [344] = 3288,
+    [345] = 2383,
+    [346] = 306,
+    [347] = 1363,
+    [348] = 5938,
+    [349] = 5959,
+    [350] = 1078,
+    [351] = 5972,
+    [352] = 5984,
+    [353] = 6006,
+    [354] = 6028,
+    [355] = 936,
+    [356] = 261,
+    [357] = 274,
+    [358] = 330,
+    [359] = 762,
+    [360] = 349,
+    [361] = 875,
+    [362] = 886,
+    [363] = 3303,
+    [364] = 3325,
+    [365] = 6050,
+    [366] = 3345,
+    [367] = 3394,
+    [368] = 3412,
+    [369] = 3380,
+    [370] = 3430,
+    [371] = 3452,
+    [372] = 6070,
+    [373] = 3492,
+    [374] = 3513,
+    [375] = 3503,
+    [376] = 3526,
+    [377] = 3547,
+    [378] = 3569,
+    [379] = 3578,
+    [380] = 3595,
+    [381] = 3613,
+    [382] = 3631,
+    [383] = 3645,
+    [384] = 3657,
+    [385] = 3671,
+    [386] = 3688,
+    [387] = 3696,
+    [388] = 3709,
+    [389] = 3725,
+    [390] = 3740,
+    [391] = 3751,
+    [392] = 3771,
+    [393] = 3783,
+    [394] = 3796,
+    [395] = 3814,
+    [396] = 3829,
+    [397] = 3843,
+    [398] = 3871,
+    [399] = 3853,
+    [400] = 3270,
+    [401] = 3880,
+    [403] = 1521,
+    [404] = 1503,
+    [405] = 3474,
+    [406] = 1539,
+    [407] = 1556,
+    [408] = 1429,
+    [409] = 1468,
+    [410] = 1117,
+    [411] = 1097,
+    [412] = 1137,
+    [413] = 6090,
+    [414] = 6110,
+    [416] = 3853,
+    [417] = 6127,
+    [418] = 2559,
+    [419] = 2576,
+    [420] = 2694,
+    [421] = 6147,
+    [422] = 1271,
+    [423] = 1796,
+    [424] = 3900,
+    [425] = 3922,
+    [426] = 3941,
+    [427] = 3960,
+    [428] = 3982,
+    [429] = 3996,
+    [430] = 4011,
+    [431] = 4022,
+    [432] = 4035,
+    [433] = 4047,
+    [434] = 4058,
+    [435] = 4073,
+    [436] = 4084,
+    [437] = 4100,
+    [438] = 4112,
+    [439] = 4128,
+    [440] = 4143,
+    [441] = 4163,
+    [442] = 4180,
+    [443] = 4198,
+    [444] = 4214,
+    [445] = 4242,
+    [446] = 4264,
+    [448] = 4308,
+    [449] = 4329,
+    [450] = 4345,
+    [451] = 4373,
+};
@@ -8,6 +8,7 @@
 #include <hook.h>
 #include <common.h>
 #include <log.h>
+#include <kpmalloc.h>
 #include <predata.h>
 #include <pgtable.h>
 #include <linux/syscall.h>
@@ -64,6 +65,38 @@ static long call_klog(const char __user *arg1)
     return 0;
 }
 
+static long call_klog_read(uint64_t __user *useq, void __user *out, int outlen)
+{
+    uint64_t seq;
+    if (outlen <= 0) return -EINVAL;
+    if (compat_copy_from_user(&seq, useq, sizeof(seq)) != sizeof(seq)) return -EFAULT;
+    // each chunk fits the largest entry, kept off the stack
+    char *buf = kp_malloc(KP_LOG_ENTRY_MAX);
+    if (!buf) return -ENOMEM;
+    int copied = 0;
+    long rc = 0;
+    while (copied < outlen) {
+        int chunk = outlen - copied < KP_LOG_ENTRY_MAX ? outlen - copied : KP_LOG_ENTRY_MAX;
+        int len = kp_log_read(&seq, buf, chunk);
+        if (len <= 0) break;
+        if (compat_copy_to_user(out + copied, buf, len) != len) {
+            rc = -EFAULT;
+            break;
+        }
+        copied += len;
+    }
+    kp_free(buf);
+    if (rc) return rc;
+    if (compat_copy_to_user(useq, &seq, sizeof(seq)) != sizeof(seq)) return -EFAULT;
+    return copied;
+}
+
+static long call_klog_level(int ring_level, int console_level)
+{
+    kp_log_set_level(ring_level, console_level);
+    return 0;
+}
+
 static long call_buildtime(char __user *out_buildtime, int u_len)
 {
     const char *buildtime = get_build_time();
@@ -240,6 +273,16 @@ static long call_su_set_allow_sctx(char *__user usctx)
     return set_all_allow_sctx(buf);
 }
 
+static long call_sel_stats(struct sel_stats *__user out, int reset)
+{
+    struct sel_stats stats;
+    get_sel_stats(&stats);
+    if (reset) reset_sel_stats();
+    if (!out) return 0;
+    int rc = compat_copy_to_user(out, &stats, sizeof(stats));
+    return rc < 0 ? rc : 0;
+}
+
 static long call_kstorage_read(int gid, long did, void *out_data, int offset, int dlen)
 {
     return read_kstorage(gid, did, out_data, offset, dlen, true);
@@ -340,6 +383,10 @@ static long supercall(int is_key_auth, long cmd, long arg1, long arg2, long arg3
     case SUPERCALL_SKEY_ROOT_ENABLE:
         return call_skey_root_enable((int)arg1);
         break;
+    case SUPERCALL_KLOG_READ:
+        return call_klog_read((uint64_t __user *)arg1, (void __user *)arg2, (int)arg3);
+    case SUPERCALL_KLOG_LEVEL:
+        return call_klog_level((int)arg1, (int)arg2);
     }
 
     switch (cmd) {
@@ -358,6 +405,8 @@ static long supercall(int is_key_auth, long cmd, long arg1, long arg2, long arg3
     }
 
     switch (cmd) {
+    case SUPERCALL_SEL_STATS:
+        return call_sel_stats((struct sel_stats *__user)arg1, (int)arg2);
     default:
         break;
     }
@@ -49,9 +49,8 @@ static void supercmd_echo(char **__user u_filename_p, char **__user uargv, uintp
     const char *__user cmd = supercmd_str_to_user_sp(ECHO_PATH, sp);
     const char *__user argv1 = supercmd_str_to_user_sp(buffer, sp);
 
-    set_user_arg_ptr(0, *uargv, 0, (uintptr_t)cmd);
-    set_user_arg_ptr(0, *uargv, 1, (uintptr_t)argv1);
-    set_user_arg_ptr(0, *uargv, 2, 0);
+    uintptr_t uargs[] = { (uintptr_t)cmd, (uintptr_t)argv1, 0 };
+    set_user_arg_ptrs(0, *uargv, 0, uargs, 3);
 }
 
 static const char supercmd_help[] =
@@ -349,10 +348,11 @@ void handle_supercmd(char **__user u_filename_p, char **__user uargv)
     // copy args
     const char *parr[SUPERCMD_ARGS_NO + 4] = { 0 };
 
-    for (int i = 2; i < SUPERCMD_ARGS_NO; i++) {
-        const char __user *ua = get_user_arg_ptr(0, *uargv, i);
-        if (IS_ERR(ua)) break;
-        const char *a = strndup_user(ua, 512);
+    const char __user *uparr[SUPERCMD_ARGS_NO] = { 0 };
+    int uargc = get_user_arg_ptrs(0, *uargv, 2, uparr + 2, SUPERCMD_ARGS_NO - 2);
+
+    for (int i = 2; i < uargc + 2; i++) {
+        const char *a = strndup_user(uparr[i], 512);
         if (IS_ERR(a)) break;
         parr[i] = a;
         // ignore after -c
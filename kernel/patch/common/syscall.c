@@ -52,45 +52,108 @@ struct user_arg_ptr_compat
 };
 
 // actually, a0 is true if it is compat
-const char __user *get_user_arg_ptr(void *a0, void *a1, int nr)
+static inline uintptr_t user_arg_base(void *a0, void *a1, int *size)
 {
-    char __user *const __user *native = (char __user *const __user *)a0;
-    int size = 8;
+    uintptr_t native = (uintptr_t)a0;
+    *size = 8;
     if (has_config_compat) {
-        native = (char __user *const __user *)a1;
-        if (a0) size = 4; // compat
+        native = (uintptr_t)a1;
+        if (a0) *size = 4; // compat
     }
-    native = (char __user *const __user *)((unsigned long)native + nr * size);
-    char __user **upptr = memdup_user(native, size);
-    if (IS_ERR(upptr)) return ERR_PTR((long)upptr);
+    return native;
+}
 
-    char __user *uptr;
-    if (size == 8) {
-        uptr = *upptr;
-    } else {
-        uptr = (char __user *)(unsigned long)*(int32_t *)upptr;
+int get_user_arg_ptrs(void *a0, void *a1, int start, const char __user **out, int n)
+{
+    if (n <= 0) return 0;
+    int size = 0;
+    uintptr_t native = user_arg_base(a0, a1, &size) + start * size;
+
+    // compat pointers are copied packed into the front of out and widened in place below
+    int cplen = compat_copy_from_user((void *)out, (const void __user *)native, n * size);
+    if (cplen < 0) {
+        // the batch may run off the end of the mapping, fetch one by one
+        for (cplen = 0; cplen < n * size; cplen += size) {
+            int rc = compat_copy_from_user((char *)out + cplen, (const void __user *)(native + cplen), size);
+            if (rc < 0) break;
+        }
+        if (!cplen) return -EFAULT;
+    }
+
+    int got = cplen / size;
+    if (size == 4) {
+        for (int i = got - 1; i >= 0; i--) {
+            out[i] = (const char __user *)(unsigned long)((uint32_t *)out)[i];
+        }
     }
-    kfree(upptr);
+    for (int i = 0; i < got; i++) {
+        if (!out[i]) return i;
+    }
+    return got;
+}
+KP_EXPORT_SYMBOL(get_user_arg_ptrs);
+
+int get_user_arg_strs(void *a0, void *a1, int start, const char **out, int n, char *arena, int arena_len)
+{
+    int got = get_user_arg_ptrs(a0, a1, start, (const char __user **)out, n);
+    if (got <= 0) return got;
+
+    int off = 0;
+    for (int i = 0; i < got; i++) {
+        int left = arena_len - off;
+        if (left <= 0) return i;
+        long len = compat_strncpy_from_user(arena + off, (const char __user *)out[i], left);
+        if (len <= 0) return i;
+        // truncated, leave it to the next call unless nothing fits at all
+        if (len >= left && i) return i;
+        out[i] = arena + off;
+        off += len;
+    }
+    return got;
+}
+KP_EXPORT_SYMBOL(get_user_arg_strs);
+
+const char __user *get_user_arg_ptr(void *a0, void *a1, int nr)
+{
+    const char __user *uptr = 0;
+    int rc = get_user_arg_ptrs(a0, a1, nr, &uptr, 1);
+    if (rc < 0) return ERR_PTR(rc);
     return uptr;
 }
 
 int set_user_arg_ptr(void *a0, void *a1, int nr, uintptr_t val)
 {
     uintptr_t valp = (uintptr_t)&val;
-    char __user *const __user *native = (char __user *const __user *)a0;
-    int size = 8;
-    if (has_config_compat) {
-        native = (char __user *const __user *)a1;
-        if (a0) {
-            size = 4; // compat
-            valp += 4;
-        }
-    }
-    native = (char __user *const __user *)((unsigned long)native + nr * size);
+    int size = 0;
+    uintptr_t native = user_arg_base(a0, a1, &size) + nr * size;
+    if (size == 4) valp += 4;
     int cplen = compat_copy_to_user((void *)native, (void *)valp, size);
     return cplen == size ? 0 : cplen;
 }
 
+int set_user_arg_ptrs(void *a0, void *a1, int start, const uintptr_t *vals, int n)
+{
+    if (n <= 0) return 0;
+    int size = 0;
+    uintptr_t native = user_arg_base(a0, a1, &size) + start * size;
+    if (size == 8) {
+        int cplen = compat_copy_to_user((void *)native, vals, n * size);
+        return cplen == n * size ? 0 : cplen;
+    }
+    uint32_t packed[USER_ARG_BATCH_MAX];
+    for (int done = 0; done < n;) {
+        int cnt = n - done > USER_ARG_BATCH_MAX ? USER_ARG_BATCH_MAX : n - done;
+        for (int i = 0; i < cnt; i++) {
+            packed[i] = (uint32_t)vals[done + i];
+        }
+        int cplen = compat_copy_to_user((void *)(native + done * size), packed, cnt * size);
+        if (cplen != cnt * size) return cplen;
+        done += cnt;
+    }
+    return 0;
+}
+KP_EXPORT_SYMBOL(set_user_arg_ptrs);
+
 typedef long (*warp_raw_syscall_f)(const struct pt_regs *regs);
 typedef long (*raw_syscall0_f)();
 typedef long (*raw_syscall1_f)(long arg0);
@@ -100,47 +163,135 @@ typedef long (*raw_syscall4_f)(long arg0, long arg1, long arg2, long arg3);
 typedef long (*raw_syscall5_f)(long arg0, long arg1, long arg2, long arg3, long arg4);
 typedef long (*raw_syscall6_f)(long arg0, long arg1, long arg2, long arg3, long arg4, long arg5);
 
-uintptr_t syscalln_name_addr(int nr, int is_compat)
+// set once the name tables hold every address kallsyms has, misses are final then
+static int syscall_addrs_resolved = 0;
+static uint8_t syscall_addr_rank[2][SYSCALL_NAME_TABLE_SIZE] = { 0 };
+
+#define SYSCALL_NAME_HASH_BITS 10
+#define SYSCALL_NAME_NONE 0xffff
+
+// name hash -> entry (is_compat * SYSCALL_NAME_TABLE_SIZE + nr), chained through syscall_name_next
+static uint16_t syscall_name_bucket[1 << SYSCALL_NAME_HASH_BITS];
+static uint16_t syscall_name_next[2 * SYSCALL_NAME_TABLE_SIZE];
+
+static const char *const syscall_sym_prefix[] = { "__arm64_", "" };
+static const char *const syscall_sym_suffix[] = { ".cfi_jt", ".cfi", "" };
+
+#define SYSCALL_SYM_RANK_NONE 0xff
+
+static inline struct syscall_name_entry *syscall_name_entry(int nr, int is_compat)
 {
-    const char *name = 0;
-    if (!is_compat) {
-        if (syscall_name_table[nr].addr) {
-            return syscall_name_table[nr].addr;
+    return is_compat ? &compat_syscall_name_table[nr] : &syscall_name_table[nr];
+}
+
+static inline uint32_t syscall_name_hash(const char *name, int len)
+{
+    uint32_t hash = 5381;
+    for (int i = 0; i < len; i++) {
+        hash = ((hash << 5) + hash) + name[i];
+    }
+    return hash & ((1 << SYSCALL_NAME_HASH_BITS) - 1);
+}
+
+static void syscall_name_index_init()
+{
+    for (int i = 0; i < sizeof(syscall_name_bucket) / sizeof(syscall_name_bucket[0]); i++) {
+        syscall_name_bucket[i] = SYSCALL_NAME_NONE;
+    }
+    for (int e = 2 * SYSCALL_NAME_TABLE_SIZE - 1; e >= 0; e--) {
+        int is_compat = e / SYSCALL_NAME_TABLE_SIZE;
+        int nr = e % SYSCALL_NAME_TABLE_SIZE;
+        syscall_addr_rank[is_compat][nr] = SYSCALL_SYM_RANK_NONE;
+        const char *name = syscall_name_entry(nr, is_compat)->name;
+        if (!name) continue;
+        uint32_t hash = syscall_name_hash(name, strlen(name));
+        syscall_name_next[e] = syscall_name_bucket[hash];
+        syscall_name_bucket[hash] = e;
+    }
+}
+
+/*
+ * Strip one of syscall_sym_prefix and syscall_sym_suffix, the rank is the order the per name lookup tries them,
+ * lower is preferred.
+ */
+static int syscall_sym_match(void *data, const char *name, struct module *m, unsigned long addr)
+{
+    int p = 1;
+    if (name[0] == '_' && !strncmp(name, syscall_sym_prefix[0], 8)) {
+        name += 8;
+        p = 0;
+    }
+    if (name[0] != 's' || name[1] != 'y' || name[2] != 's' || name[3] != '_') return 0;
+
+    int len = 4;
+    while (name[len] && name[len] != '.')
+        len++;
+    int s = 2;
+    if (name[len]) {
+        if (!strcmp(name + len, syscall_sym_suffix[0])) {
+            s = 0;
+        } else if (!strcmp(name + len, syscall_sym_suffix[1])) {
+            s = 1;
+        } else {
+            return 0;
         }
-        name = syscall_name_table[nr].name;
-    } else {
-        if (compat_syscall_name_table[nr].addr) {
-            return compat_syscall_name_table[nr].addr;
+    }
+    uint8_t rank = p * 3 + s;
+
+    for (uint16_t e = syscall_name_bucket[syscall_name_hash(name, len)]; e != SYSCALL_NAME_NONE;
+         e = syscall_name_next[e]) {
+        int is_compat = e / SYSCALL_NAME_TABLE_SIZE;
+        int nr = e % SYSCALL_NAME_TABLE_SIZE;
+        struct syscall_name_entry *entry = syscall_name_entry(nr, is_compat);
+        if (strncmp(entry->name, name, len) || entry->name[len]) continue;
+        if (rank < syscall_addr_rank[is_compat][nr]) {
+            entry->addr = addr;
+            syscall_addr_rank[is_compat][nr] = rank;
         }
-        name = compat_syscall_name_table[nr].name;
     }
+    return 0;
+}
 
-    if (!name) return 0;
+static int syscall_sym_match_nomod(void *data, const char *name, unsigned long addr)
+{
+    return syscall_sym_match(data, name, 0, addr);
+}
 
-    const char *prefix[2];
-    prefix[0] = "__arm64_";
-    prefix[1] = "";
-    const char *suffix[3];
-    suffix[0] = ".cfi_jt";
-    suffix[1] = ".cfi";
-    suffix[2] = "";
+/*
+ * Fill both name tables in one kallsyms pass. Under kCFI the kernel can't call back into us until bypass_kcfi,
+ * so syscall_init leaves it to before_rest_init then.
+ */
+void syscall_resolve_names()
+{
+    if (syscall_addrs_resolved || !kallsyms_on_each_symbol) return;
+    if (kver >= VERSION(6, 4, 0)) {
+        // the module parameter of the callback was dropped in 6.4
+        kallsyms_on_each_symbol((typeof(syscall_sym_match) *)syscall_sym_match_nomod, 0);
+    } else {
+        kallsyms_on_each_symbol(syscall_sym_match, 0);
+    }
+    syscall_addrs_resolved = 1;
+    log_boot("syscall names resolved\n");
+}
 
-    uintptr_t addr = 0;
+uintptr_t syscalln_name_addr(int nr, int is_compat)
+{
+    if (nr < 0 || nr >= SYSCALL_NAME_TABLE_SIZE) return 0;
+    struct syscall_name_entry *entry = syscall_name_entry(nr, !!is_compat);
+    if (entry->addr || syscall_addrs_resolved || !entry->name) return entry->addr;
 
+    // no kallsyms_on_each_symbol, or called before bypass_kcfi, look this one up by name
+    uintptr_t addr = 0;
     char buffer[256];
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 3; j++) {
-            snprintf(buffer, sizeof(buffer), "%s%s%s", prefix[i], name, suffix[j]);
+            snprintf(buffer, sizeof(buffer), "%s%s%s", syscall_sym_prefix[i], entry->name, syscall_sym_suffix[j]);
             addr = kallsyms_lookup_name(buffer);
             if (addr) break;
         }
         if (addr) break;
     }
-    if (!is_compat) {
-        syscall_name_table[nr].addr = addr;
-    } else {
-        compat_syscall_name_table[nr].addr = addr;
-    }
+    entry->addr = addr;
     return addr;
 }
 KP_EXPORT_SYMBOL(syscalln_name_addr);
@@ -347,14 +498,14 @@ KP_EXPORT_SYMBOL(unhook_compat_syscalln);
 
 void syscall_init()
 {
-    for (int i = 0; i < sizeof(syscall_name_table) / sizeof(syscall_name_table[0]); i++) {
-        uintptr_t *addr = (uintptr_t *)&syscall_name_table[i].name;
-        *addr = link2runtime(*addr);
+    for (int i = 0; i < SYSCALL_NAME_TABLE_SIZE; i++) {
+        syscall_name_table[i].name = syscalln_name(i, 0);
+        compat_syscall_name_table[i].name = syscalln_name(i, 1);
     }
 
-    for (int i = 0; i < sizeof(compat_syscall_name_table) / sizeof(compat_syscall_name_table[0]); i++) {
-        uintptr_t *addr = (uintptr_t *)&compat_syscall_name_table[i].name;
-        *addr = link2runtime(*addr);
+    syscall_name_index_init();
+    if (!patch_config->report_cfi_failure && !patch_config->__cfi_slowpath_diag && !patch_config->__cfi_slowpath) {
+        syscall_resolve_names();
     }
 
     sys_call_table = (typeof(sys_call_table))kallsyms_lookup_name("sys_call_table");
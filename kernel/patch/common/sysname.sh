@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# Generate gen/sysname.c from the unistd headers and sysname.override.
+# Run from this directory after touching any of them.
+
+native_hdr="../../linux/include/uapi/asm-generic/unistd.h"
+compat_hdr="../../linux/arch/arm64/include/asm/unistd32.h"
+override_file="sysname.override"
+out_file="gen/sysname.c"
+table_size=460
+
+mkdir -p gen
+
+awk -v size=$table_size -v override="$override_file" '
+function add_hdr(kind, file,    line, f) {
+    while ((getline line < file) > 0) {
+        if (line !~ /^#define __NR(3264)?_[a-z0-9_]+[ \t]+[0-9]+[ \t]*$/) continue;
+        split(line, f, /[ \t]+/);
+        sub(/^__NR(3264)?_/, "", f[2]);
+        if (f[2] == "syscalls" || f[3] >= size) continue;
+        if (!((kind, f[3]) in name)) name[kind, f[3]] = "sys_" f[2];
+    }
+    close(file);
+}
+BEGIN {
+    add_hdr("native", ARGV[1]);
+    add_hdr("compat", ARGV[2]);
+    while ((getline line < override) > 0) {
+        if (line ~ /^#/ || line ~ /^[ \t]*$/) continue;
+        split(line, f, /[ \t]+/);
+        if (f[3] == "-") delete name[f[1], f[2]];
+        else name[f[1], f[2]] = f[3];
+    }
+
+    # one blob, offset 0 is the empty name
+    blob_len = 1;
+    printf("/* Generated by sysname.sh, do not edit. */\n\n");
+    printf("#if SYSCALL_NAME_TABLE_SIZE != %d\n#error \"rerun sysname.sh\"\n#endif\n\n", size);
+    printf("static const char syscall_names[] = \"\"\n");
+    nkind = split("native compat", kinds, " ");
+    for (k = 1; k <= nkind; k++) {
+        for (nr = 0; nr < size; nr++) {
+            if (!((kinds[k], nr) in name)) continue;
+            n = name[kinds[k], nr];
+            if (!(n in off)) {
+                off[n] = blob_len;
+                blob_len += length(n) + 1;
+                printf("                                   \"\\0%s\"\n", n);
+            }
+        }
+    }
+    printf("                                   \"\\0\";\n");
+    for (k = 1; k <= nkind; k++) {
+        printf("\nstatic const uint16_t %ssyscall_name_offs[SYSCALL_NAME_TABLE_SIZE] = {\n", kinds[k] == "compat" ? "compat_" : "");
+        for (nr = 0; nr < size; nr++) {
+            if ((kinds[k], nr) in name) printf("    [%d] = %d,\n", nr, off[name[kinds[k], nr]]);
+        }
+        printf("};\n");
+    }
+}' "$native_hdr" "$compat_hdr" >$out_file
+
+touch sysname.c
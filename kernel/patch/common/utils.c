@@ -17,6 +17,7 @@
 #include <linux/random.h>
 #include <linux/sched.h>
 #include <linux/cred.h>
+#include <linux/slab.h>
 
 extern int kfunc_def(xt_data_to_user)(void __user *dst, const void *src, int usersize, int size, int aligned_size);
 
@@ -123,6 +124,60 @@ long compat_strncpy_from_user(char *dest, const char __user *src, long count)
 }
 KP_EXPORT_SYMBOL(compat_strncpy_from_user);
 
+// access_ok(): the untagged range lies below the largest user VA, 52 bits.
+static inline bool user_range_ok(const void __user *from, int n)
+{
+    uint64_t addr = (uint64_t)from;
+    if (!(addr & (1ull << 55))) addr &= ~(0xffull << 56);
+    uint64_t limit = 1ull << 52;
+    return addr < limit && (uint64_t)n <= limit - addr;
+}
+
+// __uaccess_mask_ptr(): a mispredicted range check must not let a kernel address reach the copy,
+// bits 52-55 are clear in any tagged user address and set in every kernel one
+static inline const void __user *user_mask_ptr(const void __user *from)
+{
+    const void __user *safe;
+    asm volatile("tst %1, %2\n"
+                 "csel %0, %1, xzr, eq\n"
+                 "hint #20" // csdb
+                 : "=&r"(safe)
+                 : "r"(from), "r"(0x00f0000000000000ull)
+                 : "cc");
+    return safe;
+}
+
+/**
+ * @brief Copy from user without an intermediate allocation, through the first checked copy the kernel has.
+ * memdup_user is only taken when none is available, or to fault in pages a nofault copy couldn't.
+ * 
+ * @param to 
+ * @param from 
+ * @param n 
+ * @return int copied length or negative errno
+ */
+int __must_check compat_copy_from_user(void *to, const void __user *from, int n)
+{
+    if (n <= 0) return 0;
+    if (kfunc(_copy_from_user)) {
+        return kfunc(_copy_from_user)(to, from, n) ? -EFAULT : n;
+    }
+    if (kfunc(copy_from_user_nofault)) {
+        if (!kfunc(copy_from_user_nofault)(to, from, n)) return n;
+    } else if (kfunc(probe_user_read)) {
+        if (!kfunc(probe_user_read)(to, from, n)) return n;
+    } else if (kfunc(__arch_copy_from_user) && kver < VERSION(5, 11, 0)) {
+        if (!user_range_ok(from, n)) return -EFAULT;
+        if (!kfunc(__arch_copy_from_user)(to, user_mask_ptr(from), n)) return n;
+    }
+    void *data = memdup_user(from, n);
+    if (IS_ERR(data)) return PTR_ERR(data);
+    memcpy(to, data, n);
+    kfree(data);
+    return n;
+}
+KP_EXPORT_SYMBOL(compat_copy_from_user);
+
 int16_t pt_regs_offset = -1;
 
 struct pt_regs *_task_pt_reg(struct task_struct *task)
@@ -24,6 +24,9 @@ int commit_common_su(uid_t to_uid, const char *sctx);
 int commit_su(uid_t uid, const char *sctx);
 int task_su(pid_t pid, uid_t to_uid, const char *sctx);
 
+void get_sel_stats(struct sel_stats *stats);
+void reset_sel_stats();
+
 /**
  * @brief Whether to make the current task bypass all selinux permission checks.
  * 
@@ -11,6 +11,7 @@
 
 int __must_check compat_copy_to_user(void __user *to, const void *from, int n);
 long compat_strncpy_from_user(char *dest, const char __user *src, long count);
+int __must_check compat_copy_from_user(void *to, const void __user *from, int n);
 void *__user copy_to_user_stack(const void *data, int len);
 uid_t current_uid();
 uint64_t get_random_u64(void);
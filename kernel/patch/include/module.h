@@ -21,7 +21,7 @@ struct load_info
     unsigned long len;
     Elf_Shdr *sechdrs;
     char *secstrings, *strtab;
-    unsigned long symoffs, stroffs;
+    void *symtab;
     struct
     {
         unsigned int sym, str, mod, info;
@@ -46,6 +46,10 @@ struct module
     unsigned int text_size;
     unsigned int ro_size;
 
+    int undef_syms;
+    uint64_t link_us;
+    uint64_t load_us;
+
     void *start;
 
     struct list_head list;
@@ -58,6 +62,9 @@ long module_control1(const char *name, void *a1, void *a2, void *a3);
 long unload_module(const char *name, void *__user reserved);
 struct module *find_module(const char *name);
 
+// Load the embedded KPMs of a boot event
+void extra_event(const char *event);
+
 int get_module_nums();
 int list_modules(char *out_names, int size);
 int get_module_info(const char *name, char *out_info, int size);
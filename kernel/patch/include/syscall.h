@@ -13,22 +13,64 @@
 #include <uapi/asm-generic/unistd.h>
 
 extern int has_syscall_wrapper;
-extern struct
-{
-    const char *name;
-    uintptr_t addr;
-} syscall_name_table[460];
+#define SYSCALL_NAME_TABLE_SIZE 460
 
-extern struct
+const char *syscalln_name(int nr, int is_compat);
+
+struct syscall_name_entry
 {
     const char *name;
     uintptr_t addr;
-} compat_syscall_name_table[460];
+};
+
+extern struct syscall_name_entry syscall_name_table[SYSCALL_NAME_TABLE_SIZE];
+extern struct syscall_name_entry compat_syscall_name_table[SYSCALL_NAME_TABLE_SIZE];
+
+#define USER_ARG_BATCH_MAX 32
 
 const char __user *get_user_arg_ptr(void *a0, void *a1, int nr);
 
 int set_user_arg_ptr(void *a0, void *a1, int nr, uintptr_t val);
 
+/**
+ * @brief Fetch argv/envp pointers [start, start + n) with one user copy, compat layout included.
+ * 
+ * @param a0 is_compat if has_config_compat, else the native array
+ * @param a1 the array if has_config_compat
+ * @param start 
+ * @param out caller buffer of n entries
+ * @param n 
+ * @return int number of pointers before the NULL terminator (n if none was seen), or negative errno
+ */
+int get_user_arg_ptrs(void *a0, void *a1, int start, const char __user **out, int n);
+
+/**
+ * @brief Fetch argv/envp pointers and copy the strings they reference into arena in one pass.
+ * A string that does not fit is left for the next call, unless it is the first one, which is truncated.
+ * 
+ * @param a0 
+ * @param a1 
+ * @param start 
+ * @param out receives pointers into arena
+ * @param n 
+ * @param arena 
+ * @param arena_len 
+ * @return int number of strings copied, or negative errno
+ */
+int get_user_arg_strs(void *a0, void *a1, int start, const char **out, int n, char *arena, int arena_len);
+
+/**
+ * @brief Write argv/envp pointers [start, start + n) back in one user copy (USER_ARG_BATCH_MAX per copy for compat)
+ * 
+ * @param a0 
+ * @param a1 
+ * @param start 
+ * @param vals 
+ * @param n 
+ * @return int 0 on success
+ */
+int set_user_arg_ptrs(void *a0, void *a1, int start, const uintptr_t *vals, int n);
+
 long raw_syscall0(long nr);
 long raw_syscall1(long nr, long arg0);
 long raw_syscall2(long nr, long arg0, long arg1);
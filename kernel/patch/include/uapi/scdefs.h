@@ -22,6 +22,18 @@ static inline long hash_key(const char *key)
 
 #define SUPERCALL_HELLO 0x1000
 #define SUPERCALL_KLOG 0x1004
+#define SUPERCALL_KLOG_READ 0x1005
+#define SUPERCALL_KLOG_LEVEL 0x1006
+
+// One record of the KernelPatch log ring, followed by len bytes of text, padded to 8 bytes
+struct kp_log_entry
+{
+    uint64_t seq;
+    uint64_t time_ns;
+    uint32_t level; // 0 verbose, 1 debug, 2 info, 3 warn, 4 error
+    uint32_t len;
+    char text[];
+};
 
 #define SUPERCALL_BUILD_TIME 0x1007
 #define SUPERCALL_KERNELPATCH_VER 0x1008
@@ -109,6 +121,19 @@ struct su_profile
 #define SUPERCALL_SU_RESET_PATH 0x1111
 #define SUPERCALL_SU_GET_SAFEMODE 0x1112
 
+#define SUPERCALL_SEL_STATS 0x1120
+
+// How often each branch of the selinux hooks is taken, summed over all cpus
+struct sel_stats
+{
+    uint64_t avc_all_allow; // avc_denied, source sid is the all-allow sid
+    uint64_t avc_task_allow; // avc_denied, current task has sel_allow or priv_sel_allow
+    uint64_t avc_forward; // avc_denied, passed to the original
+    uint64_t audit_all_allow; // slow_avc_audit, same as above
+    uint64_t audit_task_allow;
+    uint64_t audit_forward;
+};
+
 #define SUPERCALL_MAX 0x1200
 
 #define SUPERCALL_RES_SUCCEED 0
@@ -7,12 +7,13 @@
 #include <linux/ptrace.h>
 #include <log.h>
 #include <preset.h>
+#include <module.h>
 
 static int first_init_execed = 0;
 
 static void before_first_exec()
 {
-    log_boot("event: %s\n", EXTRA_EVENT_PRE_EXEC_INIT);
+    extra_event(EXTRA_EVENT_PRE_EXEC_INIT);
 }
 
 // https://elixir.bootlin.com/linux/v6.1/source/fs/exec.c#L2087
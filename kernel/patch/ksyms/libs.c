@@ -29,11 +29,20 @@ long kfunc_def(strnlen_user_nofault)(const void __user *unsafe_addr, long count)
 long kfunc_def(strnlen_unsafe_user)(const void __user *unsafe_addr, long count) = 0;
 long kfunc_def(strnlen_user)(const char __user *str, long n);
 
+unsigned long kfunc_def(_copy_from_user)(void *to, const void __user *from, unsigned long n) = 0;
+long kfunc_def(copy_from_user_nofault)(void *dst, const void __user *src, size_t size) = 0;
+long kfunc_def(probe_user_read)(void *dst, const void __user *src, size_t size) = 0;
+unsigned long kfunc_def(__arch_copy_from_user)(void *to, const void __user *from, unsigned long n) = 0;
+
 static void _linux_lib_strncpy_from_user_sym_match(const char *name, unsigned long addr)
 {
     kfunc_match(strncpy_from_user_nofault, name, addr);
     kfunc_match(strncpy_from_unsafe_user, name, addr);
     kfunc_match(strncpy_from_user, name, addr);
+    kfunc_match(_copy_from_user, name, addr);
+    kfunc_match(copy_from_user_nofault, name, addr);
+    kfunc_match(probe_user_read, name, addr);
+    kfunc_match(__arch_copy_from_user, name, addr);
 
     // kfunc_match(strnlen_user_nofault, name, addr);
     // kfunc_match(strnlen_unsafe_user, name, addr);
@@ -109,6 +109,24 @@ void kfunc_def(_raw_write_unlock_irqrestore)(rwlock_t *lock, unsigned long flags
 void kfunc_def(_raw_write_unlock_irq)(rwlock_t *lock) = 0;
 void kfunc_def(_raw_write_unlock_bh)(rwlock_t *lock) = 0;
 
+// kernel/locking/mutex.c
+#include <linux/mutex.h>
+
+void kfunc_def(__mutex_init)(struct mutex *lock, const char *name, struct lock_class_key *key) = 0;
+void kfunc_def(mutex_lock)(struct mutex *lock) = 0;
+int kfunc_def(mutex_trylock)(struct mutex *lock) = 0;
+void kfunc_def(mutex_unlock)(struct mutex *lock) = 0;
+void kfunc_def(lockdep_register_key)(struct lock_class_key *key) = 0;
+
+static void _linux_locking_mutex_sym_match(const char *name, unsigned long addr)
+{
+    kfunc_match(__mutex_init, name, addr);
+    kfunc_match(mutex_lock, name, addr);
+    kfunc_match(mutex_trylock, name, addr);
+    kfunc_match(mutex_unlock, name, addr);
+    kfunc_match(lockdep_register_key, name, addr);
+}
+
 void _linux_locking_spinlock_sym_match(const char *name, unsigned long addr)
 {
     kfunc_match(_raw_spin_trylock, name, addr);
@@ -849,6 +867,7 @@ static int _linux_misc_symbol_init(void *data, const char *name, struct module *
     _linux_mm_vmalloc_sym_match(name, addr);
     _linux_fs_sym_match(name, addr);
     _linux_locking_spinlock_sym_match(name, addr);
+    _linux_locking_mutex_sym_match(name, addr);
     _linux_stacktrace_sym_match(name, addr);
     _linux_security_selinux_sym_match(name, addr);
     _linux_security_commoncap_sym_match(name, addr);
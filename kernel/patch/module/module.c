@@ -18,6 +18,7 @@
 #include <linux/list.h>
 #include <linux/kernel.h>
 #include <linux/spinlock.h>
+#include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/rcupdate.h>
@@ -151,15 +152,6 @@ static void layout_sections(struct module *mod, struct load_info *info)
     }
 }
 
-static bool is_core_symbol(const Elf_Sym *src, const Elf_Shdr *sechdrs, unsigned int shnum)
-{
-    const Elf_Shdr *sec;
-    if (src->st_shndx == SHN_UNDEF || src->st_shndx >= shnum || !src->st_name) return false;
-    sec = sechdrs + src->st_shndx;
-    if (!(sec->sh_flags & SHF_ALLOC) || !(sec->sh_flags & SHF_EXECINSTR)) return false;
-    return true;
-}
-
 /* Change all symbols so that st_value encodes the pointer directly. */
 static int simplify_symbols(struct module *mod, const struct load_info *info)
 {
@@ -190,6 +182,7 @@ static int simplify_symbols(struct module *mod, const struct load_info *info)
                 break;
             }
             sym[i].st_value = addr;
+            mod->undef_syms++;
             break;
         default:
             secbase = info->sechdrs[sym[i].st_shndx].sh_addr;
@@ -218,39 +211,24 @@ static int apply_relocations(struct module *mod, const struct load_info *info)
     return rc;
 }
 
-// todo: free .strtab and .symtab after relocation
-static void layout_symtab(struct module *mod, struct load_info *info)
+/*
+ * .symtab and .strtab are only needed until relocation is done, so they are not laid out into the module.
+ * simplify_symbols writes st_value, work on a temporary copy so the source image stays intact.
+ */
+static int setup_symtab(struct load_info *info)
 {
     Elf_Shdr *symsect = info->sechdrs + info->index.sym;
-    Elf_Shdr *strsect = info->sechdrs + info->index.str;
-    const Elf_Sym *src;
-    unsigned int i, nsrc, ndst, strtab_size = 0;
-
-    /* Put symbol section at end of module. */
-    symsect->sh_flags |= SHF_ALLOC;
-    symsect->sh_entsize = get_offset(mod, &mod->size, symsect, info->index.sym);
-
-    src = (void *)info->hdr + symsect->sh_offset;
-    nsrc = symsect->sh_size / sizeof(*src);
-
-    /* strtab always starts with a nul, so offset 0 is the empty string. */
-    strtab_size = 1;
-    /* Compute total space required for the core symbols' strtab. */
-    for (ndst = i = 0; i < nsrc; i++) {
-        if (i == 0 || is_core_symbol(src + i, info->sechdrs, info->hdr->e_shnum)) {
-            strtab_size += strlen(&info->strtab[src[i].st_name]) + 1;
-            ndst++;
-        }
-    }
-
-    /* Append room for core symbols at end. */
-    info->symoffs = ALIGN(mod->size, symsect->sh_addralign ?: 1);
-    info->stroffs = mod->size = info->symoffs + ndst * sizeof(Elf_Sym);
-    mod->size += strtab_size;
+    info->symtab = vmalloc(symsect->sh_size);
+    if (!info->symtab) return -ENOMEM;
+    memcpy(info->symtab, (void *)info->hdr + symsect->sh_offset, symsect->sh_size);
+    symsect->sh_addr = (unsigned long)info->symtab;
+    return 0;
+}
 
-    /* Put string table section at end of module. */
-    strsect->sh_flags |= SHF_ALLOC;
-    strsect->sh_entsize = get_offset(mod, &mod->size, strsect, info->index.str);
+static void free_symtab(struct load_info *info)
+{
+    if (info->symtab) kvfree(info->symtab);
+    info->symtab = 0;
 }
 
 static int rewrite_section_headers(struct load_info *info)
@@ -393,10 +371,42 @@ static int elf_header_check(struct load_info *info)
 }
 
 struct module modules = { 0 };
+
+// module_mutex serializes load, unload and control, module_lock only guards the list for readers
+static struct mutex module_mutex;
 static spinlock_t module_lock;
+static bool module_ready = false;
 
-long load_module(const void *data, int len, const char *args, const char *event, void *__user reserved)
+// Without a mutex the loader stays off rather than run unlocked
+static inline int module_mutex_lock()
+{
+    if (!module_ready) return -ENOSYS;
+    mutex_lock(&module_mutex);
+    return 0;
+}
+
+static inline void module_mutex_unlock()
+{
+    mutex_unlock(&module_mutex);
+}
+
+static inline uint64_t module_counter()
+{
+    uint64_t cval;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(cval));
+    return cval;
+}
+
+static inline uint64_t module_counter_us(uint64_t cycles)
+{
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq ? cycles * 1000000 / freq : 0;
+}
+
+static long __load_module(const void *data, int len, const char *args, const char *event, void *__user reserved)
 {
+    uint64_t start = module_counter();
     struct load_info load_info = { .len = len, .hdr = data };
     struct load_info *info = &load_info;
     long rc = 0;
@@ -424,19 +434,27 @@ long load_module(const void *data, int len, const char *args, const char *event,
     }
 
     layout_sections(mod, info);
-    layout_symtab(mod, info);
 
+    if ((rc = setup_symtab(info))) goto free;
     if ((rc = move_module(mod, info))) goto free;
     if ((rc = simplify_symbols(mod, info))) goto free;
     if ((rc = apply_relocations(mod, info))) goto free;
+    free_symtab(info);
 
     flush_icache_all();
 
+    mod->link_us = module_counter_us(module_counter() - start);
+
     rc = (*mod->init)(mod->args, event, reserved);
 
+    mod->load_us = module_counter_us(module_counter() - start);
+
     if (!rc) {
-        logkfi("[%s] succeed with [%s] \n", mod->info.name, args);
+        logkfi("[%s] succeed with [%s], undef: %d, link: %lldus, load: %lldus\n", mod->info.name, args,
+               mod->undef_syms, mod->link_us, mod->load_us);
+        spin_lock(&module_lock);
         list_add_tail(&mod->list, &modules.list);
+        spin_unlock(&module_lock);
         goto out;
     } else {
         logkfi("[%s] failed with [%s] error: %d, try exit ...\n", mod->info.name, args, rc);
@@ -444,29 +462,41 @@ long load_module(const void *data, int len, const char *args, const char *event,
     }
 
 free:
+    free_symtab(info);
     if (mod->args) kvfree(mod->args);
-    kp_free_exec(mod->start);
+    if (mod->start) kp_free_exec(mod->start);
 free1:
     kvfree(mod);
 out:
     return rc;
 }
 
-// todo: lock
+long load_module(const void *data, int len, const char *args, const char *event, void *__user reserved)
+{
+    long rc = module_mutex_lock();
+    if (rc) return rc;
+    rc = __load_module(data, len, args, event, reserved);
+    module_mutex_unlock();
+    return rc;
+}
+
 long unload_module(const char *name, void *__user reserved)
 {
     if (!name) return -EINVAL;
     logkfe("name: %s\n", name);
 
-    rcu_read_lock();
-    long rc = 0;
+    long rc = module_mutex_lock();
+    if (rc) return rc;
 
     struct module *mod = find_module(name);
     if (!mod) {
         rc = -ENOENT;
         goto out;
     }
+    spin_lock(&module_lock);
     list_del(&mod->list);
+    spin_unlock(&module_lock);
+
     rc = (*mod->exit)(reserved);
 
     if (mod->args) kvfree(mod->args);
@@ -478,7 +508,7 @@ long unload_module(const char *name, void *__user reserved)
     logkfi("name: %s, rc: %d\n", name, rc);
 
 out:
-    rcu_read_unlock();
+    module_mutex_unlock();
     return rc;
 }
 
@@ -530,8 +560,8 @@ long module_control0(const char *name, const char *ctl_args, char *__user out_ms
 
     logkfi("name %s, args: %s\n", name, ctl_args);
 
-    long rc = 0;
-    rcu_read_lock();
+    long rc = module_mutex_lock();
+    if (rc) return rc;
 
     struct module *mod = find_module(name);
     if (!mod) {
@@ -559,15 +589,15 @@ long module_control0(const char *name, const char *ctl_args, char *__user out_ms
 
     logkfi("name: %s, rc: %d\n", name, rc);
 out:
-    rcu_read_unlock();
+    module_mutex_unlock();
     return rc;
 }
 
 long module_control1(const char *name, void *a1, void *a2, void *a3)
 {
     logkfi("name %s, a1: %llx, a2: %llx, a3: %llx\n", name, a1, a2, a3);
-    long rc = 0;
-    rcu_read_lock();
+    long rc = module_mutex_lock();
+    if (rc) return rc;
 
     struct module *mod = find_module(name);
     if (!mod) {
@@ -585,7 +615,7 @@ long module_control1(const char *name, void *a1, void *a2, void *a3)
 
     logkfi("name: %s, rc: %d\n", name, rc);
 out:
-    rcu_read_unlock();
+    module_mutex_unlock();
     return rc;
 }
 
@@ -603,7 +633,7 @@ struct module *find_module(const char *name)
 
 int get_module_nums()
 {
-    rcu_read_lock();
+    spin_lock(&module_lock);
 
     struct module *pos;
     int n = 0;
@@ -611,7 +641,7 @@ int get_module_nums()
     {
         n++;
     }
-    rcu_read_unlock();
+    spin_unlock(&module_lock);
 
     logkfd("%d\n", n);
     return n;
@@ -619,7 +649,7 @@ int get_module_nums()
 
 int list_modules(char *out_names, int size)
 {
-    rcu_read_lock();
+    spin_lock(&module_lock);
 
     struct module *pos;
     int off = 0;
@@ -629,17 +659,20 @@ int list_modules(char *out_names, int size)
     }
     if (off > 0) out_names[off - 1] = '\0';
 
-    rcu_read_unlock();
+    spin_unlock(&module_lock);
     return off;
 }
 
 int get_module_info(const char *name, char *out_info, int size)
 {
     if (size <= 0) return 0;
-    rcu_read_lock();
+    spin_lock(&module_lock);
 
     struct module *mod = find_module(name);
-    if (!mod) return -ENOENT;
+    if (!mod) {
+        spin_unlock(&module_lock);
+        return -ENOENT;
+    }
 
     int sz = snprintf(out_info, size - 1,
                       "name=%s\n"
@@ -647,19 +680,40 @@ int get_module_info(const char *name, char *out_info, int size)
                       "license=%s\n"
                       "author=%s\n"
                       "description=%s\n"
-                      "args=%s\n",
+                      "args=%s\n"
+                      "undef_syms=%d\n"
+                      "link_us=%lld\n"
+                      "load_us=%lld\n"
+                      "text=%d\n"
+                      "rodata=%d\n"
+                      "data=%d\n",
                       mod->info.name, mod->info.version, mod->info.license, mod->info.author, mod->info.description,
-                      mod->args);
+                      mod->args, mod->undef_syms, mod->link_us, mod->load_us, mod->text_size,
+                      mod->ro_size - mod->text_size, mod->size - mod->ro_size);
 
     if (sz > 0) out_info[sz - 1] = '\0';
-    logkfd("%s", out_info);
 
-    rcu_read_unlock();
+    spin_unlock(&module_lock);
+    logkfd("%s", out_info);
     return sz;
 }
 
-void module_init()
+int module_init()
 {
     INIT_LIST_HEAD(&modules.list);
     spin_lock_init(&module_lock);
+    if (!kfunc(__mutex_init) || !kfunc(mutex_lock) || !kfunc(mutex_unlock)) {
+        log_boot("no kernel mutex, kpm loading disabled\n");
+        return -ENOSYS;
+    }
+    // lockdep takes keys outside kernel data once registered, before 5.1 any kernel image address is static
+    static uint64_t module_mutex_key[8];
+    struct lock_class_key *key = (struct lock_class_key *)kfunc(__mutex_init);
+    if (kfunc(lockdep_register_key)) {
+        key = (struct lock_class_key *)module_mutex_key;
+        kfunc(lockdep_register_key)(key);
+    }
+    __mutex_init(&module_mutex, "kp_module_mutex", key);
+    module_ready = true;
+    return 0;
 }
\ No newline at end of file
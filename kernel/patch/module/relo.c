@@ -5,6 +5,8 @@
 #include <kpmalloc.h>
 #include <linux/err.h>
 
+#include <pcrel.h>
+
 #include "insn.h"
 
 #define AARCH64_INSN_IMM_MOVNZ AARCH64_INSN_IMM_MAX
@@ -159,6 +161,34 @@ static int reloc_insn_imm(enum aarch64_reloc_op op, void *place, u64 val, int ls
     return 0;
 }
 
+/*
+ * A pc-relative relocation patches the immediate of one instruction class,
+ * applied to anything else it would silently rewrite unrelated bits.
+ */
+static bool reloc_insn_matches(unsigned int type, void *place)
+{
+    int cls = pcrel_class(le32_to_cpu(*(u32 *)place));
+
+    switch (type) {
+    case R_AARCH64_LD_PREL_LO19:
+        return cls >= PCREL_LDR_32 && cls <= PCREL_LDR_SIMD_128;
+    case R_AARCH64_ADR_PREL_LO21:
+        return cls == PCREL_ADR;
+    case R_AARCH64_ADR_PREL_PG_HI21_NC:
+    case R_AARCH64_ADR_PREL_PG_HI21:
+        return cls == PCREL_ADRP;
+    case R_AARCH64_TSTBR14:
+        return cls == PCREL_TBZ || cls == PCREL_TBNZ;
+    case R_AARCH64_CONDBR19:
+        return cls == PCREL_BC || cls == PCREL_CBZ || cls == PCREL_CBNZ;
+    case R_AARCH64_JUMP26:
+    case R_AARCH64_CALL26:
+        return cls == PCREL_B || cls == PCREL_BL;
+    default:
+        return true;
+    }
+}
+
 int apply_relocate(Elf64_Shdr *sechdrs, const char *strtab, unsigned int symindex, unsigned int relsec,
                    struct module *me)
 {
@@ -186,6 +216,11 @@ int apply_relocate_add(Elf64_Shdr *sechdrs, const char *strtab, unsigned int sym
 
         overflow_check = true;
 
+        if (!reloc_insn_matches(ELF64_R_TYPE(rel[i].r_info), loc)) {
+            pr_err("relocation type %d doesn't match insn %x\n", (int)ELF64_R_TYPE(rel[i].r_info), *(u32 *)loc);
+            return -ENOEXEC;
+        }
+
         /* Perform the static relocation. */
         switch (ELF64_R_TYPE(rel[i].r_info)) {
         /* Null relocations. */
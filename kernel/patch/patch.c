@@ -10,7 +10,9 @@
 #include <syscall.h>
 #include <module.h>
 #include <predata.h>
+#include <lz4.h>
 #include <linux/string.h>
+#include <linux/vmalloc.h>
 
 void print_bootlog()
 {
@@ -47,8 +49,9 @@ int bypass_kcfi();
 int bypass_selinux();
 int resolve_pt_regs();
 int supercall_install();
-void module_init();
+int module_init();
 void syscall_init();
+void syscall_resolve_names();
 int kstorage_init();
 int su_compat_init();
 
@@ -65,6 +68,9 @@ static void before_rest_init(hook_fargs4_t *args, void *udata)
     if ((rc = bypass_kcfi())) goto out;
     log_boot("bypass_kcfi done: %d\n", rc);
 
+    // no-op unless syscall_init had to wait for bypass_kcfi
+    syscall_resolve_names();
+
     if ((rc = resolve_struct())) goto out;
     log_boot("resolve_struct done: %d\n", rc);
 
@@ -98,26 +104,47 @@ out:
     return;
 }
 
-static int extra_event_pre_kernel_init(const patch_extra_item_t *extra, const char *args, const void *data, void *udata)
+static int extra_event_load_kpm(const patch_extra_item_t *extra, const char *args, const void *data, void *udata)
 {
-    if (extra->type == EXTRA_TYPE_KPM) {
-        if (!strcmp(EXTRA_EVENT_PRE_KERNEL_INIT, extra->event) || !extra->event[0]) {
-            int rc = load_module(data, extra->con_size, args, EXTRA_EVENT_PRE_KERNEL_INIT, 0);
-            log_boot("load kpm: %s, rc: %d\n", extra->name, rc);
+    const char *event = (const char *)udata;
+    if (extra->type != EXTRA_TYPE_KPM) return 0;
+
+    int len = extra->con_size;
+    void *raw = 0;
+    if (extra->flags & EXTRA_FLAG_LZ4) {
+        raw = vmalloc(extra->raw_size);
+        if (!raw) {
+            log_boot("load kpm: %s, no memory for 0x%x\n", extra->name, extra->raw_size);
+            return 0;
+        }
+        len = lz4_decompress(data, extra->con_size, raw, extra->raw_size);
+        if (len != extra->raw_size) {
+            log_boot("load kpm: %s, decompress error: %d\n", extra->name, len);
+            vfree(raw);
+            return 0;
         }
+        data = raw;
     }
+    int rc = load_module(data, len, args, event, 0);
+    log_boot("load kpm: %s, rc: %d\n", extra->name, rc);
+    if (raw) vfree(raw);
     return 0;
 }
 
+void extra_event(const char *event)
+{
+    log_boot("event: %s\n", event);
+    on_each_extra_event(event, extra_event_load_kpm, (void *)event);
+}
+
 static void before_kernel_init(hook_fargs4_t *args, void *udata)
 {
-    log_boot("event: %s\n", EXTRA_EVENT_PRE_KERNEL_INIT);
-    on_each_extra_item(extra_event_pre_kernel_init, 0);
+    extra_event(EXTRA_EVENT_PRE_KERNEL_INIT);
 }
 
 static void after_kernel_init(hook_fargs4_t *args, void *udata)
 {
-    log_boot("event: %s\n", EXTRA_EVENT_POST_KERNEL_INIT);
+    extra_event(EXTRA_EVENT_POST_KERNEL_INIT);
 }
 
 int patch()
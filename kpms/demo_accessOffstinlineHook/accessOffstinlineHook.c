@@ -8,7 +8,11 @@
 #include "stack_unwind.h"
 #include "process_info.h"
 #include "hw_breakpoint.h"
+#include "hw_bp_event.h"
+#include "hw_bp_stack.h"
+#include "elf_sym.h"
 #include "process_memory.h"
+#include "bench.h"
 
 KPM_NAME("kpm-inline-access");
 KPM_VERSION("10.3.0");
@@ -223,6 +227,94 @@ void before_sys_kill(hook_fargs1_t *args, void *udata)
     unwind_user_stack_standard(task);
 }
 
+/**
+ * Parse a decimal or 0x-prefixed hex number and advance *pp past it
+ */
+static unsigned long parse_number(const char **pp)
+{
+    const char *p = *pp;
+    unsigned long val = 0;
+    
+    if (strncmp(p, "0x", 2) == 0 || strncmp(p, "0X", 2) == 0) {
+        p += 2;
+        while ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f') || (*p >= 'A' && *p <= 'F')) {
+            val = val * 16;
+            if (*p >= '0' && *p <= '9') val += *p - '0';
+            else if (*p >= 'a' && *p <= 'f') val += *p - 'a' + 10;
+            else val += *p - 'A' + 10;
+            p++;
+        }
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            val = val * 10 + (*p - '0');
+            p++;
+        }
+    }
+    
+    *pp = p;
+    return val;
+}
+
+/**
+ * Parse breakpoint conditions: comma separated terms
+ *   x<n>=<v> x<n>!<v> x<n><<v> x<n>><v> x<n>&<v>  register compares (max 2)
+ *   tid=<n> skip=<n> sample=<n> rate=<n> burst=<n>
+ * Returns: 0 on success, -EINVAL on a malformed term
+ */
+static int parse_bp_cond(const char *p, struct hw_bp_cond *cond)
+{
+    int nregs = 0;
+    
+    memset(cond, 0, sizeof(*cond));
+    
+    while (*p) {
+        if (*p == 'x') {
+            int reg, op;
+            p++;
+            reg = (int)parse_number(&p);
+            switch (*p) {
+                case '=': op = HW_BP_COND_EQ; break;
+                case '!': op = HW_BP_COND_NE; break;
+                case '<': op = HW_BP_COND_LT; break;
+                case '>': op = HW_BP_COND_GT; break;
+                case '&': op = HW_BP_COND_AND; break;
+                default: return -EINVAL;
+            }
+            p++;
+            if (reg > 30 || nregs >= HW_BP_MAX_REG_CONDS) return -EINVAL;
+            cond->regs[nregs].reg = reg;
+            cond->regs[nregs].op = op;
+            cond->regs[nregs].val = parse_number(&p);
+            nregs++;
+        } else if (strncmp(p, "tid=", 4) == 0) {
+            p += 4;
+            cond->tid = (int)parse_number(&p);
+        } else if (strncmp(p, "skip=", 5) == 0) {
+            p += 5;
+            cond->skip = parse_number(&p);
+        } else if (strncmp(p, "sample=", 7) == 0) {
+            p += 7;
+            cond->sample = (unsigned int)parse_number(&p);
+        } else if (strncmp(p, "rate=", 5) == 0) {
+            p += 5;
+            cond->rate = (unsigned int)parse_number(&p);
+        } else if (strncmp(p, "burst=", 6) == 0) {
+            p += 6;
+            cond->burst = (unsigned int)parse_number(&p);
+        } else {
+            return -EINVAL;
+        }
+        
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return -EINVAL;
+        }
+    }
+    
+    return 0;
+}
+
 /**
  * Supercall control handler
  * Allows userspace to control the module
@@ -236,11 +328,34 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
     long ret = 0;
     int i;
     
+    // Benchmark commands come first and skip the command log line, which would dominate the timing
+    // Command: bench_nop - Return at once, for the control round trip
+    if (strcmp(ctl_args, "bench_nop") == 0) {
+        return 0;
+    }
+    // Command: bench:kind:iters - Time kind (0 nop, 1 unwind, 2 vma, 3 unwind_std) in the caller
+    // Binary output: struct bench_result followed by count u32 tick samples
+    if (strncmp(ctl_args, "bench:", 6) == 0) {
+        const char *p = ctl_args + 6;
+        int kind = (int)parse_number(&p);
+        int iters = 0;
+        
+        if (*p == ':') {
+            p++;
+            iters = (int)parse_number(&p);
+        }
+        
+        return bench_run_user(kind, iters, out_msg, outlen);
+    }
+    
     // ctl_args is already in kernel space, no need to copy
     pr_info("[Control] Received command: %s\n", ctl_args);
     
     // Command: get_status - Get module status
     if (strcmp(ctl_args, "get_status") == 0) {
+        int sym_libs;
+        unsigned long sym_count;
+        elf_sym_stats(&sym_libs, &sym_count);
         int len = snprintf(kernel_out, sizeof(kernel_out),
                  "enabled=%d\n"
                  "access_hook=%d\n"
@@ -251,7 +366,8 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
                  "kill_count=%d\n"
                  "total_hooks=%d\n"
                  "filter_mode=%s\n"
-                 "filter_count=%d",
+                 "filter_count=%d\n"
+                 "symbols=%d (%d libs, %lu syms)",
                  module_state.hook_enabled,
                  module_state.hook_access_enabled,
                  module_state.hook_openat_enabled,
@@ -261,7 +377,8 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
                  module_state.kill_hook_count,
                  module_state.access_hook_count + module_state.openat_hook_count + module_state.kill_hook_count,
                  module_state.filter_mode == 0 ? "whitelist" : "blacklist",
-                 module_state.filter_count);
+                 module_state.filter_count,
+                 elf_sym_get_enabled(), sym_libs, sym_count);
         
         // Add filter list
         for (i = 0; i < module_state.filter_count && len < sizeof(kernel_out) - 100; i++) {
@@ -286,6 +403,20 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
         module_state.hook_enabled = 0;
         snprintf(kernel_out, sizeof(kernel_out), "Hooks disabled");
     }
+    // Command: enable_symbols / disable_symbols - Resolve library symbols in stack traces
+    else if (strcmp(ctl_args, "enable_symbols") == 0) {
+        elf_sym_set_enabled(1);
+        if (elf_sym_get_enabled()) {
+            snprintf(kernel_out, sizeof(kernel_out), "Symbol resolution enabled");
+        } else {
+            snprintf(kernel_out, sizeof(kernel_out), "Error: kernel_read not available");
+            ret = -ENOSYS;
+        }
+    }
+    else if (strcmp(ctl_args, "disable_symbols") == 0) {
+        elf_sym_set_enabled(0);
+        snprintf(kernel_out, sizeof(kernel_out), "Symbol resolution disabled");
+    }
     // Command: enable_access - Enable access hook
     else if (strcmp(ctl_args, "enable_access") == 0) {
         module_state.hook_access_enabled = 1;
@@ -468,6 +599,37 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
             }
         }
     }
+    // Command: bp_range:addr:len:type:pid:desc - Watch a memory range with one slot
+    // Format: bp_range:0x7f00001000:0x100:1:1234:buffer
+    // type: 1=write, 2=read, 3=rw; pid 0 for system-wide
+    else if (strncmp(ctl_args, "bp_range:", 9) == 0) {
+        const char *p = ctl_args + 9;
+        unsigned long addr, len = 0;
+        int type = HW_BP_TYPE_RW, pid = 0, bp_idx;
+        const char *desc = "";
+        
+        addr = parse_number(&p);
+        if (*p == ':') { p++; len = parse_number(&p); }
+        if (*p == ':') { p++; type = (int)parse_number(&p); }
+        if (*p == ':') { p++; pid = (int)parse_number(&p); }
+        if (*p == ':') desc = p + 1;
+        
+        if (addr == 0 || len == 0) {
+            snprintf(kernel_out, sizeof(kernel_out), "Error: Invalid format, use bp_range:addr:len:type:pid:desc");
+            ret = -EINVAL;
+        } else {
+            bp_idx = hw_breakpoint_set_range(addr, len, type, pid, desc);
+            if (bp_idx >= 0) {
+                struct hw_breakpoint *bp = hw_breakpoint_get(bp_idx);
+                snprintf(kernel_out, sizeof(kernel_out),
+                         "Breakpoint[%d] watches 0x%lx-0x%lx, hardware block at 0x%lx", bp_idx, addr,
+                         addr + len, bp->addr);
+            } else {
+                snprintf(kernel_out, sizeof(kernel_out), "Failed to set range watchpoint: %d", bp_idx);
+                ret = bp_idx;
+            }
+        }
+    }
     // Command: bp_clear:index - Clear hardware breakpoint by index
     else if (strncmp(ctl_args, "bp_clear:", 9) == 0) {
         const char *idx_str = ctl_args + 9;
@@ -487,11 +649,124 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
             ret = result;
         }
     }
+    // Command: bp_cond:index:conds - Set hit conditions of a breakpoint
+    // Format: bp_cond:0:x0=0x10,tid=1234,skip=5,sample=10,rate=100,burst=10
+    // Format: bp_cond:0:none - Clear conditions
+    else if (strncmp(ctl_args, "bp_cond:", 8) == 0) {
+        const char *p = ctl_args + 8;
+        int idx = (int)parse_number(&p);
+        struct hw_bp_cond cond;
+        int result;
+        
+        if (*p != ':') {
+            snprintf(kernel_out, sizeof(kernel_out), "Error: Invalid format, use bp_cond:index:conds");
+            ret = -EINVAL;
+        } else if (strcmp(p + 1, "none") == 0) {
+            result = hw_breakpoint_set_cond(idx, NULL);
+            snprintf(kernel_out, sizeof(kernel_out), result ? "Failed to clear conditions of breakpoint[%d]: %d"
+                                                              : "Breakpoint[%d] conditions cleared", idx, result);
+            ret = result;
+        } else if (parse_bp_cond(p + 1, &cond) != 0) {
+            snprintf(kernel_out, sizeof(kernel_out), "Error: Invalid condition: %s", p + 1);
+            ret = -EINVAL;
+        } else {
+            result = hw_breakpoint_set_cond(idx, &cond);
+            if (result == 0) {
+                snprintf(kernel_out, sizeof(kernel_out), "Breakpoint[%d] conditions set: %s", idx, p + 1);
+            } else {
+                snprintf(kernel_out, sizeof(kernel_out), "Failed to set conditions of breakpoint[%d]: %d", idx, result);
+                ret = result;
+            }
+        }
+    }
+    // Command: bp_rearm:step or bp_rearm:move - Select the re-arm engine
+    else if (strncmp(ctl_args, "bp_rearm:", 9) == 0) {
+        const char *mode = ctl_args + 9;
+        int result;
+        
+        if (strcmp(mode, "step") == 0) {
+            result = hw_breakpoint_set_rearm(HW_BP_REARM_STEP);
+        } else if (strcmp(mode, "move") == 0) {
+            result = hw_breakpoint_set_rearm(HW_BP_REARM_MOVE);
+        } else {
+            result = -EINVAL;
+        }
+        
+        if (result == 0) {
+            snprintf(kernel_out, sizeof(kernel_out), "Breakpoint re-arm mode: %s", mode);
+        } else {
+            snprintf(kernel_out, sizeof(kernel_out), "Failed to set re-arm mode %s: %d", mode, result);
+            ret = result;
+        }
+    }
     // Command: bp_clear_all - Clear all hardware breakpoints
     else if (strcmp(ctl_args, "bp_clear_all") == 0) {
         hw_breakpoint_clear_all();
         snprintf(kernel_out, sizeof(kernel_out), "All breakpoints cleared");
     }
+    // Command: bp_drain or bp_drain:max - Move breakpoint hit records to out_msg
+    // Binary output: struct hw_bp_event_batch followed by count records
+    // Returns the record count, call again until it returns 0
+    else if (strncmp(ctl_args, "bp_drain", 8) == 0 && (ctl_args[8] == '\0' || ctl_args[8] == ':')) {
+        const char *max_str = ctl_args + 8;
+        int max = 0;
+        
+        if (*max_str == ':') {
+            max_str++;
+            while (*max_str >= '0' && *max_str <= '9') {
+                max = max * 10 + (*max_str - '0');
+                max_str++;
+            }
+        }
+        
+        // Records are already binary, skip the text reply below
+        return hw_bp_event_drain_user(out_msg, outlen, max);
+    }
+    // Command: bp_drain_reset - Discard pending breakpoint hit records
+    else if (strcmp(ctl_args, "bp_drain_reset") == 0) {
+        hw_bp_event_reset();
+        snprintf(kernel_out, sizeof(kernel_out), "Breakpoint hit records discarded");
+    }
+    // Command: bp_stack:index:depth - Capture depth user frames per hit, 0 stops
+    else if (strncmp(ctl_args, "bp_stack:", 9) == 0) {
+        const char *p = ctl_args + 9;
+        int idx = (int)parse_number(&p);
+        int depth = HW_BP_STACK_DEPTH;
+        int result;
+        
+        if (*p == ':') {
+            p++;
+            depth = (int)parse_number(&p);
+        }
+        
+        result = hw_breakpoint_set_stack(idx, depth);
+        if (result == 0) {
+            snprintf(kernel_out, sizeof(kernel_out), "Breakpoint[%d] stack capture: %d frames", idx,
+                     hw_breakpoint_get(idx)->stack_depth);
+        } else {
+            snprintf(kernel_out, sizeof(kernel_out), "Failed to set stack capture of breakpoint[%d]: %d", idx, result);
+            ret = result;
+        }
+    }
+    // Command: bp_stacks or bp_stacks:start - Copy the call-path profile to out_msg
+    // Binary output: struct hw_bp_stack_batch followed by count entries
+    // Call again from batch.next until it is 0
+    else if (strncmp(ctl_args, "bp_stacks", 9) == 0 && (ctl_args[9] == '\0' || ctl_args[9] == ':')) {
+        const char *p = ctl_args + 9;
+        int start = 0;
+        
+        if (*p == ':') {
+            p++;
+            start = (int)parse_number(&p);
+        }
+        
+        return hw_bp_stack_fetch_user(out_msg, outlen, start);
+    }
+    // Command: bp_stacks_reset - Drop the call-path profile
+    else if (strcmp(ctl_args, "bp_stacks_reset") == 0) {
+        hw_bp_stack_reset();
+        snprintf(kernel_out, sizeof(kernel_out), "Breakpoint call paths discarded");
+    }
     // Command: bp_verbose_on - Enable verbose breakpoint logging
     else if (strcmp(ctl_args, "bp_verbose_on") == 0) {
         hw_breakpoint_set_verbose(1);
@@ -518,9 +793,21 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
                     case HW_BP_TYPE_RW: type_str = "rw"; break;
                 }
                 
+                if (bp->range_len) {
+                    len += snprintf(kernel_out + len, sizeof(kernel_out) - len,
+                                  "[%d] 0x%lx-0x%lx (%s, range, hits:%d",
+                                  i, bp->range_start, bp->range_start + bp->range_len, type_str, bp->hit_count);
+                } else {
+                    len += snprintf(kernel_out + len, sizeof(kernel_out) - len,
+                                  "[%d] 0x%lx (%s, %d bytes, hits:%d",
+                                  i, bp->addr, type_str, 1 << bp->size, bp->hit_count);
+                }
+                if (bp->has_cond || bp->range_len) {
+                    len += snprintf(kernel_out + len, sizeof(kernel_out) - len,
+                                  ", filtered:%d", bp->filtered_count);
+                }
                 len += snprintf(kernel_out + len, sizeof(kernel_out) - len,
-                              "[%d] 0x%lx (%s, %d bytes, hits:%d) %s\n",
-                              i, bp->addr, type_str, 1 << bp->size, bp->hit_count,
+                              ")%s %s\n", bp->backend == HW_BP_BACKEND_UPROBE ? " [uprobe]" : "",
                               bp->description[0] ? bp->description : "");
                 count++;
             }
@@ -530,7 +817,41 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
             len += snprintf(kernel_out + len, sizeof(kernel_out) - len, "  (none)\n");
         }
         len += snprintf(kernel_out + len, sizeof(kernel_out) - len, 
-                       "Total: %d/%d slots used", count, MAX_HW_BREAKPOINTS);
+                       "Total: %d/%d breakpoints, re-arm: %s", count, MAX_HW_BREAKPOINTS,
+                       hw_breakpoint_get_rearm() == HW_BP_REARM_STEP ? "step" : "move");
+    }
+    // Command: mem_dump:pid:start:end - Copy present pages of [start, end) to out_msg
+    // Binary output: struct mem_dump_batch, then per extent struct mem_dump_range and its data
+    // Call again from batch.next until it is 0
+    else if (strncmp(ctl_args, "mem_dump:", 9) == 0) {
+        const char *p = ctl_args + 9;
+        int pid = (int)parse_number(&p);
+        unsigned long start = 0, end = 0;
+        
+        if (*p == ':') { p++; start = parse_number(&p); }
+        if (*p == ':') { p++; end = parse_number(&p); }
+        
+        return process_memory_dump_user(pid, start, end, out_msg, outlen);
+    }
+    // Command: mem_write:pid - Apply the patch batch in out_msg to a process
+    // Binary in/out: struct mem_patch_batch and patches, results are filled in place
+    else if (strncmp(ctl_args, "mem_write:", 10) == 0) {
+        const char *p = ctl_args + 10;
+        int pid = (int)parse_number(&p);
+        
+        return process_memory_write_user(pid, out_msg, outlen);
+    }
+    // Command: mem_search:pid:start:end - Search for the pattern request in out_msg
+    // Binary in/out: struct mem_search_req in, struct mem_search_result and addresses out
+    else if (strncmp(ctl_args, "mem_search:", 11) == 0) {
+        const char *p = ctl_args + 11;
+        int pid = (int)parse_number(&p);
+        unsigned long start = 0, end = 0;
+        
+        if (*p == ':') { p++; start = parse_number(&p); }
+        if (*p == ':') { p++; end = parse_number(&p); }
+        
+        return process_memory_search_user(pid, start, end, out_msg, outlen);
     }
     // Command: mem_read:pid:addr:size - Read memory from process
     // Format: mem_read:1234:0x7f12345678:64
@@ -594,6 +915,19 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
             }
         }
     }
+    // Command: bench_hook:0|1 - Remove or install an empty hook on getppid
+    else if (strncmp(ctl_args, "bench_hook:", 11) == 0) {
+        const char *p = ctl_args + 11;
+        int enable = (int)parse_number(&p);
+        int result = bench_hook_set(enable);
+        
+        if (result == 0) {
+            snprintf(kernel_out, sizeof(kernel_out), "Empty getppid hook %s", enable ? "installed" : "removed");
+        } else {
+            snprintf(kernel_out, sizeof(kernel_out), "Failed to %s getppid hook: %d", enable ? "install" : "remove", result);
+            ret = result;
+        }
+    }
     // Command: help - Show available commands
     else if (strcmp(ctl_args, "help") == 0) {
         snprintf(kernel_out, sizeof(kernel_out),
@@ -601,6 +935,8 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
                  "  get_status        - Get module status\n"
                  "  enable            - Enable all hooks\n"
                  "  disable           - Disable all hooks\n"
+                 "  enable_symbols    - Show lib!func+0x in stack traces\n"
+                 "  disable_symbols   - Show lib + 0xoffset in stack traces\n"
                  "  enable_access     - Enable access hook\n"
                  "  disable_access    - Disable access hook\n"
                  "  enable_openat     - Enable openat hook\n"
@@ -614,12 +950,26 @@ static long kpm_control(const char *ctl_args, char *__user out_msg, int outlen)
                  "  add_filter:pid:X  - Add PID filter\n"
                  "  clear_filters     - Clear all filters\n"
                  "  bp_set:addr:type:size:pid:desc - Set hardware breakpoint\n"
+                 "  bp_range:addr:len:type:pid:desc - Watch a memory range\n"
                  "  bp_clear:index    - Clear breakpoint by index\n"
+                 "  bp_cond:index:conds - Set hit conditions (none to clear)\n"
+                 "  bp_rearm:step|move - Select breakpoint re-arm engine\n"
                  "  bp_clear_all      - Clear all breakpoints\n"
                  "  bp_list           - List all breakpoints\n"
+                 "  bp_drain[:max]    - Drain breakpoint hit records (binary)\n"
+                 "  bp_drain_reset    - Discard pending hit records\n"
+                 "  bp_stack:index:depth - Count hits per user call path (0 stops)\n"
+                 "  bp_stacks[:start] - Fetch call-path profile (binary)\n"
+                 "  bp_stacks_reset   - Discard call-path profile\n"
                  "  bp_verbose_on     - Enable detailed breakpoint logging\n"
                  "  bp_verbose_off    - Disable detailed breakpoint logging\n"
                  "  mem_read:pid:addr:size - Read process memory\n"
+                 "  mem_dump:pid:start:end - Dump present pages (binary)\n"
+                 "  mem_write:pid     - Apply patch batch from out_msg (binary)\n"
+                 "  mem_search:pid:start:end - Pattern search, request in out_msg (binary)\n"
+                 "  bench_nop         - Return at once (control round trip)\n"
+                 "  bench:kind:iters  - Time 0 nop, 1 unwind, 2 vma, 3 unwind_std (binary)\n"
+                 "  bench_hook:0|1    - Empty hook on getppid\n"
                  "  help              - Show this help");
     }
     // Unknown command
@@ -663,10 +1013,27 @@ static long kpm_init(const char *args, const char *event, void *__user reserved)
         return -1;
     }
     
+    if (hw_bp_event_init() != 0) {
+        pr_err("Failed to initialize breakpoint event rings\n");
+        return -1;
+    }
+    
+    elf_sym_init();
+    
+    if (hw_bp_stack_init() != 0) {
+        pr_err("Failed to initialize breakpoint stack table\n");
+        return -1;
+    }
+    
     if (process_memory_init() != 0) {
         pr_err("Failed to initialize process memory access\n");
         return -1;
     }
+    
+    if (bench_init() != 0) {
+        pr_err("Failed to initialize benchmarks\n");
+        return -1;
+    }
 
     // Resolve symbols for this module
     g_strncpy_from_user = (strncpy_from_user_t)kallsyms_lookup_name("strncpy_from_user");
@@ -750,7 +1117,10 @@ static long kpm_init(const char *args, const char *event, void *__user reserved)
 static long kpm_exit(void *__user reserved)
 {
     // Clear all hardware breakpoints
-    hw_breakpoint_clear_all();
+    hw_breakpoint_exit();
+    hw_bp_event_exit();
+    hw_bp_stack_exit();
+    bench_exit();
     
     if (g_do_faccessat_addr) {
         unhook(g_do_faccessat_addr);
@@ -767,6 +1137,9 @@ static long kpm_exit(void *__user reserved)
         pr_info("sys_kill hook removed\n");
     }
     
+    // Hooks are gone, nothing resolves symbols anymore
+    elf_sym_exit();
+    
     pr_info("Final statistics: access=%d, openat=%d, kill=%d\n",
             module_state.access_hook_count,
             module_state.openat_hook_count,
@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * In-kernel microbenchmarks
+ *
+ * Samples are taken with the virtual counter around each call and copied
+ * out in batches between calls, so the copy never lands in a sample.
+ */
+
+#include <compiler.h>
+#include <kpmodule.h>
+#include <linux/printk.h>
+#include <linux/errno.h>
+#include <hook.h>
+#include "bench.h"
+#include "stack_unwind.h"
+
+#define BENCH_BATCH 256
+// unwind_user_stack_standard() prints a line per frame
+#define BENCH_STD_MAX 16
+
+static arch_copy_to_user_t g_arch_copy_to_user = NULL;
+static void *g_getppid_addr = NULL;
+static int hook_installed = 0;
+
+static inline u64 bench_ticks(void)
+{
+    u64 cnt;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(cnt) : : "memory");
+    return cnt;
+}
+
+static inline u64 bench_freq(void)
+{
+    u64 frq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frq));
+    return frq;
+}
+
+// Nothing to do, the chain dispatch itself is what gets measured
+static void before_getppid(hook_fargs1_t *args, void *udata)
+{
+}
+
+int bench_init(void)
+{
+    g_arch_copy_to_user = (arch_copy_to_user_t)kallsyms_lookup_name("__arch_copy_to_user");
+    if (!g_arch_copy_to_user) {
+        pr_err("Failed to resolve bench functions\n");
+        return -1;
+    }
+
+    g_getppid_addr = (void *)kallsyms_lookup_name("__arm64_sys_getppid");
+    if (!g_getppid_addr) g_getppid_addr = (void *)kallsyms_lookup_name("sys_getppid");
+    return 0;
+}
+
+void bench_exit(void)
+{
+    bench_hook_set(0);
+}
+
+int bench_hook_set(int enable)
+{
+    if (!g_getppid_addr) return -ENOSYS;
+
+    if (enable && !hook_installed) {
+        hook_err_t err = hook_wrap1(g_getppid_addr, before_getppid, NULL, 0);
+        if (err) return -EFAULT;
+        hook_installed = 1;
+    } else if (!enable && hook_installed) {
+        unhook(g_getppid_addr);
+        hook_installed = 0;
+    }
+    return 0;
+}
+
+long bench_run_user(int kind, int iters, void __user *out, int outlen)
+{
+    struct pt_regs *regs = task_pt_regs(current);
+    unsigned long pcs[BENCH_FRAMES], scratch[BENCH_FRAMES];
+    u32 batch[BENCH_BATCH];
+    struct bench_result hdr;
+    char __user *dst = (char __user *)out + sizeof(hdr);
+    char vma_buf[256];
+    int frames, got = 0, n = 0, i, j;
+
+    if (!g_arch_copy_to_user) return -ENODEV;
+    if (kind < BENCH_NOP || kind > BENCH_UNWIND_STD) return -EINVAL;
+    if (!out || outlen < (int)sizeof(hdr)) return -EINVAL;
+
+    if (iters > (outlen - (int)sizeof(hdr)) / (int)sizeof(u32)) iters = (outlen - sizeof(hdr)) / sizeof(u32);
+    if (iters > BENCH_MAX_SAMPLES) iters = BENCH_MAX_SAMPLES;
+    if (kind == BENCH_UNWIND_STD && iters > BENCH_STD_MAX) iters = BENCH_STD_MAX;
+
+    frames = unwind_user_frames(regs, pcs, BENCH_FRAMES);
+
+    for (i = 0; i < iters; i++) {
+        u64 start = bench_ticks();
+        switch (kind) {
+        case BENCH_UNWIND:
+            unwind_user_frames(regs, scratch, BENCH_FRAMES);
+            break;
+        case BENCH_VMA:
+            for (j = 0; j < frames; j++) get_vma_info_str(pcs[j], vma_buf, sizeof(vma_buf));
+            break;
+        case BENCH_UNWIND_STD:
+            unwind_user_stack_standard(current);
+            break;
+        default:
+            break;
+        }
+        batch[got++] = (u32)(bench_ticks() - start);
+
+        if (got == BENCH_BATCH) {
+            if (g_arch_copy_to_user(dst, batch, got * sizeof(u32))) return -EFAULT;
+            dst += got * sizeof(u32);
+            n += got;
+            got = 0;
+        }
+    }
+    if (got) {
+        if (g_arch_copy_to_user(dst, batch, got * sizeof(u32))) return -EFAULT;
+        n += got;
+    }
+
+    hdr.count = n;
+    hdr.frames = kind == BENCH_NOP ? 0 : frames;
+    hdr.freq = bench_freq();
+    if (g_arch_copy_to_user(out, &hdr, sizeof(hdr))) return -EFAULT;
+
+    return n;
+}
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * In-kernel microbenchmarks
+ *
+ * Times module paths that can't be measured from user space, one sample
+ * per call in counter ticks, and installs an empty hook for the driver to
+ * time a hooked syscall against an unhooked one. Percentiles are left to
+ * the driver (userspace/jni/kpm_bench.c).
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "common.h"
+
+// Max samples per run
+#define BENCH_MAX_SAMPLES 16384
+// Frames unwound per sample
+#define BENCH_FRAMES 32
+
+enum bench_kind {
+    BENCH_NOP = 0,          // Timer floor
+    BENCH_UNWIND,           // unwind_user_frames() of the caller
+    BENCH_VMA,              // get_vma_info_str() over the caller's frames
+    BENCH_UNWIND_STD,       // unwind_user_stack_standard(), prints every frame
+};
+
+// Header in front of the u32 tick samples written by bench_run_user()
+struct bench_result {
+    u32 count;       // Samples following this header
+    u32 frames;      // Frames covered by one sample, 0 if not per frame
+    u64 freq;        // Ticks per second
+};
+
+// Resolve functions
+int bench_init(void);
+
+// Remove the empty hook if still installed
+void bench_exit(void);
+
+// Time iters runs of kind in the calling task, samples go to a user buffer of outlen bytes
+// Returns: number of samples, or negative error code
+long bench_run_user(int kind, int iters, void __user *out, int outlen);
+
+// Install or remove an empty hook_wrap on getppid
+// Returns: 0 or negative error code
+int bench_hook_set(int enable);
+
+#endif /* _BENCH_H_ */
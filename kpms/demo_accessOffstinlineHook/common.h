@@ -26,10 +26,14 @@
 
 #define MAX_STACK_DEPTH 32
 
+// User addresses fit in 48 bits, the rest is tag or PAC
+#define USER_VA_MASK ((1UL << 48) - 1)
+
 // Forward declarations
 struct rw_semaphore;
 struct pid_namespace;
 struct file;
+struct inode;
 
 // Function pointer types
 typedef void (*save_stack_trace_user_t)(struct stack_trace *trace);
@@ -43,6 +47,7 @@ typedef void (*print_vma_addr_t)(char *prefix, unsigned long ip);
 typedef struct vm_area_struct *(*find_vma_t)(struct mm_struct *mm, unsigned long addr);
 typedef char *(*file_path_t)(struct file *, char *, int);
 typedef int (*down_read_trylock_t)(struct rw_semaphore *sem);
+typedef void (*down_read_t)(struct rw_semaphore *sem);
 typedef void (*up_read_t)(struct rw_semaphore *sem);
 typedef void (*free_page_t)(unsigned long addr, unsigned int order);
 typedef unsigned long (*get_free_page_t)(unsigned int gfp_mask, int order);
@@ -55,6 +60,25 @@ struct vma_offsets_t {
     int vm_end;
     int vm_file;
     int vm_prev;
+    int vm_pgoff;
+    int vm_flags;
+};
+
+// vm_flags bits
+#define VM_READ   0x00000001
+#define VM_WRITE  0x00000002
+#define VM_EXEC   0x00000004
+#define VM_SHARED 0x00000008
+#define VM_PFNMAP 0x00000400
+#define VM_IO     0x00004000
+
+// Snapshot of one VMA, see get_next_vma()
+struct vma_span {
+    unsigned long start;
+    unsigned long end;
+    unsigned long flags;     // vm_flags
+    int is_file;             // File-backed mapping
+    char name[64];           // File basename, filled in on request
 };
 
 // ARM32 stack frame structure
@@ -69,4 +93,49 @@ static inline long IS_ERR(const void *ptr)
     return (long)ptr >= (unsigned long)-4095;
 }
 
+// LL/SC atomics, asm/atomic.h clashes with the rwonce.h pulled in above
+static inline int kpm_atomic_inc(int *p)
+{
+    int val, tmp;
+    asm volatile("1: ldxr %w0, %2\n"
+                 "add %w0, %w0, #1\n"
+                 "stxr %w1, %w0, %2\n"
+                 "cbnz %w1, 1b"
+                 : "=&r"(val), "=&r"(tmp), "+Q"(*p)
+                 :
+                 : "memory");
+    return val;
+}
+
+static inline long kpm_atomic_add_return(long *p, long v)
+{
+    long val;
+    int tmp;
+    asm volatile("1: ldxr %0, %2\n"
+                 "add %0, %0, %3\n"
+                 "stxr %w1, %0, %2\n"
+                 "cbnz %w1, 1b"
+                 : "=&r"(val), "=&r"(tmp), "+Q"(*p)
+                 : "r"(v)
+                 : "memory");
+    return val;
+}
+
+// Returns the value found at p, the swap happened if it equals old
+static inline long kpm_cmpxchg(long *p, long old, long new)
+{
+    long val;
+    int tmp;
+    asm volatile("1: ldaxr %0, %2\n"
+                 "cmp %0, %3\n"
+                 "b.ne 2f\n"
+                 "stlxr %w1, %4, %2\n"
+                 "cbnz %w1, 1b\n"
+                 "2:"
+                 : "=&r"(val), "=&r"(tmp), "+Q"(*p)
+                 : "r"(old), "r"(new)
+                 : "cc", "memory");
+    return val;
+}
+
 #endif /* _COMMON_H_ */
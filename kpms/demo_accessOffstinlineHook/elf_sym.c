@@ -0,0 +1,473 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * User library symbol resolver
+ *
+ * A cache slot goes empty -> loading -> ready (or failed) exactly once.
+ * The loader claims the slot with a cmpxchg and publishes it with a
+ * release store of the state, so lookups never take a lock. Failed
+ * libraries stay cached so a stripped or non-ELF file is read only once.
+ */
+
+#include <compiler.h>
+#include <kpmodule.h>
+#include <linux/printk.h>
+#include <linux/errno.h>
+#include <uapi/linux/elf.h>
+#include <barrier.h>
+#include "elf_sym.h"
+
+#define ELF_SYM_MAX_SEGS 16
+#define ELF_SYM_MAX_SYMS (256 * 1024)
+#define ELF_SYM_MAX_SECTION (16 * 1024 * 1024)
+#define ELF_SYM_MAX_SHNUM 512
+
+#define LIB_EMPTY   0
+#define LIB_LOADING 1
+#define LIB_READY   2
+#define LIB_FAILED  3
+
+typedef void *(*vmalloc_t)(unsigned long size);
+typedef void (*vfree_t)(const void *addr);
+typedef long (*kernel_read_t)(struct file *file, void *buf, size_t count, loff_t *pos);
+typedef struct inode *(*igrab_t)(struct inode *inode);
+typedef void (*iput_t)(struct inode *inode);
+
+static vmalloc_t g_vmalloc = NULL;
+static vfree_t g_vfree = NULL;
+static kernel_read_t g_kernel_read = NULL;
+static igrab_t g_igrab = NULL;
+static iput_t g_iput = NULL;
+static snprintf_t g_snprintf = NULL;
+
+// PT_LOAD segment, maps file offsets to link-time addresses
+struct elf_seg {
+    u64 offset;
+    u64 vaddr;
+    u64 filesz;
+};
+
+struct elf_fsym {
+    u64 addr;
+    u32 size;
+    u32 name;            // Offset into names
+};
+
+struct elf_lib {
+    long state;
+    struct inode *inode;
+    int nsegs;
+    struct elf_seg segs[ELF_SYM_MAX_SEGS];
+    u32 nsyms;
+    struct elf_fsym *syms;
+    char *names;
+};
+
+// One symbol section and its string table, in either ELF class
+struct sym_src {
+    void *syms;
+    char *str;
+    u64 nsyms;
+    u64 strsz;
+};
+
+static struct elf_lib libs[ELF_SYM_MAX_LIBS];
+static int elf_sym_enabled = 0;
+
+static int read_at(struct file *f, void *buf, size_t len, u64 off)
+{
+    loff_t pos = off;
+    return g_kernel_read(f, buf, len, &pos) == (long)len ? 0 : -EIO;
+}
+
+static void *read_alloc(struct file *f, u64 off, u64 len)
+{
+    void *buf;
+
+    if (len == 0 || len > ELF_SYM_MAX_SECTION) return NULL;
+    buf = g_vmalloc(len);
+    if (buf && read_at(f, buf, len, off)) {
+        g_vfree(buf);
+        buf = NULL;
+    }
+    return buf;
+}
+
+// Normalized views of the two ELF classes
+static void get_sym(const struct sym_src *src, int is64, u64 i, u32 *name, u64 *value, u64 *size, u8 *info, u16 *shndx)
+{
+    if (is64) {
+        const Elf64_Sym *s = (const Elf64_Sym *)src->syms + i;
+        *name = s->st_name;
+        *value = s->st_value;
+        *size = s->st_size;
+        *info = s->st_info;
+        *shndx = s->st_shndx;
+    } else {
+        const Elf32_Sym *s = (const Elf32_Sym *)src->syms + i;
+        *name = s->st_name;
+        *value = s->st_value;
+        *size = s->st_size;
+        *info = s->st_info;
+        *shndx = s->st_shndx;
+    }
+}
+
+static void get_shdr(const void *shdrs, int is64, int i, u32 *type, u64 *offset, u64 *size, u32 *link)
+{
+    if (is64) {
+        const Elf64_Shdr *s = (const Elf64_Shdr *)shdrs + i;
+        *type = s->sh_type;
+        *offset = s->sh_offset;
+        *size = s->sh_size;
+        *link = s->sh_link;
+    } else {
+        const Elf32_Shdr *s = (const Elf32_Shdr *)shdrs + i;
+        *type = s->sh_type;
+        *offset = s->sh_offset;
+        *size = s->sh_size;
+        *link = s->sh_link;
+    }
+}
+
+// Length of a name in a string table, 0 if it runs off the end
+static u32 str_len(const struct sym_src *src, u32 off)
+{
+    u64 i;
+
+    for (i = off; i < src->strsz; i++) {
+        if (!src->str[i]) return i - off;
+    }
+    return 0;
+}
+
+static inline int is_func(u32 name, u64 value, u8 info, u16 shndx)
+{
+    return name && value && shndx != SHN_UNDEF && ELF_ST_TYPE(info) == STT_FUNC;
+}
+
+static void sift_down(struct elf_fsym *a, u32 root, u32 n)
+{
+    for (;;) {
+        u32 child = root * 2 + 1;
+        struct elf_fsym tmp;
+
+        if (child >= n) return;
+        if (child + 1 < n && a[child + 1].addr > a[child].addr) child++;
+        if (a[root].addr >= a[child].addr) return;
+        tmp = a[root];
+        a[root] = a[child];
+        a[child] = tmp;
+        root = child;
+    }
+}
+
+static void sort_syms(struct elf_fsym *a, u32 n)
+{
+    u32 i;
+    struct elf_fsym tmp;
+
+    for (i = n / 2; i-- > 0;)
+        sift_down(a, i, n);
+    for (i = n; i-- > 1;) {
+        tmp = a[0];
+        a[0] = a[i];
+        a[i] = tmp;
+        sift_down(a, 0, i);
+    }
+}
+
+static int load_lib(struct elf_lib *lib, struct file *f)
+{
+    unsigned char ident[EI_NIDENT];
+    struct sym_src src[2];
+    void *shdrs = NULL;
+    u64 phoff, shoff, total_names = 0, k;
+    u32 phnum, shnum, shentsize, count = 0, pool = 0, type, link, j;
+    int is64, i, nsrc = 0, ret = -EINVAL;
+
+    if (read_at(f, ident, sizeof(ident), 0) || ident[EI_MAG0] != ELFMAG0 || ident[EI_MAG1] != ELFMAG1 ||
+        ident[EI_MAG2] != ELFMAG2 || ident[EI_MAG3] != ELFMAG3) {
+        return -ENOEXEC;
+    }
+    is64 = ident[EI_CLASS] == ELFCLASS64;
+
+    if (is64) {
+        Elf64_Ehdr eh;
+        Elf64_Phdr ph;
+        if (read_at(f, &eh, sizeof(eh), 0)) return -EIO;
+        phoff = eh.e_phoff;
+        phnum = eh.e_phnum;
+        shoff = eh.e_shoff;
+        shnum = eh.e_shnum;
+        shentsize = eh.e_shentsize;
+        for (j = 0; j < phnum && lib->nsegs < ELF_SYM_MAX_SEGS; j++) {
+            if (read_at(f, &ph, sizeof(ph), phoff + (u64)j * eh.e_phentsize)) return -EIO;
+            if (ph.p_type != PT_LOAD) continue;
+            lib->segs[lib->nsegs].offset = ph.p_offset;
+            lib->segs[lib->nsegs].vaddr = ph.p_vaddr;
+            lib->segs[lib->nsegs++].filesz = ph.p_filesz;
+        }
+        if (shentsize != sizeof(Elf64_Shdr)) return -ENOEXEC;
+    } else {
+        Elf32_Ehdr eh;
+        Elf32_Phdr ph;
+        if (read_at(f, &eh, sizeof(eh), 0)) return -EIO;
+        phoff = eh.e_phoff;
+        phnum = eh.e_phnum;
+        shoff = eh.e_shoff;
+        shnum = eh.e_shnum;
+        shentsize = eh.e_shentsize;
+        for (j = 0; j < phnum && lib->nsegs < ELF_SYM_MAX_SEGS; j++) {
+            if (read_at(f, &ph, sizeof(ph), phoff + (u64)j * eh.e_phentsize)) return -EIO;
+            if (ph.p_type != PT_LOAD) continue;
+            lib->segs[lib->nsegs].offset = ph.p_offset;
+            lib->segs[lib->nsegs].vaddr = ph.p_vaddr;
+            lib->segs[lib->nsegs++].filesz = ph.p_filesz;
+        }
+        if (shentsize != sizeof(Elf32_Shdr)) return -ENOEXEC;
+    }
+    if (!lib->nsegs || !shoff || !shnum || shnum > ELF_SYM_MAX_SHNUM) return -ENOEXEC;
+
+    shdrs = read_alloc(f, shoff, (u64)shnum * shentsize);
+    if (!shdrs) return -EIO;
+
+    // .symtab when the library isn't stripped, .dynsym always
+    for (i = 0; i < shnum && nsrc < 2; i++) {
+        u64 off, size, stroff, strsz;
+        u32 strtype, strlink;
+
+        get_shdr(shdrs, is64, i, &type, &off, &size, &link);
+        if (type != SHT_SYMTAB && type != SHT_DYNSYM) continue;
+        if (link >= shnum) continue;
+        get_shdr(shdrs, is64, link, &strtype, &stroff, &strsz, &strlink);
+        if (strtype != SHT_STRTAB) continue;
+
+        src[nsrc].nsyms = size / (is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
+        src[nsrc].strsz = strsz;
+        src[nsrc].syms = read_alloc(f, off, size);
+        src[nsrc].str = read_alloc(f, stroff, strsz);
+        if (!src[nsrc].syms || !src[nsrc].str) {
+            if (src[nsrc].syms) g_vfree(src[nsrc].syms);
+            if (src[nsrc].str) g_vfree(src[nsrc].str);
+            continue;
+        }
+        nsrc++;
+    }
+
+    // Count first so the table and name pool are allocated once
+    for (i = 0; i < nsrc; i++) {
+        for (k = 0; k < src[i].nsyms && count < ELF_SYM_MAX_SYMS; k++) {
+            u32 name;
+            u64 value, size;
+            u8 info;
+            u16 shndx;
+            get_sym(&src[i], is64, k, &name, &value, &size, &info, &shndx);
+            if (!is_func(name, value, info, shndx) || !str_len(&src[i], name)) continue;
+            total_names += str_len(&src[i], name) + 1;
+            count++;
+        }
+    }
+    if (!count) {
+        ret = -ENOENT;
+        goto out;
+    }
+
+    lib->syms = (struct elf_fsym *)g_vmalloc(count * sizeof(struct elf_fsym));
+    lib->names = (char *)g_vmalloc(total_names);
+    if (!lib->syms || !lib->names) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    count = 0;
+    for (i = 0; i < nsrc; i++) {
+        for (k = 0; k < src[i].nsyms && count < ELF_SYM_MAX_SYMS; k++) {
+            u32 name, n;
+            u64 value, size;
+            u8 info;
+            u16 shndx;
+            get_sym(&src[i], is64, k, &name, &value, &size, &info, &shndx);
+            if (!is_func(name, value, info, shndx) || !(n = str_len(&src[i], name))) continue;
+            // Thumb functions have bit 0 set
+            lib->syms[count].addr = is64 ? value : (value & ~1ULL);
+            lib->syms[count].size = size > 0xffffffffULL ? 0xffffffff : size;
+            lib->syms[count].name = pool;
+            memcpy(lib->names + pool, src[i].str + name, n + 1);
+            pool += n + 1;
+            count++;
+        }
+    }
+
+    // .dynsym repeats most of .symtab, keep one entry per address
+    sort_syms(lib->syms, count);
+    lib->nsyms = 0;
+    for (j = 0; j < count; j++) {
+        if (lib->nsyms && lib->syms[lib->nsyms - 1].addr == lib->syms[j].addr) {
+            if (lib->syms[j].size > lib->syms[lib->nsyms - 1].size) lib->syms[lib->nsyms - 1] = lib->syms[j];
+            continue;
+        }
+        lib->syms[lib->nsyms++] = lib->syms[j];
+    }
+    ret = 0;
+
+out:
+    for (i = 0; i < nsrc; i++) {
+        g_vfree(src[i].syms);
+        g_vfree(src[i].str);
+    }
+    g_vfree(shdrs);
+    if (ret) {
+        if (lib->syms) g_vfree(lib->syms);
+        if (lib->names) g_vfree(lib->names);
+        lib->syms = NULL;
+        lib->names = NULL;
+        lib->nsyms = 0;
+    }
+    return ret;
+}
+
+static struct elf_lib *get_lib(struct file *f, struct inode *inode)
+{
+    struct elf_lib *lib;
+    long state;
+    int i, err;
+
+    for (i = 0; i < ELF_SYM_MAX_LIBS; i++) {
+        state = smp_load_acquire(&libs[i].state);
+        if (state == LIB_EMPTY) break;
+        if (libs[i].inode != inode) continue;
+        // Someone else is still loading it, fall back to the offset this time
+        return state == LIB_READY ? &libs[i] : NULL;
+    }
+
+    for (; i < ELF_SYM_MAX_LIBS; i++) {
+        if (kpm_cmpxchg(&libs[i].state, LIB_EMPTY, LIB_LOADING) == LIB_EMPTY) break;
+    }
+    if (i >= ELF_SYM_MAX_LIBS) return NULL;
+
+    lib = &libs[i];
+    lib->inode = g_igrab(inode);
+    lib->nsegs = 0;
+    lib->nsyms = 0;
+    lib->syms = NULL;
+    lib->names = NULL;
+    if (!lib->inode) {
+        smp_store_release(&lib->state, LIB_FAILED);
+        return NULL;
+    }
+
+    err = load_lib(lib, f);
+    if (err) {
+        pr_info("elf_sym: no symbols (%d), falling back to offsets\n", err);
+        smp_store_release(&lib->state, LIB_FAILED);
+        return NULL;
+    }
+
+    pr_info("elf_sym: cached %u symbols\n", lib->nsyms);
+    smp_store_release(&lib->state, LIB_READY);
+    return lib;
+}
+
+int elf_sym_lookup(struct file *f, struct inode *inode, unsigned long file_off, char *buf, size_t len)
+{
+    struct elf_lib *lib;
+    struct elf_fsym *sym;
+    u64 vaddr = 0;
+    u32 lo, hi;
+    int i, found = 0;
+
+    if (!elf_sym_enabled || !f || !inode || !g_kernel_read) return 0;
+
+    lib = get_lib(f, inode);
+    if (!lib) return 0;
+
+    for (i = 0; i < lib->nsegs; i++) {
+        if (file_off >= lib->segs[i].offset && file_off < lib->segs[i].offset + lib->segs[i].filesz) {
+            vaddr = lib->segs[i].vaddr + file_off - lib->segs[i].offset;
+            found = 1;
+            break;
+        }
+    }
+    if (!found) return 0;
+
+    // Last symbol starting at or below vaddr
+    lo = 0;
+    hi = lib->nsyms;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        if (lib->syms[mid].addr <= vaddr) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return 0;
+
+    sym = &lib->syms[lo - 1];
+    // Sizeless symbols extend to the next one
+    if (sym->size && vaddr >= sym->addr + sym->size) return 0;
+
+    return g_snprintf(buf, len, "%s+0x%llx", lib->names + sym->name, vaddr - sym->addr);
+}
+
+void elf_sym_set_enabled(int enabled)
+{
+    elf_sym_enabled = enabled && g_kernel_read && g_igrab;
+}
+
+int elf_sym_get_enabled(void)
+{
+    return elf_sym_enabled;
+}
+
+void elf_sym_stats(int *nlibs, unsigned long *nsyms)
+{
+    int i;
+
+    *nlibs = 0;
+    *nsyms = 0;
+    for (i = 0; i < ELF_SYM_MAX_LIBS; i++) {
+        if (smp_load_acquire(&libs[i].state) != LIB_READY) continue;
+        (*nlibs)++;
+        *nsyms += libs[i].nsyms;
+    }
+}
+
+int elf_sym_init(void)
+{
+    int i;
+
+    g_vmalloc = (vmalloc_t)kallsyms_lookup_name("vmalloc");
+    g_vfree = (vfree_t)kallsyms_lookup_name("vfree");
+    g_kernel_read = (kernel_read_t)kallsyms_lookup_name("kernel_read");
+    g_igrab = (igrab_t)kallsyms_lookup_name("igrab");
+    g_iput = (iput_t)kallsyms_lookup_name("iput");
+    g_snprintf = (snprintf_t)kallsyms_lookup_name("snprintf");
+
+    for (i = 0; i < ELF_SYM_MAX_LIBS; i++) {
+        libs[i].state = LIB_EMPTY;
+        libs[i].inode = NULL;
+    }
+
+    if (!g_vmalloc || !g_vfree || !g_kernel_read || !g_igrab || !g_iput || !g_snprintf) {
+        pr_warn("elf_sym: kernel_read/igrab missing, symbol resolution unavailable\n");
+        g_kernel_read = NULL;
+    }
+    return 0;
+}
+
+void elf_sym_exit(void)
+{
+    int i;
+
+    elf_sym_enabled = 0;
+    smp_mb();
+
+    for (i = 0; i < ELF_SYM_MAX_LIBS; i++) {
+        if (libs[i].state == LIB_EMPTY) continue;
+        if (libs[i].syms) g_vfree(libs[i].syms);
+        if (libs[i].names) g_vfree(libs[i].names);
+        if (libs[i].inode) g_iput(libs[i].inode);
+        libs[i].syms = NULL;
+        libs[i].names = NULL;
+        libs[i].inode = NULL;
+        libs[i].state = LIB_EMPTY;
+    }
+}
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * User library symbol resolver
+ *
+ * Function symbols of a mapped library are read from its .symtab and
+ * .dynsym once and kept in an address sorted table per inode, shared by
+ * every process that maps it. Lookups after that are a binary search.
+ */
+
+#ifndef _ELF_SYM_H_
+#define _ELF_SYM_H_
+
+#include "common.h"
+
+// Libraries kept in the cache
+#define ELF_SYM_MAX_LIBS 64
+
+// Resolve functions, the cache starts empty and disabled
+int elf_sym_init(void);
+
+// Drop the cache and release the inodes
+void elf_sym_exit(void);
+
+// Enable or disable symbol resolution in get_vma_info_str()
+void elf_sym_set_enabled(int enabled);
+int elf_sym_get_enabled(void);
+
+// Format the function containing file offset file_off of f as "name+0xoff"
+// Loads the library on first use, which reads the file and may sleep
+// Returns: length written, 0 when no symbol covers the offset
+int elf_sym_lookup(struct file *f, struct inode *inode, unsigned long file_off, char *buf, size_t len);
+
+// Number of cached libraries and symbols
+void elf_sym_stats(int *libs, unsigned long *syms);
+
+#endif /* _ELF_SYM_H_ */
@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Hardware breakpoint hit records
+ *
+ * Each ring is a bounded multi-producer queue with a sequence number per
+ * cell. Producers claim a cell with one cmpxchg on head and publish it
+ * with a release store of its sequence. The consumer is the control
+ * command, which KernelPatch already serializes.
+ */
+
+#include <compiler.h>
+#include <kpmodule.h>
+#include <linux/printk.h>
+#include <linux/errno.h>
+#include <barrier.h>
+#include "hw_bp_event.h"
+
+#define HW_BP_EVENT_MASK (HW_BP_EVENT_RING - 1)
+#define HW_BP_EVENT_DRAIN_BATCH 8
+
+struct hw_bp_event_ring {
+    long head;
+    long dropped;
+    u64 tail __attribute__((aligned(64)));
+    u64 seq[HW_BP_EVENT_RING];
+    struct hw_bp_event ev[HW_BP_EVENT_RING];
+};
+
+typedef void *(*vmalloc_t)(unsigned long size);
+typedef void (*vfree_t)(const void *addr);
+
+static vmalloc_t g_vmalloc = NULL;
+static vfree_t g_vfree = NULL;
+static arch_copy_to_user_t g_arch_copy_to_user = NULL;
+
+static struct hw_bp_event_ring *rings = NULL;
+
+static inline struct hw_bp_event_ring *this_ring(void)
+{
+    u64 mpidr;
+    asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    u64 idx = (mpidr & 0xff) + ((mpidr >> 8) & 0xff) + ((mpidr >> 16) & 0xff) * 8;
+    return &rings[idx & (HW_BP_EVENT_CPUS - 1)];
+}
+
+static inline u64 read_cntvct(void)
+{
+    u64 val;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(val));
+    return val;
+}
+
+int hw_bp_event_init(void)
+{
+    int i, j;
+
+    g_vmalloc = (vmalloc_t)kallsyms_lookup_name("vmalloc");
+    g_vfree = (vfree_t)kallsyms_lookup_name("vfree");
+    g_arch_copy_to_user = (arch_copy_to_user_t)kallsyms_lookup_name("__arch_copy_to_user");
+
+    if (!g_vmalloc || !g_vfree || !g_arch_copy_to_user) {
+        pr_err("Failed to resolve breakpoint event functions\n");
+        return -1;
+    }
+
+    rings = (struct hw_bp_event_ring *)g_vmalloc(sizeof(*rings) * HW_BP_EVENT_CPUS);
+    if (!rings) {
+        pr_err("Failed to allocate breakpoint event rings\n");
+        return -1;
+    }
+
+    for (i = 0; i < HW_BP_EVENT_CPUS; i++) {
+        rings[i].head = 0;
+        rings[i].dropped = 0;
+        rings[i].tail = 0;
+        for (j = 0; j < HW_BP_EVENT_RING; j++) {
+            rings[i].seq[j] = j;
+        }
+    }
+    smp_mb();
+
+    pr_info("Breakpoint event rings initialized (%d x %d records)\n", HW_BP_EVENT_CPUS, HW_BP_EVENT_RING);
+    return 0;
+}
+
+void hw_bp_event_exit(void)
+{
+    if (rings && g_vfree) {
+        g_vfree(rings);
+    }
+    rings = NULL;
+}
+
+void hw_bp_event_record(int index, unsigned long addr, struct pt_regs *regs, int flags)
+{
+    struct hw_bp_event_ring *ring;
+    struct hw_bp_event *ev;
+    long pos, old, diff;
+
+    if (unlikely(!rings)) return;
+
+    ring = this_ring();
+    pos = READ_ONCE(ring->head);
+    for (;;) {
+        diff = (long)smp_load_acquire(&ring->seq[pos & HW_BP_EVENT_MASK]) - pos;
+        if (diff == 0) {
+            old = kpm_cmpxchg(&ring->head, pos, pos + 1);
+            if (old == pos) break;
+            pos = old;
+        } else if (diff < 0) {
+            // Full, keep the oldest records
+            kpm_atomic_add_return(&ring->dropped, 1);
+            return;
+        } else {
+            pos = READ_ONCE(ring->head);
+        }
+    }
+
+    ev = &ring->ev[pos & HW_BP_EVENT_MASK];
+    ev->ts = read_cntvct();
+    ev->pc = regs->pc;
+    ev->addr = addr;
+    ev->sp = regs->sp;
+    ev->lr = regs->regs[30];
+    ev->x0 = regs->regs[0];
+    ev->x1 = regs->regs[1];
+    ev->tid = *(pid_t *)((uintptr_t)current + task_struct_offset.pid_offset);
+    ev->index = index;
+    ev->flags = flags;
+    if (regs->pstate & PSR_MODE32_BIT) {
+        ev->flags |= HW_BP_EVENT_F_COMPAT;
+        ev->lr = regs->regs[14];
+    }
+
+    smp_store_release(&ring->seq[pos & HW_BP_EVENT_MASK], (u64)pos + 1);
+}
+
+// Pop one record, 0 if the ring is empty or the next cell is still being written
+static int ring_pop(struct hw_bp_event_ring *ring, struct hw_bp_event *out)
+{
+    u64 pos = ring->tail;
+    u64 *seq = &ring->seq[pos & HW_BP_EVENT_MASK];
+
+    if (smp_load_acquire(seq) != pos + 1) return 0;
+
+    *out = ring->ev[pos & HW_BP_EVENT_MASK];
+    smp_store_release(seq, pos + HW_BP_EVENT_RING);
+    ring->tail = pos + 1;
+    return 1;
+}
+
+long hw_bp_event_drain_user(void __user *out, int outlen, int max)
+{
+    struct hw_bp_event batch[HW_BP_EVENT_DRAIN_BATCH];
+    struct hw_bp_event_batch hdr;
+    char __user *dst = (char __user *)out + sizeof(hdr);
+    int room, n = 0, cpu, empty = 0;
+    u64 dropped = 0;
+
+    if (!rings) return -ENODEV;
+    if (!out || outlen < (int)sizeof(hdr)) return -EINVAL;
+
+    room = (outlen - sizeof(hdr)) / sizeof(struct hw_bp_event);
+    if (max <= 0 || max > room) max = room;
+
+    // Round-robin over the rings so one busy cpu can't starve the others
+    cpu = 0;
+    while (n < max && empty < HW_BP_EVENT_CPUS) {
+        int got = 0;
+        while (got < HW_BP_EVENT_DRAIN_BATCH && n + got < max && ring_pop(&rings[cpu], &batch[got]))
+            got++;
+        if (got) {
+            if (g_arch_copy_to_user(dst, batch, got * sizeof(batch[0]))) return -EFAULT;
+            dst += got * sizeof(batch[0]);
+            n += got;
+            empty = 0;
+        } else {
+            empty++;
+        }
+        cpu = (cpu + 1) & (HW_BP_EVENT_CPUS - 1);
+    }
+
+    for (cpu = 0; cpu < HW_BP_EVENT_CPUS; cpu++) {
+        long d = READ_ONCE(rings[cpu].dropped);
+        if (d) {
+            kpm_atomic_add_return(&rings[cpu].dropped, -d);
+            dropped += d;
+        }
+    }
+
+    hdr.count = n;
+    hdr.rec_size = sizeof(struct hw_bp_event);
+    hdr.dropped = dropped;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(hdr.freq));
+    if (g_arch_copy_to_user(out, &hdr, sizeof(hdr))) return -EFAULT;
+
+    return n;
+}
+
+void hw_bp_event_reset(void)
+{
+    struct hw_bp_event ev;
+    int cpu;
+
+    if (!rings) return;
+
+    for (cpu = 0; cpu < HW_BP_EVENT_CPUS; cpu++) {
+        while (ring_pop(&rings[cpu], &ev))
+            ;
+        WRITE_ONCE(rings[cpu].dropped, 0);
+    }
+}
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Hardware breakpoint hit records
+ *
+ * The breakpoint handler runs in debug exception context, so it only
+ * appends a fixed size record to a lock-free ring of the current cpu.
+ * Formatting happens in userspace after the rings are drained.
+ */
+
+#ifndef _HW_BP_EVENT_H_
+#define _HW_BP_EVENT_H_
+
+#include "common.h"
+
+// Rings are picked by an MPIDR hash, cpus sharing a ring stay correct
+#define HW_BP_EVENT_CPUS 16
+// Records per ring, power of two
+#define HW_BP_EVENT_RING 256
+
+// Record flags
+#define HW_BP_EVENT_F_COMPAT   0x1  // Hit from an AArch32 task
+#define HW_BP_EVENT_F_DISARMED 0x2  // Re-arm failed, breakpoint was disabled
+
+// One hit, 64 bytes
+struct hw_bp_event {
+    u64 ts;          // cntvct_el0 at hit time
+    u64 pc;
+    u64 addr;        // Breakpoint or data address
+    u64 sp;
+    u64 lr;
+    u64 x0;
+    u64 x1;
+    u32 tid;
+    u16 index;       // Breakpoint index
+    u16 flags;
+};
+
+// Header in front of the records written by hw_bp_event_drain_user()
+struct hw_bp_event_batch {
+    u32 count;       // Records following this header
+    u32 rec_size;    // sizeof(struct hw_bp_event)
+    u64 dropped;     // Records lost to full rings since the last drain
+    u64 freq;        // cntfrq_el0, to convert ts
+};
+
+// Initialize the per-cpu rings
+int hw_bp_event_init(void);
+
+// Free the rings, breakpoints must already be cleared
+void hw_bp_event_exit(void);
+
+// Append a hit to the current cpu's ring, safe in exception context
+void hw_bp_event_record(int index, unsigned long addr, struct pt_regs *regs, int flags);
+
+// Move up to max records into a user buffer of outlen bytes, header first
+// Returns: number of records copied, or negative error code
+long hw_bp_event_drain_user(void __user *out, int outlen, int max);
+
+// Discard all pending records
+void hw_bp_event_reset(void);
+
+#endif /* _HW_BP_EVENT_H_ */
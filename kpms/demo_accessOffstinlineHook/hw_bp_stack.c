@@ -0,0 +1,198 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Hardware breakpoint call-path profile
+ *
+ * Open addressing table keyed by a hash of breakpoint index and frames.
+ * A producer claims an empty slot with one cmpxchg on the key, fills in
+ * the frames and publishes them with a release store of ready. The count
+ * is bumped atomically, so hits from several cpus on the same path only
+ * share a cache line. Frames are unwound into a buffer on the exception
+ * stack, which is per cpu by construction.
+ */
+
+#include <compiler.h>
+#include <kpmodule.h>
+#include <linux/printk.h>
+#include <linux/errno.h>
+#include <barrier.h>
+#include "hw_bp_stack.h"
+#include "stack_unwind.h"
+
+#define HW_BP_STACK_MASK (HW_BP_STACK_SLOTS - 1)
+#define HW_BP_STACK_PROBE 32
+#define HW_BP_STACK_FETCH_BATCH 8
+
+struct hw_bp_stack_slot {
+    long key;        // Path hash, 0 = empty
+    long count;
+    long ready;      // Frames are filled in
+    u16 index;
+    u16 depth;
+    u64 pcs[HW_BP_STACK_DEPTH];
+};
+
+typedef void *(*vmalloc_t)(unsigned long size);
+typedef void (*vfree_t)(const void *addr);
+
+static vmalloc_t g_vmalloc = NULL;
+static vfree_t g_vfree = NULL;
+static arch_copy_to_user_t g_arch_copy_to_user = NULL;
+
+static struct hw_bp_stack_slot *slots = NULL;
+static long stack_dropped = 0;
+
+// FNV-1a over the index and frames, never 0
+static inline long stack_hash(int index, const unsigned long *pcs, int n)
+{
+    u64 h = 0xcbf29ce484222325ULL ^ (u64)index;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        h ^= pcs[i];
+        h *= 0x100000001b3ULL;
+    }
+    return (long)(h | 1);
+}
+
+int hw_bp_stack_init(void)
+{
+    int i;
+
+    g_vmalloc = (vmalloc_t)kallsyms_lookup_name("vmalloc");
+    g_vfree = (vfree_t)kallsyms_lookup_name("vfree");
+    g_arch_copy_to_user = (arch_copy_to_user_t)kallsyms_lookup_name("__arch_copy_to_user");
+
+    if (!g_vmalloc || !g_vfree || !g_arch_copy_to_user) {
+        pr_err("Failed to resolve breakpoint stack functions\n");
+        return -1;
+    }
+
+    slots = (struct hw_bp_stack_slot *)g_vmalloc(sizeof(*slots) * HW_BP_STACK_SLOTS);
+    if (!slots) {
+        pr_err("Failed to allocate breakpoint stack table\n");
+        return -1;
+    }
+
+    for (i = 0; i < HW_BP_STACK_SLOTS; i++) {
+        slots[i].key = 0;
+        slots[i].count = 0;
+        slots[i].ready = 0;
+    }
+    stack_dropped = 0;
+    smp_mb();
+
+    pr_info("Breakpoint stack table initialized (%d paths, depth %d)\n", HW_BP_STACK_SLOTS, HW_BP_STACK_DEPTH);
+    return 0;
+}
+
+void hw_bp_stack_exit(void)
+{
+    if (slots && g_vfree) {
+        g_vfree(slots);
+    }
+    slots = NULL;
+}
+
+void hw_bp_stack_record(int index, struct pt_regs *regs, int depth)
+{
+    unsigned long pcs[HW_BP_STACK_DEPTH];
+    struct hw_bp_stack_slot *slot;
+    long key, old;
+    int n, i, pos, probe;
+
+    if (unlikely(!slots)) return;
+
+    if (depth > HW_BP_STACK_DEPTH) depth = HW_BP_STACK_DEPTH;
+    n = unwind_user_frames(regs, pcs, depth);
+    if (n <= 0) {
+        kpm_atomic_add_return(&stack_dropped, 1);
+        return;
+    }
+
+    key = stack_hash(index, pcs, n);
+    pos = key & HW_BP_STACK_MASK;
+    for (probe = 0; probe < HW_BP_STACK_PROBE; probe++, pos = (pos + 1) & HW_BP_STACK_MASK) {
+        slot = &slots[pos];
+        old = READ_ONCE(slot->key);
+        if (old == 0) {
+            old = kpm_cmpxchg(&slot->key, 0, key);
+            if (old == 0) {
+                slot->index = index;
+                slot->depth = n;
+                for (i = 0; i < n; i++) slot->pcs[i] = pcs[i];
+                smp_store_release(&slot->ready, 1);
+            }
+        }
+        // 64-bit hash, a match is taken as the same path
+        if (old == 0 || old == key) {
+            kpm_atomic_add_return(&slot->count, 1);
+            return;
+        }
+    }
+
+    kpm_atomic_add_return(&stack_dropped, 1);
+}
+
+long hw_bp_stack_fetch_user(void __user *out, int outlen, int start)
+{
+    struct hw_bp_stack batch[HW_BP_STACK_FETCH_BATCH];
+    struct hw_bp_stack_batch hdr;
+    char __user *dst = (char __user *)out + sizeof(hdr);
+    int room, n = 0, got = 0, pos, i;
+
+    if (!slots) return -ENODEV;
+    if (!out || outlen < (int)sizeof(hdr)) return -EINVAL;
+    if (start < 0 || start >= HW_BP_STACK_SLOTS) start = 0;
+
+    room = (outlen - sizeof(hdr)) / sizeof(struct hw_bp_stack);
+
+    for (pos = start; pos < HW_BP_STACK_SLOTS && n + got < room; pos++) {
+        struct hw_bp_stack_slot *slot = &slots[pos];
+        struct hw_bp_stack *st;
+
+        if (!READ_ONCE(slot->key) || !smp_load_acquire(&slot->ready)) continue;
+
+        st = &batch[got++];
+        st->stack_id = pos;
+        st->index = slot->index;
+        st->depth = slot->depth;
+        st->count = READ_ONCE(slot->count);
+        for (i = 0; i < HW_BP_STACK_DEPTH; i++) st->pcs[i] = i < st->depth ? slot->pcs[i] : 0;
+
+        if (got == HW_BP_STACK_FETCH_BATCH) {
+            if (g_arch_copy_to_user(dst, batch, got * sizeof(batch[0]))) return -EFAULT;
+            dst += got * sizeof(batch[0]);
+            n += got;
+            got = 0;
+        }
+    }
+    if (got) {
+        if (g_arch_copy_to_user(dst, batch, got * sizeof(batch[0]))) return -EFAULT;
+        n += got;
+    }
+
+    hdr.count = n;
+    hdr.rec_size = sizeof(struct hw_bp_stack);
+    hdr.dropped = READ_ONCE(stack_dropped);
+    hdr.next = pos < HW_BP_STACK_SLOTS ? pos : 0;
+    hdr.reserved = 0;
+    if (g_arch_copy_to_user(out, &hdr, sizeof(hdr))) return -EFAULT;
+
+    return n;
+}
+
+// Paths recorded while resetting may survive or lose a few counts
+void hw_bp_stack_reset(void)
+{
+    int i;
+
+    if (!slots) return;
+
+    for (i = 0; i < HW_BP_STACK_SLOTS; i++) {
+        WRITE_ONCE(slots[i].ready, 0);
+        WRITE_ONCE(slots[i].count, 0);
+        smp_wmb();
+        WRITE_ONCE(slots[i].key, 0);
+    }
+    WRITE_ONCE(stack_dropped, 0);
+}
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Hardware breakpoint call-path profile
+ *
+ * Breakpoints with stack capture on unwind the user stack at hit time and
+ * count the hit against its call path. Identical paths share one entry, so
+ * a hot watchpoint costs a table slot per distinct caller, not per hit.
+ */
+
+#ifndef _HW_BP_STACK_H_
+#define _HW_BP_STACK_H_
+
+#include "common.h"
+
+// Max captured frames per hit, pc included
+#define HW_BP_STACK_DEPTH 16
+// Call-path entries, power of two
+#define HW_BP_STACK_SLOTS 2048
+
+// One call path and its hit count
+struct hw_bp_stack {
+    u32 stack_id;    // Table slot, stable until the next reset
+    u16 index;       // Breakpoint index
+    u16 depth;       // Valid entries in pcs
+    u64 count;
+    u64 pcs[HW_BP_STACK_DEPTH];
+};
+
+// Header in front of the entries written by hw_bp_stack_fetch_user()
+struct hw_bp_stack_batch {
+    u32 count;       // Entries following this header
+    u32 rec_size;    // sizeof(struct hw_bp_stack)
+    u64 dropped;     // Hits lost to a full table or a failed unwind
+    u32 next;        // Slot to resume from, 0 when done
+    u32 reserved;
+};
+
+// Allocate the call-path table
+int hw_bp_stack_init(void);
+
+// Free the table, breakpoints must already be cleared
+void hw_bp_stack_exit(void);
+
+// Unwind regs up to depth frames and count the path for breakpoint index
+// Safe in breakpoint handler context
+void hw_bp_stack_record(int index, struct pt_regs *regs, int depth);
+
+// Copy entries from slot start on into a user buffer of outlen bytes, header first
+// Entries stay in the table
+// Returns: number of entries copied, or negative error code
+long hw_bp_stack_fetch_user(void __user *out, int outlen, int start);
+
+// Drop all call paths
+void hw_bp_stack_reset(void);
+
+#endif /* _HW_BP_STACK_H_ */
@@ -6,12 +6,18 @@
 
 #include <compiler.h>
 #include <kpmodule.h>
+#include <hook.h>
 #include <linux/printk.h>
 #include <linux/sched.h>
 #include <linux/errno.h>
+#include <barrier.h>
 #include "hw_breakpoint.h"
 #include "process_info.h"
 #include "stack_unwind.h"
+#include "hw_bp_event.h"
+#include "hw_bp_stack.h"
+#include "common.h"
+#include <pcrel.h>
 
 // Forward declarations for structures we'll use as opaque pointers
 struct perf_event;
@@ -21,62 +27,65 @@ struct task_struct;
 struct pid;
 struct perf_sample_data;  // Add this for correct handler signature
 
-// ARM64 debug register manipulation functions
-// These allow us to temporarily disable/enable breakpoints at hardware level
+// ARM64 debug register manipulation
+// These allow us to temporarily disable/enable breakpoints at hardware level.
+// perf picks the hardware slot, so the slot is found by matching the value
+// register on the current cpu instead of being tracked here.
 
-// Function pointer types for debug register access
-typedef void (*write_wb_reg_t)(int n, u64 val);
-typedef u64 (*read_wb_reg_t)(int n);
+#define DBG_REG_BVR 0
+#define DBG_REG_BCR 1
+#define DBG_REG_WVR 2
+#define DBG_REG_WCR 3
 
-// Global function pointers for debug register access
-static write_wb_reg_t g_aarch64_insn_write_DBGBCR = NULL;
-static write_wb_reg_t g_aarch64_insn_write_DBGBVR = NULL;
-static read_wb_reg_t g_aarch64_insn_read_DBGBCR = NULL;
-static read_wb_reg_t g_aarch64_insn_read_DBGBVR = NULL;
+#define DBG_CTRL_ENABLE 0x1ULL
 
-// Track which hardware slot each breakpoint uses
-static int bp_hw_slot[MAX_HW_BREAKPOINTS];  // -1 = not assigned
+#define DBG_READ_CASE(reg, name, n) \
+    case ((reg) << 4) | (n):        \
+        asm volatile("mrs %0, " #name #n "_el1" : "=r"(val)); \
+        break
+#define DBG_WRITE_CASE(reg, name, n) \
+    case ((reg) << 4) | (n):         \
+        asm volatile("msr " #name #n "_el1, %0" : : "r"(val)); \
+        break
+#define DBG_CASES(op, reg, name) \
+    op(reg, name, 0); op(reg, name, 1); op(reg, name, 2); op(reg, name, 3); \
+    op(reg, name, 4); op(reg, name, 5); op(reg, name, 6); op(reg, name, 7); \
+    op(reg, name, 8); op(reg, name, 9); op(reg, name, 10); op(reg, name, 11); \
+    op(reg, name, 12); op(reg, name, 13); op(reg, name, 14); op(reg, name, 15)
 
-// Temporarily disable breakpoint at hardware level
-static void toggle_bp_hw_disable(int slot)
+static u64 read_dbg_reg(int reg, int n)
 {
-    if (slot < 0 || slot >= 16) return;  // ARM64 supports up to 16 HW breakpoints
-    
-    if (g_aarch64_insn_write_DBGBCR) {
-        // Read current control register
-        u64 bcr = 0;
-        if (g_aarch64_insn_read_DBGBCR) {
-            bcr = g_aarch64_insn_read_DBGBCR(slot);
-        }
-        
-        // Clear enable bit (bit 0)
-        bcr &= ~0x1ULL;
-        
-        // Write back
-        g_aarch64_insn_write_DBGBCR(slot, bcr);
+    u64 val = 0;
+    switch ((reg << 4) | n) {
+        DBG_CASES(DBG_READ_CASE, DBG_REG_BVR, dbgbvr);
+        DBG_CASES(DBG_READ_CASE, DBG_REG_BCR, dbgbcr);
+        DBG_CASES(DBG_READ_CASE, DBG_REG_WVR, dbgwvr);
+        DBG_CASES(DBG_READ_CASE, DBG_REG_WCR, dbgwcr);
     }
+    return val;
 }
 
-// Re-enable breakpoint at hardware level
-static void toggle_bp_hw_enable(int slot)
+static void write_dbg_reg(int reg, int n, u64 val)
 {
-    if (slot < 0 || slot >= 16) return;
-    
-    if (g_aarch64_insn_write_DBGBCR) {
-        // Read current control register
-        u64 bcr = 0;
-        if (g_aarch64_insn_read_DBGBCR) {
-            bcr = g_aarch64_insn_read_DBGBCR(slot);
-        }
-        
-        // Set enable bit (bit 0)
-        bcr |= 0x1ULL;
-        
-        // Write back
-        g_aarch64_insn_write_DBGBCR(slot, bcr);
+    switch ((reg << 4) | n) {
+        DBG_CASES(DBG_WRITE_CASE, DBG_REG_BVR, dbgbvr);
+        DBG_CASES(DBG_WRITE_CASE, DBG_REG_BCR, dbgbcr);
+        DBG_CASES(DBG_WRITE_CASE, DBG_REG_WVR, dbgwvr);
+        DBG_CASES(DBG_WRITE_CASE, DBG_REG_WCR, dbgwcr);
     }
+    asm volatile("isb" : : : "memory");
 }
 
+// Number of breakpoint or watchpoint register pairs from ID_AA64DFR0_EL1
+static int dbg_slot_count(int watch)
+{
+    u64 dfr0;
+    asm volatile("mrs %0, id_aa64dfr0_el1" : "=r"(dfr0));
+    return (int)((dfr0 >> (watch ? 20 : 12)) & 0xf) + 1;
+}
+
+static void toggle_bp_hw(int index, int enable);
+
 // Function pointer types for hardware breakpoint API
 typedef struct perf_event *(*register_wide_hw_breakpoint_t)(
     struct perf_event_attr *attr,
@@ -121,6 +130,63 @@ static int bp_at_next_instruction[MAX_HW_BREAKPOINTS];  // 1 = currently at next
 static unsigned long bp_original_addr[MAX_HW_BREAKPOINTS];  // Original breakpoint address
 static unsigned long bp_next_addr[MAX_HW_BREAKPOINTS];  // Next instruction address
 
+// Hit conditions and their runtime state
+static struct hw_bp_cond bp_cond[MAX_HW_BREAKPOINTS];
+static long bp_cond_seen[MAX_HW_BREAKPOINTS];       // Hits that passed tid and register checks
+static long bp_cond_tat[MAX_HW_BREAKPOINTS];        // Rate limit: theoretical arrival time, cntvct ticks
+static long bp_cond_interval[MAX_HW_BREAKPOINTS];   // Rate limit: ticks per kept hit
+static long bp_cond_tolerance[MAX_HW_BREAKPOINTS];  // Rate limit: burst allowance in ticks
+
+static inline int hw_bp_reg_match(int op, unsigned long reg, unsigned long val)
+{
+    switch (op) {
+        case HW_BP_COND_EQ: return reg == val;
+        case HW_BP_COND_NE: return reg != val;
+        case HW_BP_COND_LT: return reg < val;
+        case HW_BP_COND_GT: return reg > val;
+        case HW_BP_COND_AND: return (reg & val) != 0;
+    }
+    return 1;
+}
+
+// Evaluate the conditions of breakpoint i for one hit, lock-free
+// The rate limit is a token bucket kept as a single arrival time (GCRA),
+// so concurrent hits only need one cmpxchg.
+static int hw_bp_cond_pass(int i, struct pt_regs *regs)
+{
+    struct hw_bp_cond *c = &bp_cond[i];
+    long seen, now, tat, old;
+    int j;
+
+    if (!breakpoints[i].has_cond) return 1;
+
+    if (c->tid && *(pid_t *)((uintptr_t)current + task_struct_offset.pid_offset) != c->tid) return 0;
+
+    for (j = 0; j < HW_BP_MAX_REG_CONDS; j++) {
+        if (c->regs[j].op != HW_BP_COND_NONE &&
+            !hw_bp_reg_match(c->regs[j].op, regs->regs[c->regs[j].reg], c->regs[j].val))
+            return 0;
+    }
+
+    if (c->skip || c->sample > 1) {
+        seen = kpm_atomic_add_return(&bp_cond_seen[i], 1);
+        if (seen <= c->skip) return 0;
+        if (c->sample > 1 && (seen - c->skip - 1) % c->sample) return 0;
+    }
+
+    if (c->rate) {
+        asm volatile("mrs %0, cntvct_el0" : "=r"(now));
+        for (;;) {
+            old = READ_ONCE(bp_cond_tat[i]);
+            tat = old < now ? now : old;
+            if (tat - now > bp_cond_tolerance[i]) return 0;
+            if (kpm_cmpxchg(&bp_cond_tat[i], old, tat + bp_cond_interval[i]) == old) break;
+        }
+    }
+
+    return 1;
+}
+
 // perf_event_attr structure (minimal definition to avoid header conflicts)
 struct perf_event_attr_minimal {
     unsigned int type;
@@ -184,11 +250,383 @@ struct perf_event_attr_minimal {
 // PID type constant
 #define PIDTYPE_PID 0
 
+// Range watchpoints
+//
+// DBGWCR.MASK makes a watchpoint match every address in an aligned
+// power-of-two block. perf has no notion of it and rewrites the control
+// register whenever it installs the slot, so the mask is put back from an
+// after hook on arch_install_hw_breakpoint.
+
+#define DBG_WCR_BAS_MASK   (0xffULL << 5)
+#define DBG_WCR_MASK_SHIFT 24
+#define DBG_WCR_MASK_MASK  (0x1fULL << DBG_WCR_MASK_SHIFT)
+
+static void *g_arch_install_hw_breakpoint = NULL;
+static int bp_install_hooked = 0;
+static unsigned long bp_range_base[MAX_HW_BREAKPOINTS];
+static int bp_range_mask[MAX_HW_BREAKPOINTS];  // 0 = plain watchpoint
+
+static void after_arch_install_hw_breakpoint(hook_fargs1_t *args, void *udata)
+{
+    int i, n, count;
+    
+    if (args->ret) return;
+    
+    count = dbg_slot_count(1);
+    for (i = 0; i < MAX_HW_BREAKPOINTS; i++) {
+        if (!READ_ONCE(bp_range_mask[i])) continue;
+        
+        for (n = 0; n < count; n++) {
+            u64 ctrl = read_dbg_reg(DBG_REG_WCR, n);
+            
+            // Freshly installed 8-byte slot on the block base
+            if (!(ctrl & DBG_CTRL_ENABLE) || (ctrl & DBG_WCR_MASK_MASK)) continue;
+            if ((ctrl & DBG_WCR_BAS_MASK) != DBG_WCR_BAS_MASK) continue;
+            if (read_dbg_reg(DBG_REG_WVR, n) != bp_range_base[i]) continue;
+            
+            write_dbg_reg(DBG_REG_WCR, n, ctrl | ((u64)bp_range_mask[i] << DBG_WCR_MASK_SHIFT));
+        }
+    }
+}
+
+// Faulting data address of the watchpoint being handled
+static inline unsigned long hw_bp_fault_addr(void)
+{
+    unsigned long far;
+    asm volatile("mrs %0, far_el1" : "=r"(far));
+    return far;
+}
+
+// A masked watchpoint covers a whole block, keep hits inside the requested range.
+// FAR can be any byte of the access, so an access starting in the 8-byte granule
+// before the range still counts.
+static inline int hw_bp_in_range(int i, unsigned long far)
+{
+    if (!breakpoints[i].range_len) return 1;
+    return far >= (breakpoints[i].range_start & ~0x7UL) &&
+           far < breakpoints[i].range_start + breakpoints[i].range_len;
+}
+
+// Temporarily disable or re-enable breakpoint index on the current cpu
+static void toggle_bp_hw(int index, int enable)
+{
+    int watch = breakpoints[index].type != HW_BP_TYPE_EXEC;
+    int vr = watch ? DBG_REG_WVR : DBG_REG_BVR;
+    int cr = watch ? DBG_REG_WCR : DBG_REG_BCR;
+    u64 want = breakpoints[index].addr & (watch ? ~0x7UL : ~0x3UL);
+    int n, count = dbg_slot_count(watch);
+    
+    for (n = 0; n < count; n++) {
+        u64 ctrl = read_dbg_reg(cr, n);
+        
+        // Skip free slots and slots already in the requested state
+        if (!ctrl || !!(ctrl & DBG_CTRL_ENABLE) == !!enable) continue;
+        if (read_dbg_reg(vr, n) != want) continue;
+        
+        write_dbg_reg(cr, n, enable ? (ctrl | DBG_CTRL_ENABLE) : (ctrl & ~DBG_CTRL_ENABLE));
+        return;
+    }
+}
+
+// Single-step re-arm engine
+//
+// On a hit from user space the slot is disabled on this cpu and the task is
+// stepped over the trapping instruction. The step exception lands in our
+// step hook, which re-enables the slot. A hit costs the breakpoint exception
+// plus one step exception, with no perf reconfiguration, and it works for
+// branches and data watchpoints where pc+4 is never reached.
+
+#define DBG_HOOK_HANDLED 0
+#define DBG_HOOK_ERROR   1
+
+// Tasks waiting for their step, claimed with cmpxchg
+#define HW_BP_STEP_PENDING 64
+
+struct step_hook {
+    struct list_head node;
+    int (*fn)(struct pt_regs *regs, unsigned long esr);
+};
+
+typedef void (*step_hook_reg_t)(struct step_hook *hook);
+typedef void (*single_step_t)(struct task_struct *task);
+
+static step_hook_reg_t g_register_step_hook = NULL;
+static step_hook_reg_t g_unregister_step_hook = NULL;
+static single_step_t g_user_enable_single_step = NULL;
+static single_step_t g_user_disable_single_step = NULL;
+
+// One pending step, owned by its task: only that task arms, consumes or replaces it
+struct bp_step {
+    long task;               // Waiting task, 0 = free
+    int index;
+    unsigned long next_pc;   // pc after the stepped instruction
+    unsigned long branch_pc; // or its branch target, 0 if it doesn't branch
+    unsigned long pc_mask;   // bits compared against branch_pc, PAC bits stay out
+};
+
+#define USER_VA_MASK ((1UL << 48) - 1)
+
+static struct bp_step bp_step[HW_BP_STEP_PENDING];
+static int bp_rearm_mode = HW_BP_REARM_MOVE;
+static int bp_step_hook_registered = 0;
+static arch_copy_from_user_t g_bp_copy_from_user = NULL;
+static void *g_do_exit = NULL;
+static int bp_exit_hooked = 0;
+
+static int hw_bp_step_handler(struct pt_regs *regs, unsigned long esr)
+{
+    long task = (long)current;
+    struct bp_step *step;
+    int j;
+    
+    for (j = 0; j < HW_BP_STEP_PENDING; j++) {
+        step = &bp_step[j];
+        if (READ_ONCE(step->task) != task) continue;
+        
+        // A step that didn't land after our instruction is someone else's, e.g. ptrace
+        if (regs->pc != step->next_pc &&
+            (!step->branch_pc || ((regs->pc ^ step->branch_pc) & step->pc_mask))) {
+            return DBG_HOOK_ERROR;
+        }
+        
+        smp_store_release(&step->task, 0);
+        if (breakpoints[step->index].enabled) toggle_bp_hw(step->index, 1);
+        g_user_disable_single_step(current);
+        return DBG_HOOK_HANDLED;
+    }
+    
+    return DBG_HOOK_ERROR;
+}
+
+static struct step_hook hw_bp_step_hook = {
+    .fn = hw_bp_step_handler,
+};
+
+// Where the instruction at pc may continue besides pc + 4
+// Returns: 0 on success, negative if it can't be read
+static int hw_bp_step_target(int index, struct pt_regs *regs, struct bp_step *step)
+{
+    u32 inst;
+    int cls;
+    
+    step->next_pc = regs->pc + 4;
+    step->branch_pc = 0;
+    step->pc_mask = ~0UL;
+    
+    // Watchpoints trap on loads and stores, which never branch
+    if (breakpoints[index].type != HW_BP_TYPE_EXEC) return 0;
+    if (!g_bp_copy_from_user || g_bp_copy_from_user(&inst, (const void __user *)regs->pc, sizeof(inst))) {
+        return -EFAULT;
+    }
+    
+    cls = pcrel_class(inst);
+    if (cls == PCREL_B || cls == PCREL_BL || cls == PCREL_BC || cls == PCREL_CBZ || cls == PCREL_CBNZ ||
+        cls == PCREL_TBZ || cls == PCREL_TBNZ) {
+        step->branch_pc = pcrel_target(inst, cls, regs->pc);
+    } else if ((inst & 0xfe000000) == 0xd6000000) {
+        // BR, BLR, RET and their authenticated forms
+        int rn = (inst >> 5) & 0x1f;
+        if (rn == 31) return -EINVAL;
+        step->branch_pc = regs->regs[rn];
+        step->pc_mask = USER_VA_MASK;
+    }
+    return 0;
+}
+
+// Step the current task over breakpoint index
+// Returns: 0 when the step is armed, negative to fall back to move-to-next
+static int hw_bp_step_arm(int index, struct pt_regs *regs)
+{
+    long task = (long)current;
+    struct bp_step next;
+    int j;
+    
+    if (!user_mode(regs)) return -EINVAL;
+    if (hw_bp_step_target(index, regs, &next)) return -EFAULT;
+    
+    // A hit again before the step, e.g. after preemption, replaces the old entry
+    for (j = 0; j < HW_BP_STEP_PENDING; j++) {
+        if (READ_ONCE(bp_step[j].task) == task) break;
+    }
+    if (j < HW_BP_STEP_PENDING) {
+        int old = bp_step[j].index;
+        if (old != index && breakpoints[old].enabled) toggle_bp_hw(old, 1);
+    } else {
+        for (j = 0; j < HW_BP_STEP_PENDING; j++) {
+            if (READ_ONCE(bp_step[j].task) == 0 && kpm_cmpxchg(&bp_step[j].task, 0, task) == 0) break;
+        }
+        if (j >= HW_BP_STEP_PENDING) return -EBUSY;
+    }
+    
+    bp_step[j].index = index;
+    bp_step[j].next_pc = next.next_pc;
+    bp_step[j].branch_pc = next.branch_pc;
+    bp_step[j].pc_mask = next.pc_mask;
+    toggle_bp_hw(index, 0);
+    g_user_enable_single_step(current);
+    return 0;
+}
+
+// An exiting task never takes its step, and its task_struct may come back as another task
+static void before_do_exit(hook_fargs1_t *args, void *udata)
+{
+    long task = (long)current;
+    int j;
+    
+    for (j = 0; j < HW_BP_STEP_PENDING; j++) {
+        if (READ_ONCE(bp_step[j].task) == task) smp_store_release(&bp_step[j].task, 0);
+    }
+}
+
+// Uprobe fallback
+//
+// Per-process breakpoints are perf events bound to their thread, so perf
+// installs them into the physical slots only while that thread runs.
+// When a thread has no slot left, an exec breakpoint falls back to a uprobe
+// on the backing file. Uprobes are per file and hit in every process that
+// maps it, so the handler keeps only hits from the target process.
+
+// Prefix of struct uprobe_consumer, the tail (list linkage, id) differs between versions
+struct uprobe_consumer_compat {
+    int (*handler)(struct uprobe_consumer_compat *self, struct pt_regs *regs);
+    void *ret_handler;
+    void *filter;
+    void *tail[4];
+};
+
+typedef int (*uprobe_register_t)(struct inode *inode, loff_t offset, struct uprobe_consumer_compat *uc);
+typedef void (*uprobe_unregister_t)(struct inode *inode, loff_t offset, struct uprobe_consumer_compat *uc);
+// 6.12 and later
+typedef void *(*uprobe_register_v2_t)(struct inode *inode, loff_t offset, loff_t ref_ctr_offset,
+                                      struct uprobe_consumer_compat *uc);
+typedef void (*uprobe_unregister_nosync_t)(void *uprobe, struct uprobe_consumer_compat *uc);
+typedef void (*uprobe_unregister_sync_t)(void);
+typedef void (*iput_t)(struct inode *inode);
+
+static void *g_uprobe_register = NULL;
+static uprobe_unregister_t g_uprobe_unregister = NULL;
+static uprobe_unregister_nosync_t g_uprobe_unregister_nosync = NULL;
+static uprobe_unregister_sync_t g_uprobe_unregister_sync = NULL;
+static iput_t g_iput = NULL;
+
+static struct uprobe_consumer_compat bp_uprobe_consumers[MAX_HW_BREAKPOINTS];
+static struct inode *bp_uprobe_inode[MAX_HW_BREAKPOINTS];
+static unsigned long bp_uprobe_offset[MAX_HW_BREAKPOINTS];
+static void *bp_uprobe_handle[MAX_HW_BREAKPOINTS];  // 6.12+ only
+// uprobe 按 inode 命中所有进程，只认目标线程；pid 防 task_struct 复用
+static struct task_struct *bp_uprobe_task[MAX_HW_BREAKPOINTS];
+static pid_t bp_uprobe_tid[MAX_HW_BREAKPOINTS];
+
+static int hw_bp_uprobe_handler(struct uprobe_consumer_compat *self, struct pt_regs *regs)
+{
+    int i = self - bp_uprobe_consumers;
+    
+    if (!breakpoints[i].enabled) return 0;
+    if (current != bp_uprobe_task[i]) return 0;
+    if (*(pid_t *)((uintptr_t)current + task_struct_offset.pid_offset) != bp_uprobe_tid[i]) return 0;
+    
+    if (hw_bp_cond_pass(i, regs)) {
+        kpm_atomic_inc(&breakpoints[i].hit_count);
+        hw_bp_event_record(i, breakpoints[i].addr, regs, 0);
+        if (breakpoints[i].stack_depth) {
+            hw_bp_stack_record(i, regs, breakpoints[i].stack_depth);
+        }
+    } else {
+        kpm_atomic_inc(&breakpoints[i].filtered_count);
+    }
+    
+    // Keep the probe
+    return 0;
+}
+
+static int hw_bp_uprobe_set(int i, struct task_struct *task, unsigned long addr)
+{
+    struct uprobe_consumer_compat *uc = &bp_uprobe_consumers[i];
+    unsigned long offset = 0;
+    struct inode *inode;
+    int err = 0;
+    
+    if (!g_uprobe_register || !g_iput || (!g_uprobe_unregister && !g_uprobe_unregister_nosync)) {
+        return -ENOSYS;
+    }
+    if (!vma_inode_supported()) {
+        pr_err("Uprobe fallback: struct file layout unknown\n");
+        return -ENOSYS;
+    }
+    
+    inode = get_vma_inode(task, addr, &offset);
+    if (!inode) {
+        pr_err("Uprobe fallback: 0x%lx is not in a file mapping\n", addr);
+        return -EINVAL;
+    }
+    
+    memset(uc, 0, sizeof(*uc));
+    uc->handler = hw_bp_uprobe_handler;
+    bp_uprobe_task[i] = task;
+    bp_uprobe_tid[i] = *(pid_t *)((uintptr_t)task + task_struct_offset.pid_offset);
+    
+    if (g_uprobe_unregister_nosync) {
+        void *uprobe = ((uprobe_register_v2_t)g_uprobe_register)(inode, offset, 0, uc);
+        if (IS_ERR(uprobe)) {
+            err = (int)(long)uprobe;
+        } else {
+            bp_uprobe_handle[i] = uprobe;
+        }
+    } else {
+        err = ((uprobe_register_t)g_uprobe_register)(inode, offset, uc);
+    }
+    
+    if (err) {
+        g_iput(inode);
+        pr_err("Uprobe fallback: uprobe_register failed: %d\n", err);
+        return err;
+    }
+    
+    bp_uprobe_inode[i] = inode;
+    bp_uprobe_offset[i] = offset;
+    return 0;
+}
+
+static void hw_bp_uprobe_clear(int i)
+{
+    if (!bp_uprobe_inode[i]) return;
+    
+    if (g_uprobe_unregister_nosync) {
+        g_uprobe_unregister_nosync(bp_uprobe_handle[i], &bp_uprobe_consumers[i]);
+        g_uprobe_unregister_sync();
+        bp_uprobe_handle[i] = NULL;
+    } else {
+        g_uprobe_unregister(bp_uprobe_inode[i], bp_uprobe_offset[i], &bp_uprobe_consumers[i]);
+    }
+    
+    g_iput(bp_uprobe_inode[i]);
+    bp_uprobe_inode[i] = NULL;
+}
+
+// Unregister a breakpoint from its own handler when it can't be re-armed
+static void hw_bp_disarm(int i)
+{
+    if (g_unregister_wide_hw_breakpoint && bp_events[i]) {
+        if (bp_tasks[i] && g_unregister_hw_breakpoint) {
+            g_unregister_hw_breakpoint(bp_events[i]);
+        } else {
+            g_unregister_wide_hw_breakpoint(bp_events[i]);
+        }
+        breakpoints[i].enabled = 0;
+        bp_events[i] = NULL;
+        bp_tasks[i] = NULL;
+    }
+}
+
 // Breakpoint handler callback
 // CRITICAL: This runs in INTERRUPT CONTEXT - must be extremely minimal
 // IMPORTANT: Signature MUST match perf_overflow_handler_t exactly
 //
-// Strategy: Move-to-next-instruction mechanism
+// No logging here: every logical hit becomes one record in the per-cpu
+// event ring (see hw_bp_event.h), read out later with bp_drain.
+//
+// Strategy: single-step re-arm (see hw_bp_step_arm) for user space hits,
+// otherwise the Move-to-next-instruction mechanism
 // - First hit (at original address): Move breakpoint to next instruction
 // - Second hit (at next instruction): Move breakpoint back to original address
 // - This allows the instruction to execute and breakpoint to remain active
@@ -206,10 +644,26 @@ static void hw_bp_handler(struct perf_event *bp,
             
             if (!bp_at_next_instruction[i]) {
                 // FIRST HIT: At original address
-                breakpoints[i].hit_count++;
+                // Conditions only decide whether the hit counts, the re-arm below always runs
+                unsigned long hit_addr = breakpoints[i].addr;
+                if (breakpoints[i].type != HW_BP_TYPE_EXEC) {
+                    hit_addr = hw_bp_fault_addr();
+                }
+                int keep = hw_bp_in_range(i, hit_addr) && hw_bp_cond_pass(i, regs);
+                if (keep) {
+                    kpm_atomic_inc(&breakpoints[i].hit_count);
+                    if (breakpoints[i].stack_depth && user_mode(regs)) {
+                        hw_bp_stack_record(i, regs, breakpoints[i].stack_depth);
+                    }
+                } else {
+                    kpm_atomic_inc(&breakpoints[i].filtered_count);
+                }
                 
-                pr_info("HW_BP[%d]: Hit at 0x%lx (original), count:%d\n",
-                        i, breakpoints[i].addr, breakpoints[i].hit_count);
+                // Step over the instruction without touching perf when possible
+                if (bp_rearm_mode == HW_BP_REARM_STEP && hw_bp_step_arm(i, regs) == 0) {
+                    if (keep) hw_bp_event_record(i, hit_addr, regs, 0);
+                    break;
+                }
                 
                 // Move breakpoint to next instruction
                 // This allows current instruction to execute
@@ -236,40 +690,20 @@ static void hw_bp_handler(struct perf_event *bp,
                     
                     if (result == 0) {
                         bp_at_next_instruction[i] = 1;
-                        pr_info("HW_BP[%d]: Moved to next instruction 0x%lx\n", i, bp_next_addr[i]);
+                        if (keep) hw_bp_event_record(i, hit_addr, regs, 0);
                     } else {
-                        pr_err("HW_BP[%d]: Failed to move to next instruction: %d\n", i, result);
                         // Fallback: disable breakpoint
-                        if (g_unregister_wide_hw_breakpoint) {
-                            if (bp_tasks[i] && g_unregister_hw_breakpoint) {
-                                g_unregister_hw_breakpoint(bp_events[i]);
-                            } else {
-                                g_unregister_wide_hw_breakpoint(bp_events[i]);
-                            }
-                            breakpoints[i].enabled = 0;
-                            bp_events[i] = NULL;
-                            bp_tasks[i] = NULL;
-                        }
+                        hw_bp_event_record(i, hit_addr, regs, HW_BP_EVENT_F_DISARMED);
+                        hw_bp_disarm(i);
                     }
                 } else {
                     // modify_user_hw_breakpoint not available, use one-shot mode
-                    pr_warn("HW_BP[%d]: modify_user_hw_breakpoint not available, disabling\n", i);
-                    if (g_unregister_wide_hw_breakpoint && bp_events[i]) {
-                        if (bp_tasks[i] && g_unregister_hw_breakpoint) {
-                            g_unregister_hw_breakpoint(bp_events[i]);
-                        } else {
-                            g_unregister_wide_hw_breakpoint(bp_events[i]);
-                        }
-                        breakpoints[i].enabled = 0;
-                        bp_events[i] = NULL;
-                        bp_tasks[i] = NULL;
-                    }
+                    hw_bp_event_record(i, hit_addr, regs, HW_BP_EVENT_F_DISARMED);
+                    hw_bp_disarm(i);
                 }
                 
             } else {
                 // SECOND HIT: At next instruction
-                pr_info("HW_BP[%d]: Hit at 0x%lx (next instruction)\n", i, regs->pc);
-                
                 // Move breakpoint back to original address
                 if (g_modify_user_hw_breakpoint && bp_events[i]) {
                     // Prepare original attributes
@@ -291,9 +725,6 @@ static void hw_bp_handler(struct perf_event *bp,
                     
                     if (result == 0) {
                         bp_at_next_instruction[i] = 0;
-                        pr_info("HW_BP[%d]: Moved back to original 0x%lx\n", i, bp_original_addr[i]);
-                    } else {
-                        pr_err("HW_BP[%d]: Failed to move back to original: %d\n", i, result);
                     }
                 }
             }
@@ -317,10 +748,15 @@ int hw_breakpoint_init(void)
         breakpoints[i].description[0] = '\0';
         bp_events[i] = NULL;
         bp_tasks[i] = NULL;
-        bp_hw_slot[i] = -1;
         bp_at_next_instruction[i] = 0;
         bp_original_addr[i] = 0;
         bp_next_addr[i] = 0;
+        breakpoints[i].filtered_count = 0;
+        breakpoints[i].has_cond = 0;
+        breakpoints[i].stack_depth = 0;
+        breakpoints[i].backend = HW_BP_BACKEND_PERF;
+        bp_uprobe_inode[i] = NULL;
+        bp_uprobe_handle[i] = NULL;
     }
     
     // Resolve hardware breakpoint API functions
@@ -346,7 +782,7 @@ int hw_breakpoint_init(void)
         return -1;
     }
     
-    pr_info("Hardware breakpoint subsystem initialized (%d slots)\n", MAX_HW_BREAKPOINTS);
+    pr_info("Hardware breakpoint subsystem initialized (%d logical breakpoints)\n", MAX_HW_BREAKPOINTS);
     pr_info("  register_wide_hw_breakpoint: %p\n", g_register_wide_hw_breakpoint);
     pr_info("  register_user_hw_breakpoint: %p\n", g_register_user_hw_breakpoint);
     pr_info("  unregister_wide_hw_breakpoint: %p\n", g_unregister_wide_hw_breakpoint);
@@ -359,7 +795,51 @@ int hw_breakpoint_init(void)
         pr_warn("PID lookup functions not available, per-process breakpoints disabled\n");
     }
     
-    if (!g_modify_user_hw_breakpoint) {
+    // Range watchpoints patch DBGWCR.MASK after perf installs the slot
+    g_arch_install_hw_breakpoint = (void *)kallsyms_lookup_name("arch_install_hw_breakpoint");
+    for (i = 0; i < MAX_HW_BREAKPOINTS; i++) {
+        bp_range_mask[i] = 0;
+        breakpoints[i].range_len = 0;
+    }
+    
+    // Uprobe fallback for exec breakpoints that don't get a slot
+    g_uprobe_register = (void *)kallsyms_lookup_name("uprobe_register");
+    g_uprobe_unregister_nosync = (uprobe_unregister_nosync_t)kallsyms_lookup_name("uprobe_unregister_nosync");
+    g_uprobe_unregister_sync = (uprobe_unregister_sync_t)kallsyms_lookup_name("uprobe_unregister_sync");
+    if (!g_uprobe_unregister_nosync || !g_uprobe_unregister_sync) {
+        g_uprobe_unregister_nosync = NULL;
+        g_uprobe_unregister = (uprobe_unregister_t)kallsyms_lookup_name("uprobe_unregister");
+    }
+    g_iput = (iput_t)kallsyms_lookup_name("iput");
+    pr_info("  uprobe_register: %p\n", g_uprobe_register);
+    
+    // Single-step re-arm needs a step hook and the user single-step helpers
+    g_register_step_hook = (step_hook_reg_t)kallsyms_lookup_name("register_user_step_hook");
+    g_unregister_step_hook = (step_hook_reg_t)kallsyms_lookup_name("unregister_user_step_hook");
+    if (!g_register_step_hook || !g_unregister_step_hook) {
+        // Before 5.3 there was a single hook list
+        g_register_step_hook = (step_hook_reg_t)kallsyms_lookup_name("register_step_hook");
+        g_unregister_step_hook = (step_hook_reg_t)kallsyms_lookup_name("unregister_step_hook");
+    }
+    g_user_enable_single_step = (single_step_t)kallsyms_lookup_name("user_enable_single_step");
+    g_user_disable_single_step = (single_step_t)kallsyms_lookup_name("user_disable_single_step");
+    
+    g_bp_copy_from_user = (arch_copy_from_user_t)kallsyms_lookup_name("__arch_copy_from_user");
+    g_do_exit = (void *)kallsyms_lookup_name("do_exit");
+    
+    for (i = 0; i < HW_BP_STEP_PENDING; i++) {
+        bp_step[i].task = 0;
+    }
+    
+    if (g_register_step_hook && g_unregister_step_hook && g_user_enable_single_step && g_user_disable_single_step &&
+        g_do_exit && hook_wrap1(g_do_exit, before_do_exit, NULL, NULL) == HOOK_NO_ERR) {
+        bp_exit_hooked = 1;
+        g_register_step_hook(&hw_bp_step_hook);
+        bp_step_hook_registered = 1;
+        bp_rearm_mode = HW_BP_REARM_STEP;
+        pr_info("Single-step re-arm available (%d breakpoint, %d watchpoint registers)\n",
+                dbg_slot_count(0), dbg_slot_count(1));
+    } else if (!g_modify_user_hw_breakpoint) {
         pr_warn("modify_user_hw_breakpoint not available\n");
         pr_warn("Using one-shot breakpoint mode (breakpoint disables after first hit)\n");
     } else {
@@ -369,17 +849,57 @@ int hw_breakpoint_init(void)
     return 0;
 }
 
+void hw_breakpoint_exit(void)
+{
+    hw_breakpoint_clear_all();
+    
+    if (bp_install_hooked) {
+        unhook(g_arch_install_hw_breakpoint);
+        bp_install_hooked = 0;
+    }
+    
+    if (bp_step_hook_registered) {
+        g_unregister_step_hook(&hw_bp_step_hook);
+        bp_step_hook_registered = 0;
+    }
+    
+    if (bp_exit_hooked) {
+        unhook(g_do_exit);
+        bp_exit_hooked = 0;
+    }
+}
+
+int hw_breakpoint_set_rearm(int mode)
+{
+    if (mode == HW_BP_REARM_STEP && !bp_step_hook_registered) {
+        return -ENOSYS;
+    }
+    if (mode != HW_BP_REARM_STEP && mode != HW_BP_REARM_MOVE) {
+        return -EINVAL;
+    }
+    
+    bp_rearm_mode = mode;
+    pr_info("Hardware breakpoint re-arm mode: %s\n", mode == HW_BP_REARM_STEP ? "single-step" : "move-to-next");
+    return 0;
+}
+
+int hw_breakpoint_get_rearm(void)
+{
+    return bp_rearm_mode;
+}
+
 int hw_breakpoint_set(unsigned long addr, int type, int size, const char *desc)
 {
     return hw_breakpoint_set_for_pid(addr, type, size, 0, desc);
 }
 
-int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, const char *desc)
+// mask: DBGWCR.MASK for range watchpoints, 0 for plain ones
+static int __hw_breakpoint_set(unsigned long addr, int type, int size, int pid, const char *desc, int mask)
 {
     struct perf_event_attr_minimal attr;
     struct perf_event *bp;
     struct task_struct *target_task = NULL;
-    int i;
+    int i, backend = HW_BP_BACKEND_PERF;
     unsigned int bp_type, bp_len;
     
     if (!g_register_wide_hw_breakpoint && !g_register_user_hw_breakpoint) {
@@ -439,10 +959,17 @@ int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, c
     }
     
     if (i >= MAX_HW_BREAKPOINTS) {
-        pr_err("No free hardware breakpoint slots\n");
+        pr_err("No free breakpoint entries (%d in use)\n", MAX_HW_BREAKPOINTS);
         return -ENOMEM;
     }
     
+    // Publish the mask before registering, perf may install the slot right away
+    bp_range_base[i] = addr;
+    bp_range_mask[i] = mask;
+    breakpoints[i].range_start = addr;
+    breakpoints[i].range_len = 0;
+    smp_mb();
+    
     // Convert type
     switch (type) {
         case HW_BP_TYPE_EXEC:
@@ -531,8 +1058,17 @@ int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, c
     // Check for errors (IS_ERR macro equivalent)
     if ((unsigned long)bp >= (unsigned long)-4095) {
         long err = (long)bp;
-        pr_err("Failed to register hardware breakpoint: %ld\n", err);
-        return (int)err;
+        
+        // No physical slot left for this thread, an exec breakpoint can still be a uprobe
+        if (err == -ENOSPC && target_task && type == HW_BP_TYPE_EXEC && hw_bp_uprobe_set(i, target_task, addr) == 0) {
+            bp = NULL;
+            backend = HW_BP_BACKEND_UPROBE;
+            pr_info("No free hardware slot, breakpoint[%d] falls back to a uprobe\n", i);
+        } else {
+            pr_err("Failed to register hardware breakpoint: %ld\n", err);
+            bp_range_mask[i] = 0;
+            return (int)err;
+        }
     }
     
     // Store breakpoint info
@@ -546,9 +1082,10 @@ int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, c
     bp_at_next_instruction[i] = 0;
     bp_original_addr[i] = addr;  // Save original address for move-to-next mechanism
     bp_next_addr[i] = 0;
-    
-    // Try to extract hardware slot from perf_event
-    bp_hw_slot[i] = i;  // Assume slot matches our index
+    breakpoints[i].filtered_count = 0;
+    breakpoints[i].has_cond = 0;
+    breakpoints[i].stack_depth = 0;
+    breakpoints[i].backend = backend;
     
     if (desc) {
         strncpy(breakpoints[i].description, desc, sizeof(breakpoints[i].description) - 1);
@@ -567,7 +1104,9 @@ int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, c
                 i, addr, type, size);
     }
     
-    if (g_modify_user_hw_breakpoint) {
+    if (bp_rearm_mode == HW_BP_REARM_STEP) {
+        pr_info("Hardware breakpoint[%d]: Using single-step re-arm\n", i);
+    } else if (g_modify_user_hw_breakpoint) {
         pr_info("Hardware breakpoint[%d]: Using move-to-next-instruction mechanism\n", i);
     } else {
         pr_info("Hardware breakpoint[%d]: Using one-shot mode (will disable after first hit)\n", i);
@@ -576,6 +1115,55 @@ int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, c
     return i;
 }
 
+int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, const char *desc)
+{
+    return __hw_breakpoint_set(addr, type, size, pid, desc, 0);
+}
+
+int hw_breakpoint_set_range(unsigned long addr, unsigned long len, int type, int pid, const char *desc)
+{
+    unsigned long base, end = addr + len;
+    int mask, i;
+    hook_err_t err;
+    
+    if (type == HW_BP_TYPE_EXEC || len == 0 || end < addr) {
+        return -EINVAL;
+    }
+    
+    // Smallest aligned power-of-two block covering the range, MASK 3 (8 bytes) to 31 (2 GB)
+    for (mask = 3; mask <= 31; mask++) {
+        base = addr & ~((1UL << mask) - 1);
+        if (end - base <= (1UL << mask)) break;
+    }
+    if (mask > 31) {
+        pr_err("Range 0x%lx+0x%lx can't be covered by one watchpoint\n", addr, len);
+        return -EINVAL;
+    }
+    
+    // perf only programs up to 8 bytes, the mask is added each time it installs the slot
+    if (!g_arch_install_hw_breakpoint) {
+        return -ENOSYS;
+    }
+    if (!bp_install_hooked) {
+        err = hook_wrap1(g_arch_install_hw_breakpoint, NULL, after_arch_install_hw_breakpoint, NULL);
+        if (err) {
+            pr_err("arch_install_hw_breakpoint hook failed: %d\n", err);
+            return -ENOSYS;
+        }
+        bp_install_hooked = 1;
+    }
+    
+    i = __hw_breakpoint_set(base, type, HW_BP_SIZE_8, pid, desc, mask == 3 ? 0 : mask);
+    if (i < 0) {
+        return i;
+    }
+    
+    breakpoints[i].range_start = addr;
+    breakpoints[i].range_len = len;
+    pr_info("Hardware breakpoint[%d] watches 0x%lx+0x%lx via 0x%lx mask %d\n", i, addr, len, base, mask);
+    return i;
+}
+
 int hw_breakpoint_clear(int index)
 {
     if (index < 0 || index >= MAX_HW_BREAKPOINTS) {
@@ -599,6 +1187,14 @@ int hw_breakpoint_clear(int index)
         bp_tasks[index] = NULL;
     }
     
+    bp_range_mask[index] = 0;
+    breakpoints[index].range_len = 0;
+    
+    if (breakpoints[index].backend == HW_BP_BACKEND_UPROBE) {
+        hw_bp_uprobe_clear(index);
+        breakpoints[index].backend = HW_BP_BACKEND_PERF;
+    }
+    
     pr_info("Hardware breakpoint[%d] cleared (was at 0x%lx, hit %d times)\n",
             index, breakpoints[index].addr, breakpoints[index].hit_count);
     
@@ -606,7 +1202,75 @@ int hw_breakpoint_clear(int index)
     breakpoints[index].enabled = 0;
     breakpoints[index].addr = 0;
     breakpoints[index].hit_count = 0;
+    breakpoints[index].filtered_count = 0;
+    breakpoints[index].has_cond = 0;
+    breakpoints[index].stack_depth = 0;
+    
+    return 0;
+}
+
+int hw_breakpoint_set_cond(int index, const struct hw_bp_cond *cond)
+{
+    unsigned long freq;
+    int j;
+    
+    if (index < 0 || index >= MAX_HW_BREAKPOINTS) {
+        return -EINVAL;
+    }
+    
+    if (!breakpoints[index].enabled) {
+        return -ENOENT;
+    }
+    
+    // Turn the old conditions off before the handler can see a half written set
+    breakpoints[index].has_cond = 0;
+    smp_mb();
+    
+    if (!cond) {
+        pr_info("Hardware breakpoint[%d] conditions cleared\n", index);
+        return 0;
+    }
+    
+    for (j = 0; j < HW_BP_MAX_REG_CONDS; j++) {
+        if (cond->regs[j].op < HW_BP_COND_NONE || cond->regs[j].op > HW_BP_COND_AND) {
+            return -EINVAL;
+        }
+        if (cond->regs[j].op != HW_BP_COND_NONE && (cond->regs[j].reg < 0 || cond->regs[j].reg > 30)) {
+            return -EINVAL;
+        }
+    }
+    
+    bp_cond[index] = *cond;
+    bp_cond_seen[index] = 0;
+    bp_cond_tat[index] = 0;
+    if (cond->rate) {
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+        bp_cond_interval[index] = freq / cond->rate;
+        bp_cond_tolerance[index] = bp_cond_interval[index] * (cond->burst > 1 ? cond->burst - 1 : 0);
+    }
+    breakpoints[index].filtered_count = 0;
+    smp_mb();
+    breakpoints[index].has_cond = 1;
+    
+    pr_info("Hardware breakpoint[%d] conditions set (tid=%d, skip=%lu, sample=%u, rate=%u/s, burst=%u)\n",
+            index, cond->tid, cond->skip, cond->sample, cond->rate, cond->burst);
+    return 0;
+}
+
+int hw_breakpoint_set_stack(int index, int depth)
+{
+    if (index < 0 || index >= MAX_HW_BREAKPOINTS || depth < 0) {
+        return -EINVAL;
+    }
+    
+    if (!breakpoints[index].enabled) {
+        return -ENOENT;
+    }
+    
+    if (depth > HW_BP_STACK_DEPTH) depth = HW_BP_STACK_DEPTH;
+    WRITE_ONCE(breakpoints[index].stack_depth, depth);
     
+    pr_info("Hardware breakpoint[%d] stack capture: %d frames\n", index, depth);
     return 0;
 }
 
@@ -8,9 +8,14 @@
 
 #include "common.h"
 
-// ARM64 supports up to 16 hardware breakpoints (implementation defined)
-// Most devices have 4-6 breakpoints
-#define MAX_HW_BREAKPOINTS 4
+// Logical breakpoints. ARM64 has 2-16 physical breakpoint and watchpoint
+// slots (most devices 4-6). Per-process breakpoints only take a slot while
+// their thread runs, system-wide ones hold a slot on every cpu.
+#define MAX_HW_BREAKPOINTS 32
+
+// Breakpoint backends
+#define HW_BP_BACKEND_PERF    0  // Hardware breakpoint through perf
+#define HW_BP_BACKEND_UPROBE  1  // Exec breakpoint that got no slot, uprobe on the file
 
 // Breakpoint types
 #define HW_BP_TYPE_EXEC   0  // Execution breakpoint
@@ -24,32 +29,87 @@
 #define HW_BP_SIZE_4      2  // 4 bytes
 #define HW_BP_SIZE_8      3  // 8 bytes
 
+// Re-arm engines, how a breakpoint gets past the trapping instruction
+#define HW_BP_REARM_MOVE  0  // Move to pc+4 and back via modify_user_hw_breakpoint
+#define HW_BP_REARM_STEP  1  // Disable the slot and single-step, user space hits only
+
+// Register compare operators for hit conditions
+#define HW_BP_COND_NONE   0
+#define HW_BP_COND_EQ     1  // reg == val
+#define HW_BP_COND_NE     2  // reg != val
+#define HW_BP_COND_LT     3  // reg < val, unsigned
+#define HW_BP_COND_GT     4  // reg > val, unsigned
+#define HW_BP_COND_AND    5  // (reg & val) != 0
+
+#define HW_BP_MAX_REG_CONDS 2
+
+// Hit conditions, checked in the handler before a hit is counted or recorded
+// Checks run cheapest first: tid, registers, skip, 1-in-N sampling, rate limit
+struct hw_bp_cond {
+    struct {
+        int reg;                 // x0-x30
+        int op;                  // HW_BP_COND_*
+        unsigned long val;
+    } regs[HW_BP_MAX_REG_CONDS];
+    int tid;                     // Only this thread, 0 = any
+    unsigned long skip;          // Ignore the first N matching hits
+    unsigned int sample;         // Keep 1 in N matching hits, 0 or 1 = all
+    unsigned int rate;           // Max kept hits per second, 0 = unlimited
+    unsigned int burst;          // Hits allowed back to back under rate
+};
+
 struct hw_breakpoint {
     unsigned long addr;      // Breakpoint address
     int type;                // Breakpoint type
     int size;                // Breakpoint size
     int enabled;             // Is this breakpoint active?
     int hit_count;           // Number of times hit
+    int filtered_count;      // Hits rejected by the conditions
+    int has_cond;            // Conditions are set
+    int backend;             // HW_BP_BACKEND_*
+    unsigned long range_start;  // Requested range of a range watchpoint
+    unsigned long range_len;    // 0 = plain breakpoint
+    int stack_depth;         // User frames captured per hit, 0 = off
     char description[128];   // Description
 };
 
 // Initialize hardware breakpoint subsystem
 int hw_breakpoint_init(void);
 
+// Clear all breakpoints and release the step hook
+void hw_breakpoint_exit(void);
+
+// Select the re-arm engine (HW_BP_REARM_*), STEP needs the kernel step hooks
+int hw_breakpoint_set_rearm(int mode);
+
+// Get the re-arm engine
+int hw_breakpoint_get_rearm(void);
+
 // Set a hardware breakpoint
-// Returns: breakpoint index (0-3) on success, negative on error
+// Returns: breakpoint index on success, negative on error
 int hw_breakpoint_set(unsigned long addr, int type, int size, const char *desc);
 
 // Set a hardware breakpoint for a specific process (by PID)
-// Returns: breakpoint index (0-3) on success, negative on error
+// Returns: breakpoint index on success, negative on error
 int hw_breakpoint_set_for_pid(unsigned long addr, int type, int size, int pid, const char *desc);
 
+// Watch [addr, addr + len) with one masked watchpoint, len up to 2 GB
+// Hits outside the range but inside the covering block are filtered out
+// Returns: breakpoint index on success, negative on error
+int hw_breakpoint_set_range(unsigned long addr, unsigned long len, int type, int pid, const char *desc);
+
 // Clear a hardware breakpoint by index
 int hw_breakpoint_clear(int index);
 
 // Clear all hardware breakpoints
 void hw_breakpoint_clear_all(void);
 
+// Set hit conditions of a breakpoint, NULL clears them
+int hw_breakpoint_set_cond(int index, const struct hw_bp_cond *cond);
+
+// Capture up to depth user frames per kept hit into the call-path profile, 0 stops
+int hw_breakpoint_set_stack(int index, int depth);
+
 // Get breakpoint info
 struct hw_breakpoint *hw_breakpoint_get(int index);
 
@@ -10,6 +10,7 @@
 #include <linux/errno.h>
 #include <linux/mm.h>
 #include "process_memory.h"
+#include "stack_unwind.h"
 
 // Forward declarations
 struct task_struct;
@@ -23,6 +24,10 @@ typedef int (*access_process_vm_t)(struct task_struct *tsk, unsigned long addr,
                                    void *buf, int len, unsigned int gup_flags);
 typedef struct mm_struct *(*get_task_mm_t)(struct task_struct *task);
 typedef void (*mmput_t)(struct mm_struct *mm);
+typedef int (*access_remote_vm_t)(struct mm_struct *mm, unsigned long addr,
+                                  void *buf, int len, unsigned int gup_flags);
+typedef void *(*vmalloc_t)(unsigned long size);
+typedef void (*vfree_t)(const void *addr);
 
 // Global function pointers
 static find_vpid_t g_find_vpid = NULL;
@@ -30,11 +35,21 @@ static pid_task_t g_pid_task = NULL;
 static access_process_vm_t g_access_process_vm = NULL;
 static get_task_mm_t g_get_task_mm = NULL;
 static mmput_t g_mmput = NULL;
+static access_remote_vm_t g_access_remote_vm = NULL;
+static vmalloc_t g_vmalloc = NULL;
+static vfree_t g_vfree = NULL;
+static arch_copy_to_user_t g_arch_copy_to_user = NULL;
+static arch_copy_from_user_t g_arch_copy_from_user = NULL;
 
 // Constants
 #define PIDTYPE_PID 0
+#define FOLL_WRITE 0x01  // Write access
+#define FOLL_DUMP  0x08  // Fail on holes instead of faulting in zero pages
 #define FOLL_FORCE 0x10  // Force access even if page is not writable
 
+// Bounce buffer between access_process_vm and the user buffer
+#define MEM_DUMP_CHUNK (64 * 1024)
+
 int process_memory_init(void)
 {
     // Resolve required functions
@@ -43,6 +58,11 @@ int process_memory_init(void)
     g_access_process_vm = (access_process_vm_t)kallsyms_lookup_name("access_process_vm");
     g_get_task_mm = (get_task_mm_t)kallsyms_lookup_name("get_task_mm");
     g_mmput = (mmput_t)kallsyms_lookup_name("mmput");
+    g_access_remote_vm = (access_remote_vm_t)kallsyms_lookup_name("access_remote_vm");
+    g_vmalloc = (vmalloc_t)kallsyms_lookup_name("vmalloc");
+    g_vfree = (vfree_t)kallsyms_lookup_name("vfree");
+    g_arch_copy_to_user = (arch_copy_to_user_t)kallsyms_lookup_name("__arch_copy_to_user");
+    g_arch_copy_from_user = (arch_copy_from_user_t)kallsyms_lookup_name("__arch_copy_from_user");
     
     if (!g_find_vpid || !g_pid_task) {
         pr_err("Failed to resolve PID lookup functions\n");
@@ -165,3 +185,490 @@ int process_memory_read_hex(int pid, unsigned long addr, char *out, size_t out_s
     
     return ret;
 }
+
+static struct task_struct *find_task(int pid)
+{
+    struct pid *pid_struct;
+    
+    if (!g_find_vpid || !g_pid_task) {
+        return NULL;
+    }
+    
+    pid_struct = g_find_vpid(pid);
+    if (!pid_struct) {
+        return NULL;
+    }
+    return g_pid_task(pid_struct, PIDTYPE_PID);
+}
+
+// Write the header of the extent being built, if any
+static int dump_close_range(char __user *out, long hdr_pos, struct mem_dump_range *range)
+{
+    if (hdr_pos < 0) return 0;
+    if (g_arch_copy_to_user(out + hdr_pos, range, sizeof(*range))) return -EFAULT;
+    return 0;
+}
+
+long process_memory_dump_user(int pid, unsigned long start, unsigned long end, void __user *out, long outlen)
+{
+    struct task_struct *task;
+    struct mm_struct *mm = NULL;
+    struct mem_dump_batch batch;
+    struct mem_dump_range range;
+    struct vma_span vs;
+    char __user *dst = (char __user *)out;
+    char *bounce;
+    unsigned long addr, limit, page = 1UL << user_page_shift();
+    long pos = sizeof(batch), hdr_pos = -1;
+    int ret = 0;
+    
+    if (!g_access_process_vm || !g_vmalloc || !g_vfree || !g_arch_copy_to_user) {
+        return -ENOSYS;
+    }
+    if (!out || outlen < (long)(sizeof(batch) + sizeof(range) + page) || start >= end) {
+        return -EINVAL;
+    }
+    
+    task = find_task(pid);
+    if (!task) {
+        return -ESRCH;
+    }
+    
+    // Hold the mm for the whole walk so the address space can't go away under us
+    if (g_get_task_mm && g_mmput) {
+        mm = g_get_task_mm(task);
+        if (!mm) {
+            return -EINVAL;
+        }
+    }
+    
+    bounce = (char *)g_vmalloc(MEM_DUMP_CHUNK);
+    if (!bounce) {
+        if (mm) g_mmput(mm);
+        return -ENOMEM;
+    }
+    
+    memset(&batch, 0, sizeof(batch));
+    addr = start & ~(page - 1);
+    end = (end + page - 1) & ~(page - 1);
+    
+    while (addr < end) {
+        if (get_next_vma(task, addr, &vs, 0) != 0 || vs.start >= end) {
+            addr = end;
+            break;
+        }
+        if (addr < vs.start) addr = vs.start;
+        
+        // Device and unreadable mappings are never copied
+        if (!(vs.flags & VM_READ) || (vs.flags & (VM_IO | VM_PFNMAP))) {
+            addr = vs.end;
+            continue;
+        }
+        
+        limit = vs.end < end ? vs.end : end;
+        while (addr < limit) {
+            long room = outlen - pos - (hdr_pos < 0 ? sizeof(range) : 0);
+            long chunk = limit - addr;
+            int n;
+            
+            if (chunk > MEM_DUMP_CHUNK) chunk = MEM_DUMP_CHUNK;
+            if (chunk > (room & ~(page - 1))) chunk = room & ~(page - 1);
+            if (chunk <= 0) goto out_full;
+            
+            n = g_access_process_vm(task, addr, bounce, chunk, FOLL_DUMP);
+            if (n > 0) {
+                if (hdr_pos < 0) {
+                    hdr_pos = pos;
+                    pos += sizeof(range);
+                    range.addr = addr;
+                    range.len = 0;
+                    range.flags = vs.flags & (VM_READ | VM_WRITE | VM_EXEC | VM_SHARED);
+                    range.reserved = 0;
+                    batch.count++;
+                }
+                if (g_arch_copy_to_user(dst + pos, bounce, n)) {
+                    ret = -EFAULT;
+                    goto out;
+                }
+                pos += n;
+                range.len += n;
+                batch.bytes += n;
+                addr += n;
+            }
+            
+            // Hole or unreadable page, end the extent and step over one page
+            if (n < chunk) {
+                if (dump_close_range(dst, hdr_pos, &range)) {
+                    ret = -EFAULT;
+                    goto out;
+                }
+                hdr_pos = -1;
+                addr = (addr & ~(page - 1)) + page;
+            }
+        }
+        
+        // Extents never span VMAs, their flags may differ
+        if (dump_close_range(dst, hdr_pos, &range)) {
+            ret = -EFAULT;
+            goto out;
+        }
+        hdr_pos = -1;
+    }
+    
+out_full:
+    if (dump_close_range(dst, hdr_pos, &range)) {
+        ret = -EFAULT;
+        goto out;
+    }
+    batch.next = addr < end ? addr : 0;
+    if (g_arch_copy_to_user(dst, &batch, sizeof(batch))) {
+        ret = -EFAULT;
+    }
+    
+out:
+    g_vfree(bounce);
+    if (mm) g_mmput(mm);
+    return ret ? ret : batch.count;
+}
+
+// Write len bytes at addr through the held mm, pattern repeated when it is shorter
+// Returns: bytes written, or negative error code if nothing was written
+static long write_patch(struct task_struct *task, struct mm_struct *mm, unsigned long addr, unsigned long len,
+                        const char *pattern, unsigned long plen, char *bounce)
+{
+    unsigned long done = 0, i;
+    
+    while (done < len) {
+        int chunk = len - done > MEM_DUMP_CHUNK ? MEM_DUMP_CHUNK : len - done;
+        int n;
+        
+        if (pattern) {
+            for (i = 0; i < chunk; i++) bounce[i] = pattern[(done + i) % plen];
+        }
+        
+        if (g_access_remote_vm && mm) {
+            n = g_access_remote_vm(mm, addr + done, bounce, chunk, FOLL_FORCE | FOLL_WRITE);
+        } else {
+            n = g_access_process_vm(task, addr + done, bounce, chunk, FOLL_FORCE | FOLL_WRITE);
+        }
+        if (n > 0) done += n;
+        if (n < chunk) break;
+    }
+    
+    return done ? done : -EFAULT;
+}
+
+long process_memory_write_user(int pid, void __user *buf, long buflen)
+{
+    struct task_struct *task;
+    struct mm_struct *mm = NULL;
+    struct mem_patch_batch batch;
+    struct mem_patch patch;
+    char __user *src = (char __user *)buf;
+    char *bounce, *pattern = NULL;
+    long pos = sizeof(batch), result;
+    u32 i;
+    int ret = 0;
+    
+    if (!g_access_process_vm || !g_vmalloc || !g_vfree || !g_arch_copy_to_user || !g_arch_copy_from_user) {
+        return -ENOSYS;
+    }
+    if (!buf || buflen < (long)sizeof(batch)) {
+        return -EINVAL;
+    }
+    if (g_arch_copy_from_user(&batch, src, sizeof(batch))) {
+        return -EFAULT;
+    }
+    if (batch.count > MAX_MEM_PATCHES) {
+        return -E2BIG;
+    }
+    
+    task = find_task(pid);
+    if (!task) {
+        return -ESRCH;
+    }
+    
+    // One mm reference for the whole batch
+    if (g_get_task_mm && g_mmput) {
+        mm = g_get_task_mm(task);
+        if (!mm) {
+            return -EINVAL;
+        }
+    }
+    
+    // Data and pattern halves
+    bounce = (char *)g_vmalloc(MEM_DUMP_CHUNK * 2);
+    if (!bounce) {
+        if (mm) g_mmput(mm);
+        return -ENOMEM;
+    }
+    
+    for (i = 0; i < batch.count; i++) {
+        long data_pos = pos + sizeof(patch);
+        
+        if (data_pos > buflen || g_arch_copy_from_user(&patch, src + pos, sizeof(patch))) {
+            ret = -EINVAL;
+            break;
+        }
+        pos = data_pos + ((patch.data_len + 7) & ~7UL);
+        if (pos > buflen) {
+            ret = -EINVAL;
+            break;
+        }
+        
+        if (patch.flags & MEM_PATCH_F_FILL) {
+            // Pattern up to one chunk, expanded per chunk in write_patch()
+            pattern = bounce + MEM_DUMP_CHUNK;
+            if (patch.data_len == 0 || patch.data_len > MEM_DUMP_CHUNK) {
+                result = -EINVAL;
+            } else if (g_arch_copy_from_user(pattern, src + data_pos, patch.data_len)) {
+                result = -EFAULT;
+            } else {
+                unsigned long len = patch.len > MEM_PATCH_MAX_FILL ? MEM_PATCH_MAX_FILL : patch.len;
+                result = write_patch(task, mm, patch.addr, len, pattern, patch.data_len, bounce);
+            }
+        } else if (patch.data_len != patch.len || patch.len == 0 || patch.len > MEM_DUMP_CHUNK) {
+            result = -EINVAL;
+        } else if (g_arch_copy_from_user(bounce, src + data_pos, patch.len)) {
+            result = -EFAULT;
+        } else {
+            result = write_patch(task, mm, patch.addr, patch.len, NULL, 0, bounce);
+        }
+        
+        // Report back in place
+        patch.result = (s32)result;
+        if (g_arch_copy_to_user(src + data_pos - sizeof(patch), &patch, sizeof(patch))) {
+            ret = -EFAULT;
+            break;
+        }
+    }
+    
+    g_vfree(bounce);
+    if (mm) g_mmput(mm);
+    return ret ? ret : i;
+}
+
+// Substring test without strstr, name is short
+static int name_contains(const char *name, const char *sub)
+{
+    const char *n, *s;
+    
+    for (; *name; name++) {
+        for (n = name, s = sub; *s && *n == *s; n++, s++)
+            ;
+        if (!*s) return 1;
+    }
+    return 0;
+}
+
+static int search_vma_match(const struct vma_span *vs, const struct mem_search_req *req)
+{
+    if (!(vs->flags & VM_READ) || (vs->flags & (VM_IO | VM_PFNMAP))) return 0;
+    if ((req->vma_flags & MEM_SEARCH_WRITABLE) && !(vs->flags & VM_WRITE)) return 0;
+    if ((req->vma_flags & MEM_SEARCH_EXEC) && !(vs->flags & VM_EXEC)) return 0;
+    if ((req->vma_flags & MEM_SEARCH_FILE) && !vs->is_file) return 0;
+    if ((req->vma_flags & MEM_SEARCH_ANON) && vs->is_file) return 0;
+    if (req->name[0] && !name_contains(vs->name, req->name)) return 0;
+    return 1;
+}
+
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
+// Find pattern candidates 8 bytes at a time on the anchor byte, then check the mask
+// Calls back with the offset of every match in data[0, n), stops when it returns nonzero
+static int scan_chunk(const unsigned char *data, long n, const struct mem_search_req *req, int anchor,
+                      int (*found)(long off, void *ctx), void *ctx)
+{
+    const unsigned char *pat = req->pattern, *mask = req->mask;
+    long last = n - req->len, p = 0;
+    u64 rep = SWAR_ONES * pat[anchor];
+    u32 j;
+    
+    while (p <= last) {
+        // Candidate starts p..p+7 have the anchor byte at p+anchor..p+anchor+7
+        u64 bits = 0;
+        if (p + 8 <= last + 1) {
+            u64 w, x;
+            __builtin_memcpy(&w, data + p + anchor, 8);
+            x = w ^ rep;
+            bits = (x - SWAR_ONES) & ~x & SWAR_HIGHS;
+            if (!bits) {
+                p += 8;
+                continue;
+            }
+        } else {
+            bits = data[p + anchor] == pat[anchor] ? 0x80 : 0;
+            if (!bits) {
+                p++;
+                continue;
+            }
+        }
+        
+        // Borrows can flag false candidates above a real one, the full check sorts them out
+        while (bits) {
+            long q = p + (__builtin_ctzll(bits) >> 3);
+            bits &= bits - 1;
+            for (j = 0; j < req->len; j++) {
+                if ((data[q + j] ^ pat[j]) & mask[j]) break;
+            }
+            if (j == req->len && found(q, ctx)) return 1;
+        }
+        p += (p + 8 <= last + 1) ? 8 : 1;
+    }
+    return 0;
+}
+
+struct search_ctx {
+    u64 __user *out;
+    unsigned long base;
+    unsigned long last;      // Address of the latest match
+    u32 count;
+    u32 max;
+    int fault;
+};
+
+static int search_found(long off, void *data)
+{
+    struct search_ctx *ctx = (struct search_ctx *)data;
+    u64 addr = ctx->base + off;
+    
+    if (g_arch_copy_to_user(ctx->out + ctx->count, &addr, sizeof(addr))) {
+        ctx->fault = 1;
+        return 1;
+    }
+    ctx->last = addr;
+    return ++ctx->count >= ctx->max;
+}
+
+long process_memory_search_user(int pid, unsigned long start, unsigned long end, void __user *buf, long buflen)
+{
+    struct task_struct *task;
+    struct mm_struct *mm = NULL;
+    struct mem_search_req *req;
+    struct mem_search_result res;
+    struct search_ctx ctx;
+    struct vma_span vs;
+    unsigned long addr, limit, page = 1UL << user_page_shift();
+    unsigned char *bounce;
+    int anchor, ret = 0;
+    u32 j;
+    
+    if (!g_access_process_vm || !g_vmalloc || !g_vfree || !g_arch_copy_to_user || !g_arch_copy_from_user) {
+        return -ENOSYS;
+    }
+    if (!buf || buflen < (long)sizeof(*req) || start >= end) {
+        return -EINVAL;
+    }
+    
+    // Request and bounce buffer share one allocation
+    req = (struct mem_search_req *)g_vmalloc(sizeof(*req) + MEM_DUMP_CHUNK);
+    if (!req) {
+        return -ENOMEM;
+    }
+    bounce = (unsigned char *)(req + 1);
+    
+    if (g_arch_copy_from_user(req, buf, sizeof(*req))) {
+        ret = -EFAULT;
+        goto out_free;
+    }
+    req->name[sizeof(req->name) - 1] = '\0';
+    
+    // Anchor on the first byte that must match exactly
+    anchor = -1;
+    for (j = 0; j < req->len && j < MEM_SEARCH_MAX_PATTERN; j++) {
+        if (req->mask[j] == 0xff) {
+            anchor = j;
+            break;
+        }
+    }
+    if (req->len == 0 || req->len > MEM_SEARCH_MAX_PATTERN || anchor < 0) {
+        ret = -EINVAL;
+        goto out_free;
+    }
+    for (j = 0; j < req->len; j++) req->pattern[j] &= req->mask[j];
+    
+    task = find_task(pid);
+    if (!task) {
+        ret = -ESRCH;
+        goto out_free;
+    }
+    if (g_get_task_mm && g_mmput) {
+        mm = g_get_task_mm(task);
+        if (!mm) {
+            ret = -EINVAL;
+            goto out_free;
+        }
+    }
+    
+    // Results overwrite the request
+    ctx.out = (u64 __user *)((char __user *)buf + sizeof(res));
+    ctx.max = (buflen - sizeof(res)) / sizeof(u64);
+    if (req->max_results && req->max_results < ctx.max) ctx.max = req->max_results;
+    ctx.count = 0;
+    ctx.fault = 0;
+    
+    addr = start;
+    while (addr < end && ctx.count < ctx.max) {
+        if (get_next_vma(task, addr, &vs, req->name[0] != '\0') != 0 || vs.start >= end) {
+            addr = end;
+            break;
+        }
+        if (addr < vs.start) addr = vs.start;
+        if (!search_vma_match(&vs, req)) {
+            addr = vs.end;
+            continue;
+        }
+        
+        limit = vs.end < end ? vs.end : end;
+        while (addr < limit && ctx.count < ctx.max) {
+            long chunk = limit - addr > MEM_DUMP_CHUNK ? MEM_DUMP_CHUNK : limit - addr;
+            int n;
+            
+            if (chunk < req->len) {
+                addr = limit;
+                break;
+            }
+            
+            if (g_access_remote_vm && mm) {
+                n = g_access_remote_vm(mm, addr, bounce, chunk, FOLL_DUMP);
+            } else {
+                n = g_access_process_vm(task, addr, bounce, chunk, FOLL_DUMP);
+            }
+            
+            if (n >= (int)req->len) {
+                ctx.base = addr;
+                if (scan_chunk(bounce, n, req, anchor, search_found, &ctx)) {
+                    if (ctx.fault) {
+                        ret = -EFAULT;
+                        goto out;
+                    }
+                    // Limit reached, resume after the last match
+                    addr = ctx.last + 1;
+                    break;
+                }
+            }
+            
+            if (n == chunk) {
+                // Next chunk overlaps so matches across the boundary are seen once
+                addr += chunk - req->len + 1;
+            } else {
+                // Hole, nothing to match across it
+                addr = ((addr + (n > 0 ? n : 0)) & ~(page - 1)) + page;
+            }
+        }
+    }
+    
+    res.count = ctx.count;
+    res.reserved = 0;
+    res.next = addr < end ? addr : 0;
+    if (g_arch_copy_to_user(buf, &res, sizeof(res))) {
+        ret = -EFAULT;
+    }
+    
+out:
+    if (mm) g_mmput(mm);
+out_free:
+    g_vfree(req);
+    return ret ? ret : ctx.count;
+}
@@ -22,4 +22,80 @@ int process_memory_read(int pid, unsigned long addr, void *buf, size_t size);
 // Returns: number of bytes read, or negative error code
 int process_memory_read_hex(int pid, unsigned long addr, char *out, size_t out_size, size_t read_size);
 
+// Header of a process_memory_dump_user() reply
+// Followed by count extents, each a struct mem_dump_range and len bytes of data
+struct mem_dump_batch {
+    u32 count;           // Extents in this reply
+    u32 reserved;
+    u64 next;            // Address to resume from, 0 when the range is done
+    u64 bytes;           // Data bytes in this reply
+};
+
+struct mem_dump_range {
+    u64 addr;
+    u32 len;             // Page multiple
+    u32 flags;           // VM_READ | VM_WRITE | VM_EXEC | VM_SHARED of the mapping
+    u64 reserved;
+};
+
+// Copy the present, readable pages of [start, end) of a process into a user buffer
+// Unmapped ranges and pages never touched are skipped, a full buffer ends the reply early
+// Returns: number of extents copied, or negative error code
+long process_memory_dump_user(int pid, unsigned long start, unsigned long end, void __user *out, long outlen);
+
+// Patch batch for process_memory_write_user(), read from and reported back to one buffer
+// Followed by count patches, each a struct mem_patch and data_len bytes padded to 8
+#define MAX_MEM_PATCHES 4096
+
+#define MEM_PATCH_F_FILL 0x1     // Repeat data_len bytes of pattern over len bytes
+#define MEM_PATCH_MAX_FILL 0x7fffffff  // Longer fills stop here so result stays positive
+
+struct mem_patch_batch {
+    u32 count;
+    u32 reserved;
+};
+
+struct mem_patch {
+    u64 addr;
+    u32 len;             // Bytes to write, up to 64 KB without FILL
+    u32 data_len;        // Bytes following, equal to len without FILL
+    u32 flags;           // MEM_PATCH_F_*
+    s32 result;          // Out: bytes written, or negative error code
+};
+
+// Apply a batch of patches to a process under one mm reference, even to read-only mappings
+// Per-patch results are written back into the buffer
+// Returns: number of patches processed, or negative error code for a malformed batch
+long process_memory_write_user(int pid, void __user *buf, long buflen);
+
+// Pattern search request for process_memory_search_user()
+#define MEM_SEARCH_MAX_PATTERN 256
+
+// VMA filters, all set ones must hold
+#define MEM_SEARCH_WRITABLE 0x1
+#define MEM_SEARCH_EXEC     0x2
+#define MEM_SEARCH_FILE     0x4  // File-backed mappings only
+#define MEM_SEARCH_ANON     0x8  // Anonymous mappings only
+
+struct mem_search_req {
+    u32 len;                               // Pattern bytes
+    u32 max_results;                       // 0 = as many as fit
+    u32 vma_flags;                         // MEM_SEARCH_*
+    u32 reserved;
+    char name[64];                         // Mapping name substring, empty = any
+    u8 pattern[MEM_SEARCH_MAX_PATTERN];
+    u8 mask[MEM_SEARCH_MAX_PATTERN];       // 0xff exact, 0x00 wildcard, at least one 0xff
+};
+
+// Written over the request, followed by count match addresses (u64)
+struct mem_search_result {
+    u32 count;
+    u32 reserved;
+    u64 next;                              // Address to resume from, 0 when the range is done
+};
+
+// Search the readable pages of [start, end) of a process for a masked pattern
+// Returns: number of matches, or negative error code
+long process_memory_search_user(int pid, unsigned long start, unsigned long end, void __user *buf, long buflen);
+
 #endif /* _PROCESS_MEMORY_H_ */
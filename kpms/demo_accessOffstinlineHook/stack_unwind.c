@@ -3,7 +3,9 @@
  * Stack unwinding implementation
  */
 
+#include <linux/errno.h>
 #include "stack_unwind.h"
+#include "elf_sym.h"
 
 
 
@@ -13,19 +15,40 @@ static arch_copy_from_user_t g_arch_copy_from_user = NULL;
 static find_vma_t g_find_vma = NULL;
 static file_path_t g_file_path = NULL;
 static down_read_trylock_t g_down_read_trylock = NULL;
+static down_read_t g_down_read = NULL;
 static up_read_t g_up_read = NULL;
 static free_page_t g_free_page = NULL;
 static get_free_page_t g_get_free_page = NULL;
 static snprintf_t g_snprintf = NULL;
 
+typedef struct mm_struct *(*get_task_mm_t)(struct task_struct *task);
+typedef void (*mmput_t)(struct mm_struct *mm);
+typedef struct inode *(*igrab_t)(struct inode *inode);
+
+static get_task_mm_t g_get_task_mm = NULL;
+static mmput_t g_mmput = NULL;
+static igrab_t g_igrab = NULL;
+
 // VMA offset configuration
 static struct vma_offsets_t g_vma_offset = {
     .vm_start = 0x00,
     .vm_end   = 0x08,
     .vm_prev  = 0x18,
+    .vm_flags = 0x50,
+    .vm_pgoff = -1,   // 由 vm_file 推出，见 stack_unwind_init
     .vm_file  = 0xA0
 };
 
+// struct file 中 f_inode 的偏移，6.12 起不在 0x20，初始化时探测，-1 表示未知
+static int g_file_inode_offset = -1;
+
+// 取 file 的 inode，偏移未探测到时返回 NULL
+static struct inode *file_inode_of(struct file *f)
+{
+    if (g_file_inode_offset < 0) return NULL;
+    return *(struct inode **)((char *)f + g_file_inode_offset);
+}
+
 static int g_mmap_lock_offset = 0x68;
 static int g_task_mm_offset = 0x588;
 
@@ -132,9 +155,18 @@ int get_vma_info_str(unsigned long ip, char *buf, size_t len)
                     char *p = g_file_path(f, tmp_buf, 4096);
                     if (!IS_ERR(p)) {
                         const char *name = my_kbasename(p);
+                        char sym[128];
+                        unsigned long pgoff = *(unsigned long *)((char *)vma + g_vma_offset.vm_pgoff);
+                        struct inode *inode = file_inode_of(f);
+                        unsigned long file_off = ip - vm_start + (pgoff << user_page_shift());
                         
-                        // 打印格式：libc.so + 0xOffset
-                        ret_len = g_snprintf(buf, len, " %s + 0x%lx", name, offset);
+                        if (elf_sym_lookup(f, inode, file_off, sym, sizeof(sym)) > 0) {
+                            // 打印格式：libc.so!open+0x14
+                            ret_len = g_snprintf(buf, len, " %s!%s", name, sym);
+                        } else {
+                            // 打印格式：libc.so + 0xOffset
+                            ret_len = g_snprintf(buf, len, " %s + 0x%lx", name, offset);
+                        }
                     } else {
                         // file_path 失败，但我们仍然可以显示偏移
                         ret_len = g_snprintf(buf, len, " <file> + 0x%lx", offset);
@@ -159,6 +191,115 @@ int get_vma_info_str(unsigned long ip, char *buf, size_t len)
     return ret_len;
 }
 
+int vma_inode_supported(void)
+{
+    return g_file_inode_offset >= 0;
+}
+
+// 用户态页大小，取自 TCR_EL1.TG0
+int user_page_shift(void)
+{
+    u64 tcr;
+    asm volatile("mrs %0, tcr_el1" : "=r"(tcr));
+    switch ((tcr >> 14) & 0x3) {
+        case 1: return 16;
+        case 2: return 14;
+    }
+    return 12;
+}
+
+/**
+ * 查找 task 中 addr 所在的文件映射
+ * 返回 igrab 过的 inode（调用者负责 iput），*file_off 为 addr 对应的文件偏移
+ */
+struct inode *get_vma_inode(struct task_struct *task, unsigned long addr, unsigned long *file_off)
+{
+    struct mm_struct *mm;
+    struct vm_area_struct *vma;
+    struct rw_semaphore *mmap_sem;
+    struct inode *inode = NULL;
+
+    if (!g_get_task_mm || !g_mmput || !g_find_vma || !g_down_read || !g_up_read || !g_igrab ||
+        !vma_inode_supported()) {
+        return NULL;
+    }
+
+    mm = g_get_task_mm(task);
+    if (!mm) return NULL;
+
+    mmap_sem = (struct rw_semaphore *)((char *)mm + g_mmap_lock_offset);
+    g_down_read(mmap_sem);
+
+    vma = g_find_vma(mm, addr);
+    if (vma) {
+        unsigned long vm_start = *(unsigned long *)((char *)vma + g_vma_offset.vm_start);
+        unsigned long vm_end = *(unsigned long *)((char *)vma + g_vma_offset.vm_end);
+        struct file *f = *(struct file **)((char *)vma + g_vma_offset.vm_file);
+
+        if (addr >= vm_start && addr < vm_end && f) {
+            unsigned long pgoff = *(unsigned long *)((char *)vma + g_vma_offset.vm_pgoff);
+            // vma 持有 file，锁内 file 和 inode 都有效
+            inode = g_igrab(file_inode_of(f));
+            *file_off = addr - vm_start + (pgoff << user_page_shift());
+        }
+    }
+
+    g_up_read(mmap_sem);
+    g_mmput(mm);
+    return inode;
+}
+
+/**
+ * 取 task 中第一个 vm_end > addr 的 VMA 快照
+ * want_name 时同时取文件名，锁内调用 file_path
+ * 返回 0，或者 addr 之后没有映射时返回 -ENOENT
+ */
+int get_next_vma(struct task_struct *task, unsigned long addr, struct vma_span *out, int want_name)
+{
+    struct mm_struct *mm;
+    struct vm_area_struct *vma;
+    struct rw_semaphore *mmap_sem;
+    int ret = -ENOENT;
+
+    if (!g_get_task_mm || !g_mmput || !g_find_vma || !g_down_read || !g_up_read) {
+        return -ENOSYS;
+    }
+
+    mm = g_get_task_mm(task);
+    if (!mm) return -ESRCH;
+
+    mmap_sem = (struct rw_semaphore *)((char *)mm + g_mmap_lock_offset);
+    g_down_read(mmap_sem);
+
+    vma = g_find_vma(mm, addr);
+    if (vma) {
+        struct file *f = *(struct file **)((char *)vma + g_vma_offset.vm_file);
+
+        out->start = *(unsigned long *)((char *)vma + g_vma_offset.vm_start);
+        out->end = *(unsigned long *)((char *)vma + g_vma_offset.vm_end);
+        out->flags = *(unsigned long *)((char *)vma + g_vma_offset.vm_flags);
+        out->is_file = f != NULL;
+        out->name[0] = '\0';
+
+        if (f && want_name && g_file_path && g_get_free_page && g_free_page) {
+            char *tmp_buf = (char *)g_get_free_page(0x400000, 0);
+            if (tmp_buf) {
+                char *p = g_file_path(f, tmp_buf, 4096);
+                if (!IS_ERR(p)) {
+                    strncpy(out->name, my_kbasename(p), sizeof(out->name) - 1);
+                    out->name[sizeof(out->name) - 1] = '\0';
+                }
+                g_free_page((unsigned long)tmp_buf, 0);
+            }
+        }
+        ret = 0;
+    }
+
+    g_up_read(mmap_sem);
+    g_mmput(mm);
+    return ret;
+}
+
 static void my_unwind_compat(struct task_struct *task, struct stack_trace *trace)
 {
     struct pt_regs *regs = task_pt_regs(task);
@@ -228,6 +369,58 @@ static void my_unwind_compat(struct task_struct *task, struct stack_trace *trace
     }
 }
 
+// Frame pointer walk of the interrupted user context, no logging
+// Called from the breakpoint handler, so a frame that isn't resident just ends the walk
+int unwind_user_frames(struct pt_regs *regs, unsigned long *pcs, int max)
+{
+    unsigned long fp, sp, lr;
+    int n = 0, is_compat;
+
+    if (!g_arch_copy_from_user || max <= 0) return 0;
+
+    is_compat = (regs->pstate & PSR_MODE32_BIT) != 0;
+    pcs[n++] = regs->pc;
+
+    if (is_compat) {
+        sp = (u32)regs->regs[13];
+        lr = (u32)regs->regs[14];
+        fp = (regs->pstate & 0x20) ? (u32)regs->regs[7] : (u32)regs->regs[11];
+    } else {
+        sp = regs->sp;
+        // Drop PAC and tag bits of signed return addresses
+        lr = regs->regs[30] & USER_VA_MASK;
+        fp = regs->regs[29];
+    }
+
+    // LR first, leaf functions haven't pushed a frame yet
+    if (n < max && lr > 0x1000) pcs[n++] = lr;
+
+    while (n < max) {
+        unsigned long next_fp, ret;
+
+        if (fp < 0x1000 || fp < sp || (fp & (is_compat ? 3 : 7))) break;
+
+        if (is_compat) {
+            struct stack_frame_32 frame;
+            if (g_arch_copy_from_user(&frame, (const void __user *)fp, sizeof(frame))) break;
+            next_fp = frame.next_fp;
+            ret = frame.ret_addr;
+        } else {
+            unsigned long frame[2];
+            if (g_arch_copy_from_user(frame, (const void __user *)fp, sizeof(frame))) break;
+            next_fp = frame[0];
+            ret = frame[1] & USER_VA_MASK;
+        }
+
+        if (ret < 0x1000) break;
+        if (ret != pcs[n - 1]) pcs[n++] = ret;
+        if (next_fp <= fp) break;
+        fp = next_fp;
+    }
+
+    return n;
+}
+
 void unwind_user_stack_standard(struct task_struct *task)
 {
     unsigned long stack_entries[MAX_STACK_DEPTH];
@@ -268,6 +461,38 @@ void unwind_user_stack_standard(struct task_struct *task)
     pr_info("------------------------------------------\n");
 }
 
+/**
+ * 探测 struct file 中 f_inode 的偏移
+ * 建一个匿名 inode 文件，其 f_inode 必为内核的 anon_inode_inode，
+ * 在 file 头部找这个指针。f_op/f_mapping/f_path 都不会等于它
+ */
+static int probe_file_inode_offset(void)
+{
+    typedef struct file *(*anon_inode_getfile_t)(const char *name, const void *fops, void *priv, int flags);
+    typedef void (*fput_t)(struct file *file);
+    static u64 probe_fops[64]; // 全零的 file_operations，够覆盖各版本
+    anon_inode_getfile_t getfile = (anon_inode_getfile_t)kallsyms_lookup_name("anon_inode_getfile");
+    fput_t fput = (fput_t)kallsyms_lookup_name("fput");
+    struct inode **anon_inode = (struct inode **)kallsyms_lookup_name("anon_inode_inode");
+    struct file *f;
+    int off = -1;
+    int i;
+
+    if (!getfile || !fput || !anon_inode || !*anon_inode) return -1;
+
+    f = getfile("[kpm_probe]", probe_fops, NULL, 0);
+    if (!f || IS_ERR(f)) return -1;
+
+    for (i = 0; i < 0x100; i += sizeof(void *)) {
+        if (*(struct inode **)((char *)f + i) == *anon_inode) {
+            off = i;
+            break;
+        }
+    }
+    fput(f);
+    return off;
+}
+
 int stack_unwind_init(void)
 {
     g_save_stack_trace_user = (save_stack_trace_user_t)kallsyms_lookup_name("save_stack_trace_user");
@@ -290,14 +515,28 @@ int stack_unwind_init(void)
     }
 
     g_down_read_trylock = (down_read_trylock_t)kallsyms_lookup_name("down_read_trylock");
+    g_down_read = (down_read_t)kallsyms_lookup_name("down_read");
     g_up_read = (up_read_t)kallsyms_lookup_name("up_read");
     g_get_free_page = (get_free_page_t)kallsyms_lookup_name("__get_free_pages");
     g_free_page = (free_page_t)kallsyms_lookup_name("free_pages");
     g_snprintf = (snprintf_t)kallsyms_lookup_name("snprintf");
+    g_get_task_mm = (get_task_mm_t)kallsyms_lookup_name("get_task_mm");
+    g_mmput = (mmput_t)kallsyms_lookup_name("mmput");
+    g_igrab = (igrab_t)kallsyms_lookup_name("igrab");
 
     if (!g_find_vma || !g_file_path || !g_down_read_trylock || !g_snprintf) {
         pr_warn("VMA/snprintf symbols missing, logging functionality restricted.\n");
     }
 
+    // vm_pgoff 在 4.x 到 6.x 都紧挨在 vm_file 之前
+    g_vma_offset.vm_pgoff = g_vma_offset.vm_file - sizeof(unsigned long);
+
+    g_file_inode_offset = probe_file_inode_offset();
+    if (g_file_inode_offset < 0) {
+        pr_warn("f_inode offset unknown, ELF symbols and uprobe fallback disabled\n");
+    } else {
+        pr_info("f_inode offset: 0x%x\n", g_file_inode_offset);
+    }
+
     return 0;
 }
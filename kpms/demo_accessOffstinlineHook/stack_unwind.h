@@ -14,9 +14,28 @@ int stack_unwind_init(void);
 // Perform user-space stack unwinding
 void unwind_user_stack_standard(struct task_struct *task);
 
+// Collect up to max user return addresses of regs into pcs, pc first
+// Safe in breakpoint handler context
+// Returns: number of addresses stored
+int unwind_user_frames(struct pt_regs *regs, unsigned long *pcs, int max);
+
 // Get VMA information string for an address
 int get_vma_info_str(unsigned long ip, char *buf, size_t len);
 
+// Find the file mapping of addr in task
+// Returns: grabbed inode (caller iputs) and the file offset of addr, or NULL
+struct inode *get_vma_inode(struct task_struct *task, unsigned long addr, unsigned long *file_off);
+
+// Whether the struct file inode offset was detected at init
+int vma_inode_supported(void);
+
+// Snapshot the first VMA of task ending above addr, with the file name if want_name
+// Returns: 0, -ENOENT when nothing is mapped above addr, or negative error code
+int get_next_vma(struct task_struct *task, unsigned long addr, struct vma_span *out, int want_name);
+
+// User page size shift, from TCR_EL1.TG0
+int user_page_shift(void);
+
 // Helper function
 const char *my_kbasename(const char *path);
 
@@ -0,0 +1,11 @@
+LOCAL_PATH := $(call my-dir)
+
+# Supercall, kpm_control, hook and unwinder benchmark
+include $(CLEAR_VARS)
+LOCAL_MODULE := kpm_bench
+LOCAL_SRC_FILES := kpm_bench.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)
+# The in-kernel unwinders walk our own frame chain
+LOCAL_CFLAGS := -Wall -O2 -fno-omit-frame-pointer
+LOCAL_LDFLAGS := -static
+include $(BUILD_EXECUTABLE)
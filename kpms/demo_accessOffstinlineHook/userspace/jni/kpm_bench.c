@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * KPM Bench - 测量 supercall、kpm_control、hook 和栈回溯的耗时
+ *
+ * Every call is timed on its own and reported as p50/p99/p999. Run it on
+ * a device or an aarch64 QEMU guest, once per kpimg/module build, and
+ * compare the tables.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "supercall.h"
+
+#define MODULE_NAME "kpm-inline-access"
+#define DEFAULT_ITERS 20000
+#define MAX_ITERS 65536
+// Recursion depth of the caller when timing the in-kernel unwinders
+#define UNWIND_DEPTH 16
+
+// Same layout as bench.h in the module
+struct bench_result {
+    uint32_t count;
+    uint32_t frames;
+    uint64_t freq;
+};
+
+#define BENCH_NOP 0
+#define BENCH_UNWIND 1
+#define BENCH_VMA 2
+#define BENCH_UNWIND_STD 3
+
+static const char *g_key;
+static uint64_t *g_samples;
+
+static inline uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Sort samples and print one row, divided by per when it covers several frames
+ */
+static void report(const char *name, uint64_t *s, long n, int per)
+{
+    if (n <= 0) {
+        printf("  %-22s %s\n", name, "no samples");
+        return;
+    }
+    qsort(s, n, sizeof(s[0]), cmp_u64);
+    double sum = 0;
+    for (long i = 0; i < n; i++) sum += s[i];
+    if (per <= 0) per = 1;
+    printf("  %-22s %9.1f %9.1f %9.1f %9.1f %8ld\n", name, sum / n / per, (double)s[n / 2] / per,
+           (double)s[n * 99 / 100] / per, (double)s[n * 999 / 1000] / per, n);
+}
+
+static void header(const char *title)
+{
+    printf("\n%s\n", title);
+    printf("  %-22s %9s %9s %9s %9s %8s\n", "", "mean", "p50", "p99", "p999", "samples");
+}
+
+static long time_supercall(const char *key, long cmd, long iters)
+{
+    for (long i = 0; i < iters; i++) {
+        uint64_t start = now_ns();
+        syscall(__NR_supercall, key, cmd);
+        g_samples[i] = now_ns() - start;
+    }
+    return iters;
+}
+
+static long time_control(const char *args, long iters, int versioned)
+{
+    char out[64];
+    long cmd = ver_and_cmd(g_key, SUPERCALL_KPM_CONTROL);
+    for (long i = 0; i < iters; i++) {
+        uint64_t start = now_ns();
+        if (versioned) {
+            // what kpm_control pays, compact_cmd() probes the version every call
+            sc_kpm_control(g_key, MODULE_NAME, args, out, sizeof(out));
+        } else {
+            syscall(__NR_supercall, g_key, cmd, MODULE_NAME, args, out, sizeof(out));
+        }
+        g_samples[i] = now_ns() - start;
+    }
+    return iters;
+}
+
+static long time_getppid(long iters)
+{
+    for (long i = 0; i < iters; i++) {
+        uint64_t start = now_ns();
+        syscall(__NR_getppid);
+        g_samples[i] = now_ns() - start;
+    }
+    return iters;
+}
+
+static long time_clock(long iters)
+{
+    for (long i = 0; i < iters; i++) {
+        uint64_t start = now_ns();
+        g_samples[i] = now_ns() - start;
+    }
+    return iters;
+}
+
+static long control(const char *args, void *buf, long len)
+{
+    return syscall(__NR_supercall, g_key, ver_and_cmd(g_key, SUPERCALL_KPM_CONTROL), MODULE_NAME, args, buf, len);
+}
+
+/**
+ * Run an in-kernel benchmark from depth frames down, samples converted to ns
+ */
+static long __attribute__((noinline)) kernel_bench(int depth, int kind, long iters, int *frames)
+{
+    if (depth > 0) {
+        long n = kernel_bench(depth - 1, kind, iters, frames);
+        asm volatile("" ::: "memory"); // keep the frame, no tail call
+        return n;
+    }
+
+    long len = sizeof(struct bench_result) + iters * sizeof(uint32_t);
+    char *buf = malloc(len);
+    if (!buf) return -1;
+
+    char args[64];
+    snprintf(args, sizeof(args), "bench:%d:%ld", kind, iters);
+    long n = control(args, buf, len);
+    if (n > 0) {
+        struct bench_result *res = (struct bench_result *)buf;
+        uint32_t *ticks = (uint32_t *)(res + 1);
+        for (long i = 0; i < n; i++) g_samples[i] = (uint64_t)ticks[i] * 1000000000ull / res->freq;
+        *frames = res->frames;
+    }
+    free(buf);
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        printf("Usage: %s <superkey> [iterations]\n", argv[0]);
+        printf("Times supercall, kpm_control, an empty hook on getppid and the module's\n");
+        printf("stack unwinders. Needs the %s module for all but the supercall rows.\n", MODULE_NAME);
+        return 1;
+    }
+
+    g_key = argv[1];
+    long iters = argc > 2 ? strtol(argv[2], NULL, 0) : DEFAULT_ITERS;
+    if (iters <= 0) iters = DEFAULT_ITERS;
+    if (iters > MAX_ITERS) iters = MAX_ITERS;
+
+    if (!sc_ready(g_key)) {
+        printf("Error: KernelPatch not ready or wrong superkey\n");
+        return 1;
+    }
+
+    g_samples = malloc(iters * sizeof(uint64_t));
+    if (!g_samples) return 1;
+
+    // Rejected calls fall through to truncate(), keep them on a path that can't exist
+    const char *wrong = "/nonexistent/kp_bench_key";
+
+    header("Round trip, ns per call");
+    report("clock_gettime pair", g_samples, time_clock(iters), 1);
+    report("superkey hello", g_samples, time_supercall(g_key, ver_and_cmd(g_key, SUPERCALL_HELLO), iters), 1);
+    report("su hello", g_samples, time_supercall("su", ver_and_cmd("su", SUPERCALL_HELLO), iters), 1);
+    report("wrong key hello", g_samples, time_supercall(wrong, ver_and_cmd(wrong, SUPERCALL_HELLO), iters), 1);
+    report("not a supercall", g_samples, time_supercall(wrong, 0, iters), 1);
+
+    char out[256];
+    if (control("bench_nop", out, sizeof(out)) < 0) {
+        printf("\nModule %s not loaded, skipping module benchmarks\n", MODULE_NAME);
+        free(g_samples);
+        return 0;
+    }
+
+    report("kpm_control nop", g_samples, time_control("bench_nop", iters, 0), 1);
+    report("sc_kpm_control nop", g_samples, time_control("bench_nop", iters, 1), 1);
+
+    header("getppid, ns per call");
+    report("unhooked", g_samples, time_getppid(iters), 1);
+    if (control("bench_hook:1", out, sizeof(out)) < 0) {
+        printf("  %s\n", out);
+    } else {
+        report("empty hook_wrap", g_samples, time_getppid(iters), 1);
+        control("bench_hook:0", out, sizeof(out));
+    }
+
+    static const struct {
+        const char *name;
+        int kind;
+    } kernel_cases[] = {
+        { "timer floor", BENCH_NOP },
+        { "unwind_user_frames", BENCH_UNWIND },
+        { "get_vma_info_str", BENCH_VMA },
+        { "unwind_user_stack_std", BENCH_UNWIND_STD },
+    };
+
+    header("In kernel, ns per frame (timer floor per call)");
+    for (int i = 0; i < sizeof(kernel_cases) / sizeof(kernel_cases[0]); i++) {
+        int frames = 0;
+        long n = kernel_bench(UNWIND_DEPTH, kernel_cases[i].kind, iters, &frames);
+        if (n < 0) {
+            printf("  %-22s failed (%ld)\n", kernel_cases[i].name, n);
+            continue;
+        }
+        report(kernel_cases[i].name, g_samples, n, frames);
+    }
+    printf("\nunwind_user_stack_std prints every frame to dmesg and is capped at 16 samples.\n");
+
+    free(g_samples);
+    return 0;
+}
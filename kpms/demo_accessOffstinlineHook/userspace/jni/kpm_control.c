@@ -9,11 +9,382 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
 
 #include "supercall.h"
 
 #define MODULE_NAME "kpm-inline-access"
 #define OUT_BUF_SIZE 2048
+#define DRAIN_BUF_SIZE (64 * 1024)
+#define MEM_DUMP_BUF_SIZE (16 * 1024 * 1024)
+
+// Must match hw_bp_event.h in the module
+struct hw_bp_event {
+    uint64_t ts;
+    uint64_t pc;
+    uint64_t addr;
+    uint64_t sp;
+    uint64_t lr;
+    uint64_t x0;
+    uint64_t x1;
+    uint32_t tid;
+    uint16_t index;
+    uint16_t flags;
+};
+
+struct hw_bp_event_batch {
+    uint32_t count;
+    uint32_t rec_size;
+    uint64_t dropped;
+    uint64_t freq;
+};
+
+// Drain hit records in batches until the module has none left
+static int drain_bp_events(const char *key)
+{
+    static char buf[DRAIN_BUF_SIZE];
+    struct hw_bp_event_batch *hdr = (struct hw_bp_event_batch *)buf;
+    unsigned long total = 0, dropped = 0;
+    long ret;
+
+    for (;;) {
+        ret = sc_kpm_control(key, MODULE_NAME, "bp_drain", buf, sizeof(buf));
+        if (ret < 0) {
+            fprintf(stderr, "Error: bp_drain failed with code %ld (%s)\n", ret, strerror(-ret));
+            return 1;
+        }
+        if (hdr->rec_size != sizeof(struct hw_bp_event)) {
+            fprintf(stderr, "Error: record size mismatch (%u != %zu)\n", hdr->rec_size, sizeof(struct hw_bp_event));
+            return 1;
+        }
+        dropped += hdr->dropped;
+
+        struct hw_bp_event *ev = (struct hw_bp_event *)(hdr + 1);
+        for (uint32_t i = 0; i < hdr->count; i++, ev++) {
+            double us = hdr->freq ? (double)ev->ts * 1000000.0 / hdr->freq : 0;
+            printf("[%.3f] bp[%u] tid=%u pc=0x%llx addr=0x%llx x0=0x%llx x1=0x%llx lr=0x%llx sp=0x%llx%s%s\n",
+                   us, ev->index, ev->tid, (unsigned long long)ev->pc, (unsigned long long)ev->addr,
+                   (unsigned long long)ev->x0, (unsigned long long)ev->x1, (unsigned long long)ev->lr,
+                   (unsigned long long)ev->sp, (ev->flags & 0x1) ? " compat" : "",
+                   (ev->flags & 0x2) ? " disarmed" : "");
+        }
+        total += hdr->count;
+        if (hdr->count == 0) break;
+    }
+
+    printf("Drained %lu records, %lu dropped\n", total, dropped);
+    return 0;
+}
+
+// Must match hw_bp_stack.h in the module
+#define HW_BP_STACK_DEPTH 16
+
+struct hw_bp_stack {
+    uint32_t stack_id;
+    uint16_t index;
+    uint16_t depth;
+    uint64_t count;
+    uint64_t pcs[HW_BP_STACK_DEPTH];
+};
+
+struct hw_bp_stack_batch {
+    uint32_t count;
+    uint32_t rec_size;
+    uint64_t dropped;
+    uint32_t next;
+    uint32_t reserved;
+};
+
+static int cmp_stack_count(const void *a, const void *b)
+{
+    const struct hw_bp_stack *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->index - y->index;
+}
+
+// Fetch the whole call-path profile and print it hottest first
+static int print_bp_stacks(const char *key)
+{
+    static char buf[DRAIN_BUF_SIZE];
+    struct hw_bp_stack_batch *hdr = (struct hw_bp_stack_batch *)buf;
+    struct hw_bp_stack *all = NULL;
+    size_t n = 0;
+    uint64_t dropped = 0, hits = 0;
+    uint32_t start = 0;
+    char command[32];
+    long ret;
+
+    do {
+        snprintf(command, sizeof(command), "bp_stacks:%u", start);
+        ret = sc_kpm_control(key, MODULE_NAME, command, buf, sizeof(buf));
+        if (ret < 0) {
+            fprintf(stderr, "Error: bp_stacks failed with code %ld (%s)\n", ret, strerror(-ret));
+            free(all);
+            return 1;
+        }
+        if (hdr->rec_size != sizeof(struct hw_bp_stack)) {
+            fprintf(stderr, "Error: record size mismatch (%u != %zu)\n", hdr->rec_size, sizeof(struct hw_bp_stack));
+            free(all);
+            return 1;
+        }
+
+        struct hw_bp_stack *grown = realloc(all, (n + hdr->count) * sizeof(*all));
+        if (!grown && hdr->count) {
+            free(all);
+            return 1;
+        }
+        all = grown;
+        memcpy(all + n, hdr + 1, hdr->count * sizeof(*all));
+        n += hdr->count;
+        dropped = hdr->dropped;
+        start = hdr->next;
+    } while (start);
+
+    qsort(all, n, sizeof(*all), cmp_stack_count);
+    for (size_t i = 0; i < n; i++) {
+        printf("stack %u bp[%u] hits=%llu\n", all[i].stack_id, all[i].index, (unsigned long long)all[i].count);
+        for (uint16_t d = 0; d < all[i].depth && d < HW_BP_STACK_DEPTH; d++) {
+            printf("  #%02u 0x%llx\n", d, (unsigned long long)all[i].pcs[d]);
+        }
+        hits += all[i].count;
+    }
+
+    printf("%zu call paths, %llu hits, %llu dropped\n", n, (unsigned long long)hits, (unsigned long long)dropped);
+    free(all);
+    return 0;
+}
+
+// Must match process_memory.h in the module
+struct mem_dump_batch {
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t next;
+    uint64_t bytes;
+};
+
+struct mem_dump_range {
+    uint64_t addr;
+    uint32_t len;
+    uint32_t flags;
+    uint64_t reserved;
+};
+
+// Dump the present pages of [start, end) into path as a stream of
+// struct mem_dump_range headers, each followed by its data
+static int dump_process_memory(const char *key, const char *pid, const char *start, const char *end, const char *path)
+{
+    char *buf = malloc(MEM_DUMP_BUF_SIZE);
+    struct mem_dump_batch *hdr = (struct mem_dump_batch *)buf;
+    unsigned long long next = strtoull(start, NULL, 0), total = 0, ranges = 0;
+    char command[128];
+    FILE *fp;
+    long ret;
+
+    if (!buf) return 1;
+    fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno));
+        free(buf);
+        return 1;
+    }
+
+    do {
+        snprintf(command, sizeof(command), "mem_dump:%s:0x%llx:%s", pid, next, end);
+        ret = sc_kpm_control(key, MODULE_NAME, command, buf, MEM_DUMP_BUF_SIZE);
+        if (ret < 0) {
+            fprintf(stderr, "Error: mem_dump failed with code %ld (%s)\n", ret, strerror(-ret));
+            break;
+        }
+
+        char *p = (char *)(hdr + 1);
+        for (uint32_t i = 0; i < hdr->count; i++) {
+            struct mem_dump_range *r = (struct mem_dump_range *)p;
+            printf("0x%llx-0x%llx %c%c%c%c\n", (unsigned long long)r->addr, (unsigned long long)(r->addr + r->len),
+                   (r->flags & 0x1) ? 'r' : '-', (r->flags & 0x2) ? 'w' : '-', (r->flags & 0x4) ? 'x' : '-',
+                   (r->flags & 0x8) ? 's' : 'p');
+            p += sizeof(*r) + r->len;
+        }
+        if (fwrite(hdr + 1, 1, p - (char *)(hdr + 1), fp) != (size_t)(p - (char *)(hdr + 1))) {
+            fprintf(stderr, "Error: write to %s failed\n", path);
+            ret = -EIO;
+            break;
+        }
+        ranges += hdr->count;
+        total += hdr->bytes;
+        next = hdr->next;
+    } while (next);
+
+    fclose(fp);
+    free(buf);
+    if (ret < 0) return 1;
+
+    printf("Dumped %llu bytes in %llu ranges to %s\n", total, ranges, path);
+    return 0;
+}
+
+struct mem_patch_batch {
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct mem_patch {
+    uint64_t addr;
+    uint32_t len;
+    uint32_t data_len;
+    uint32_t flags;
+    int32_t result;
+};
+
+#define MEM_PATCH_F_FILL 0x1
+
+// Decode a hex string such as "1f2003d5" into out
+static long parse_hex_bytes(const char *hex, unsigned char *out, size_t max)
+{
+    size_t n = 0;
+    unsigned int byte;
+
+    if (strncmp(hex, "0x", 2) == 0) hex += 2;
+    while (hex[0] && hex[1]) {
+        if (n >= max || sscanf(hex, "%2x", &byte) != 1) return -1;
+        out[n++] = byte;
+        hex += 2;
+    }
+    return *hex ? -1 : (long)n;
+}
+
+// Send patches built from argv as one batch: pairs of <addr> <hex>, or with
+// fill set a single <addr> <len> <hex pattern>
+static int write_process_memory(const char *key, const char *pid, int fill, int argc, char **argv)
+{
+    static char buf[DRAIN_BUF_SIZE];
+    struct mem_patch_batch *hdr = (struct mem_patch_batch *)buf;
+    size_t pos = sizeof(*hdr);
+    char command[64];
+    long ret;
+    int step = fill ? 3 : 2;
+
+    memset(buf, 0, sizeof(buf));
+    for (int i = 0; i + step <= argc; i += step) {
+        struct mem_patch *patch = (struct mem_patch *)(buf + pos);
+        unsigned char *data = (unsigned char *)(patch + 1);
+        long n = parse_hex_bytes(argv[i + step - 1], data, sizeof(buf) - pos - sizeof(*patch));
+
+        if (n <= 0) {
+            fprintf(stderr, "Error: invalid hex data: %s\n", argv[i + step - 1]);
+            return 1;
+        }
+        patch->addr = strtoull(argv[i], NULL, 0);
+        patch->data_len = n;
+        patch->len = fill ? strtoul(argv[i + 1], NULL, 0) : n;
+        patch->flags = fill ? MEM_PATCH_F_FILL : 0;
+        pos += sizeof(*patch) + ((n + 7) & ~7UL);
+        hdr->count++;
+        if (pos + sizeof(*patch) + 8 > sizeof(buf)) break;
+    }
+
+    snprintf(command, sizeof(command), "mem_write:%s", pid);
+    ret = sc_kpm_control(key, MODULE_NAME, command, buf, pos);
+    if (ret < 0) {
+        fprintf(stderr, "Error: mem_write failed with code %ld (%s)\n", ret, strerror(-ret));
+        return 1;
+    }
+
+    int failed = 0;
+    pos = sizeof(*hdr);
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        struct mem_patch *patch = (struct mem_patch *)(buf + pos);
+        if (patch->result < 0) {
+            printf("0x%llx: failed (%s)\n", (unsigned long long)patch->addr, strerror(-patch->result));
+            failed++;
+        } else {
+            printf("0x%llx: wrote %d/%u bytes\n", (unsigned long long)patch->addr, patch->result, patch->len);
+            if ((uint32_t)patch->result != patch->len) failed++;
+        }
+        pos += sizeof(*patch) + ((patch->data_len + 7) & ~7UL);
+    }
+
+    printf("Applied %ld patches, %d incomplete\n", ret, failed);
+    return failed ? 1 : 0;
+}
+
+// Must match process_memory.h in the module
+#define MEM_SEARCH_MAX_PATTERN 256
+
+struct mem_search_req {
+    uint32_t len;
+    uint32_t max_results;
+    uint32_t vma_flags;
+    uint32_t reserved;
+    char name[64];
+    uint8_t pattern[MEM_SEARCH_MAX_PATTERN];
+    uint8_t mask[MEM_SEARCH_MAX_PATTERN];
+};
+
+struct mem_search_result {
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t next;
+};
+
+// Search a process for a hex pattern, "??" bytes are wildcards
+// filter: any of w (writable), x (exec), f (file-backed), a (anonymous), or "-"
+static int search_process_memory(const char *key, const char *pid, const char *pattern, unsigned long max,
+                                 const char *filter, const char *name)
+{
+    static char buf[DRAIN_BUF_SIZE];
+    struct mem_search_req req;
+    struct mem_search_result *res = (struct mem_search_result *)buf;
+    unsigned long long next = 0, end = 1ULL << 48;
+    unsigned long total = 0;
+    char command[96];
+    long ret;
+
+    memset(&req, 0, sizeof(req));
+    for (const char *p = pattern; p[0] && p[1]; p += 2) {
+        unsigned int byte;
+        if (req.len >= MEM_SEARCH_MAX_PATTERN) {
+            fprintf(stderr, "Error: pattern longer than %d bytes\n", MEM_SEARCH_MAX_PATTERN);
+            return 1;
+        }
+        if (p[0] == '?' && p[1] == '?') {
+            req.mask[req.len++] = 0;
+        } else if (sscanf(p, "%2x", &byte) == 1) {
+            req.pattern[req.len] = byte;
+            req.mask[req.len++] = 0xff;
+        } else {
+            fprintf(stderr, "Error: invalid pattern: %s\n", pattern);
+            return 1;
+        }
+    }
+    for (const char *f = filter; f && *f; f++) {
+        if (*f == 'w') req.vma_flags |= 0x1;
+        if (*f == 'x') req.vma_flags |= 0x2;
+        if (*f == 'f') req.vma_flags |= 0x4;
+        if (*f == 'a') req.vma_flags |= 0x8;
+    }
+    if (name) strncpy(req.name, name, sizeof(req.name) - 1);
+
+    do {
+        if (max) req.max_results = max - total;
+        memcpy(buf, &req, sizeof(req));
+        snprintf(command, sizeof(command), "mem_search:%s:0x%llx:0x%llx", pid, next, end);
+        ret = sc_kpm_control(key, MODULE_NAME, command, buf, sizeof(buf));
+        if (ret < 0) {
+            fprintf(stderr, "Error: mem_search failed with code %ld (%s)\n", ret, strerror(-ret));
+            return 1;
+        }
+
+        uint64_t *addrs = (uint64_t *)(res + 1);
+        for (uint32_t i = 0; i < res->count; i++) {
+            printf("0x%llx\n", (unsigned long long)addrs[i]);
+        }
+        total += res->count;
+        next = res->next;
+    } while (next && (!max || total < max));
+
+    printf("Found %lu matches\n", total);
+    return 0;
+}
 
 static void print_usage(const char *prog)
 {
@@ -33,6 +404,8 @@ static void print_usage(const char *prog)
     printf("  disable_openat    - Disable openat() hook\n");
     printf("  enable_kill       - Enable kill() hook\n");
     printf("  disable_kill      - Disable kill() hook\n");
+    printf("  enable_symbols    - Resolve lib!func+0x in stack traces\n");
+    printf("  disable_symbols   - Print lib + 0xoffset in stack traces\n");
     printf("\n");
     printf("Filter Commands:\n");
     printf("  set_whitelist     - Set filter mode to whitelist (only hook filtered)\n");
@@ -48,9 +421,19 @@ static void print_usage(const char *prog)
     printf("    size: 0=1byte, 1=2bytes, 2=4bytes, 3=8bytes\n");
     printf("    pid:  Optional PID (0 or omit for system-wide)\n");
     printf("    desc: Optional description\n");
-    printf("  bp_clear <index>  - Clear breakpoint by index (0-3)\n");
+    printf("  bp_range <addr> <len> <type> [pid] [desc] - Watch [addr, addr+len) with one slot\n");
+    printf("    type: 1=write, 2=read, 3=rw\n");
+    printf("  bp_clear <index>  - Clear breakpoint by index\n");
+    printf("  bp_cond <index> <conds> - Set hit conditions, 'none' clears\n");
+    printf("    conds: comma separated x<n>=|!|<|>|&<val>, tid=, skip=, sample=, rate=, burst=\n");
+    printf("  bp_rearm <step|move> - Select breakpoint re-arm engine\n");
     printf("  bp_clear_all      - Clear all breakpoints\n");
     printf("  bp_list           - List all breakpoints\n");
+    printf("  bp_drain          - Print and remove recorded breakpoint hits\n");
+    printf("  bp_drain_reset    - Discard recorded breakpoint hits\n");
+    printf("  bp_stack <index> [depth] - Count hits per user call path, depth 0 stops\n");
+    printf("  bp_stacks         - Print call paths, most hits first\n");
+    printf("  bp_stacks_reset   - Discard call paths\n");
     printf("  bp_verbose_on     - Enable detailed logging (WARNING: may cause issues)\n");
     printf("  bp_verbose_off    - Disable detailed logging (default, safe)\n");
     printf("\n");
@@ -59,6 +442,11 @@ static void print_usage(const char *prog)
     printf("    pid:  Target process PID\n");
     printf("    addr: Memory address in hex (e.g., 0x7f12345678)\n");
     printf("    size: Number of bytes to read (1-256)\n");
+    printf("  mem_dump <pid> <start> <end> <file> - Dump present pages of a range to file\n");
+    printf("  mem_write <pid> <addr> <hex> [<addr> <hex> ...] - Patch process memory in one batch\n");
+    printf("  mem_fill <pid> <addr> <len> <hex> - Fill len bytes with a repeated pattern\n");
+    printf("  mem_search <pid> <pattern> [max] [filter] [name] - Search memory, ?? = any byte\n");
+    printf("    filter: w=writable x=exec f=file a=anon, - for none\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s su get_status\n", prog);
@@ -98,6 +486,39 @@ int main(int argc, char *argv[])
 
     printf("KernelPatch detected, version: 0x%08x\n", sc_kp_ver(key));
     
+    // Binary reply, handled separately
+    if (strcmp(command, "bp_drain") == 0) {
+        return drain_bp_events(key);
+    }
+    if (strcmp(command, "bp_stacks") == 0) {
+        return print_bp_stacks(key);
+    }
+    if (strcmp(command, "mem_dump") == 0) {
+        if (argc < 7) {
+            fprintf(stderr, "Error: mem_dump requires PID, start, end, and output file\n");
+            fprintf(stderr, "Usage: %s <key> mem_dump <pid> <start> <end> <file>\n", argv[0]);
+            return 1;
+        }
+        return dump_process_memory(key, argv[3], argv[4], argv[5], argv[6]);
+    }
+    if (strcmp(command, "mem_write") == 0 || strcmp(command, "mem_fill") == 0) {
+        int fill = command[4] == 'f';
+        if (argc < (fill ? 7 : 6)) {
+            fprintf(stderr, "Usage: %s <key> mem_write <pid> <addr> <hex> [<addr> <hex> ...]\n", argv[0]);
+            fprintf(stderr, "       %s <key> mem_fill <pid> <addr> <len> <hex>\n", argv[0]);
+            return 1;
+        }
+        return write_process_memory(key, argv[3], fill, argc - 4, argv + 4);
+    }
+    if (strcmp(command, "mem_search") == 0) {
+        if (argc < 5) {
+            fprintf(stderr, "Usage: %s <key> mem_search <pid> <pattern> [max] [filter] [name]\n", argv[0]);
+            return 1;
+        }
+        return search_process_memory(key, argv[3], argv[4], argc >= 6 ? strtoul(argv[5], NULL, 0) : 0,
+                                     argc >= 7 ? argv[6] : NULL, argc >= 8 ? argv[7] : NULL);
+    }
+
     // Handle special commands that need arguments
     if (strcmp(command, "add_name") == 0) {
         if (argc < 4) {
@@ -161,6 +582,16 @@ int main(int argc, char *argv[])
                     argv[3], argv[4], argv[5]);
         }
         command = full_command;
+    } else if (strcmp(command, "bp_range") == 0) {
+        // bp_range <addr> <len> <type> [pid] [desc]
+        if (argc < 6) {
+            fprintf(stderr, "Error: bp_range requires address, length, and type\n");
+            fprintf(stderr, "Usage: %s <key> bp_range <addr> <len> <type> [pid] [desc]\n", argv[0]);
+            return 1;
+        }
+        snprintf(full_command, sizeof(full_command), "bp_range:%s:%s:%s:%s:%s",
+                argv[3], argv[4], argv[5], argc >= 7 ? argv[6] : "0", argc >= 8 ? argv[7] : "");
+        command = full_command;
     } else if (strcmp(command, "bp_clear") == 0) {
         if (argc < 4) {
             fprintf(stderr, "Error: bp_clear requires an index\n");
@@ -169,6 +600,30 @@ int main(int argc, char *argv[])
         }
         snprintf(full_command, sizeof(full_command), "bp_clear:%s", argv[3]);
         command = full_command;
+    } else if (strcmp(command, "bp_cond") == 0) {
+        if (argc < 5) {
+            fprintf(stderr, "Error: bp_cond requires an index and conditions\n");
+            fprintf(stderr, "Usage: %s <key> bp_cond <index> <conds|none>\n", argv[0]);
+            fprintf(stderr, "  e.g. x0=0x10,tid=1234,skip=5,sample=10,rate=100,burst=10\n");
+            return 1;
+        }
+        snprintf(full_command, sizeof(full_command), "bp_cond:%s:%s", argv[3], argv[4]);
+        command = full_command;
+    } else if (strcmp(command, "bp_stack") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Error: bp_stack requires an index\n");
+            fprintf(stderr, "Usage: %s <key> bp_stack <index> [depth]\n", argv[0]);
+            return 1;
+        }
+        snprintf(full_command, sizeof(full_command), "bp_stack:%s:%s", argv[3], argc >= 5 ? argv[4] : "16");
+        command = full_command;
+    } else if (strcmp(command, "bp_rearm") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Error: bp_rearm requires step or move\n");
+            return 1;
+        }
+        snprintf(full_command, sizeof(full_command), "bp_rearm:%s", argv[3]);
+        command = full_command;
     } else if (strcmp(command, "mem_read") == 0) {
         // mem_read <pid> <addr> <size>
         if (argc < 6) {
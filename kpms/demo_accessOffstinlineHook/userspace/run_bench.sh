@@ -0,0 +1,61 @@
+#!/system/bin/sh
+# Run kpm_bench, keep the output and compare p50 against an earlier run
+# Start it as "sh run_bench.sh ..." where /system/bin/sh doesn't exist, e.g. a busybox initramfs
+
+SUPERKEY="$1"
+BASELINE="$2"
+ITERS="${ITERS:-20000}"
+# Allowed p50 regression in percent
+LIMIT="${LIMIT:-20}"
+BENCH="${BENCH:-./kpm_bench}"
+
+if [ -z "$SUPERKEY" ]; then
+    echo "Usage: $0 <superkey> [baseline.txt]"
+    echo "Env: ITERS (default 20000), LIMIT percent (default 20), BENCH (default ./kpm_bench)"
+    exit 1
+fi
+
+OUT="bench_$(date +%Y%m%d_%H%M%S).txt"
+"$BENCH" "$SUPERKEY" "$ITERS" | tee "$OUT"
+echo ""
+echo "Saved to $OUT"
+
+if [ -z "$BASELINE" ]; then
+    exit 0
+fi
+if [ ! -f "$BASELINE" ]; then
+    echo "Baseline $BASELINE not found"
+    exit 1
+fi
+
+echo ""
+echo "p50 against $BASELINE (limit +${LIMIT}%)"
+echo "================================"
+
+# Rows are "  <name, 22 wide> mean p50 p99 p999 samples", section titles and headers are skipped
+awk -v limit="$LIMIT" '
+function row() {
+    if (substr($0, 1, 2) != "  " || NF < 6 || $NF !~ /^[0-9]+$/) return 0
+    name = substr($0, 3, 22)
+    sub(/ +$/, "", name)
+    key = section "/" name
+    return 1
+}
+FNR == 1 { section = "" }
+/^[^ ]/ { section = $0 }
+NR == FNR { if (row()) base[key] = $(NF - 3); next }
+row() && (key in base) && base[key] > 0 {
+    delta = ($(NF - 3) - base[key]) * 100 / base[key]
+    flag = delta > limit ? "  REGRESSED" : ""
+    if (flag != "") bad++
+    printf "  %-40s %9.1f -> %9.1f  %+6.1f%%%s\n", key, base[key], $(NF - 3), delta, flag
+}
+END { exit bad ? 1 : 0 }
+' "$BASELINE" "$OUT"
+RC=$?
+
+if [ $RC -ne 0 ]; then
+    echo ""
+    echo "Regression over ${LIMIT}%"
+fi
+exit $RC
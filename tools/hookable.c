@@ -0,0 +1,320 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2024 bmax121. All Rights Reserved.
+ */
+
+#define _GNU_SOURCE
+#define __USE_GNU
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "hookable.h"
+#include "pcrel.h"
+#include "patch.h"
+#include "kallsym.h"
+#include "common.h"
+
+// Same as hook_relocate(), see kernel/include/hook.h and kernel/base/relocate.c
+#define TRAMP_INST_NUM 4
+#define RELOCATE_INST_NUM (4 * 8 + 8 - 4)
+#define JUMP_BACK_INST_NUM 4
+
+#define ARM64_BTI_C 0xd503245f
+#define ARM64_BTI_J 0xd503249f
+#define ARM64_BTI_JC 0xd50324df
+#define ARM64_PACIASP 0xd503233f
+#define ARM64_PACIBSP 0xd503237f
+
+// Longest function body searched for branches into the trampoline
+#define BRANCH_SCAN_MAX 0x10000
+
+typedef struct
+{
+    int32_t offset;
+    int32_t end;
+    int32_t index;
+    char type;
+    char *name;
+} func_sym_t;
+
+typedef struct
+{
+    func_sym_t *syms;
+    int32_t num;
+    int32_t cap;
+} sym_list_t;
+
+static const char *status_str[] = {
+    [HOOKSCAN_OK] = "hookable",
+    [HOOKSCAN_RELO] = "relocate",
+    [HOOKSCAN_BAD] = "unhookable",
+};
+
+static const char *reason_str[] = {
+    [HOOKSCAN_R_NONE] = "-",
+    [HOOKSCAN_R_SHORT] = "short",
+    [HOOKSCAN_R_BRANCH_IN] = "branch_in",
+    [HOOKSCAN_R_LITERAL] = "literal",
+    [HOOKSCAN_R_RELO_LEN] = "relo_len",
+    [HOOKSCAN_R_OUT] = "out",
+};
+
+// A64 instructions are little-endian, even in a big-endian kernel
+static inline uint32_t read_inst(const char *img, int64_t offset)
+{
+    return (uint32_t)uint_unpack((void *)(img + offset), 4, false);
+}
+
+static inline bool is_text(char type)
+{
+    return type == 't' || type == 'T';
+}
+
+static int32_t collect_symbol(int32_t index, char type, const char *symbol, int32_t offset, void *userdata)
+{
+    sym_list_t *list = (sym_list_t *)userdata;
+    if (list->num == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 0x4000;
+        list->syms = (func_sym_t *)realloc(list->syms, list->cap * sizeof(func_sym_t));
+        if (!list->syms) tools_loge_exit("no memory for %d symbols\n", list->cap);
+    }
+    func_sym_t *sym = &list->syms[list->num++];
+    sym->offset = offset;
+    sym->end = 0;
+    sym->index = index;
+    sym->type = type;
+    sym->name = strdup(symbol);
+    return 0;
+}
+
+static int sym_compare(const void *a, const void *b)
+{
+    const func_sym_t *x = (const func_sym_t *)a, *y = (const func_sym_t *)b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return x->index - y->index;
+}
+
+/**
+ * Last symbol at or below offset, -1 if none
+ */
+static int32_t find_symbol(const sym_list_t *list, int64_t offset)
+{
+    int32_t lo = 0, hi = list->num;
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (list->syms[mid].offset <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - 1;
+}
+
+static int64_t inst_target(uint32_t inst, int cls, int64_t pc)
+{
+    return (int64_t)pcrel_target(inst, cls, (uint64_t)pc);
+}
+
+static inline bool in_window(int64_t addr, int64_t start, int32_t num)
+{
+    return addr >= start && addr < start + num * 4;
+}
+
+static bool is_branch(int cls)
+{
+    switch (cls) {
+    case PCREL_B:
+    case PCREL_BC:
+    case PCREL_BL:
+    case PCREL_CBZ:
+    case PCREL_CBNZ:
+    case PCREL_TBZ:
+    case PCREL_TBNZ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool is_literal_load(int cls)
+{
+    return cls >= PCREL_LDR_32 && cls <= PCREL_LDR_SIMD_128 && cls != PCREL_PRFM;
+}
+
+/**
+ * Decide what hook_prepare() would do with the function at syms[idx], without the kernel.
+ */
+static void scan_func(const char *img, int32_t img_len, const sym_list_t *list, int32_t idx,
+                      struct hookscan_entry *entry)
+{
+    const func_sym_t *sym = &list->syms[idx];
+    int64_t origin = sym->offset;
+    int64_t start = sym->offset;
+    int64_t end = sym->end;
+
+    memset(entry, 0, sizeof(*entry));
+    entry->offset = sym->offset;
+
+    // branch_func_addr()
+    for (int i = 0; i < 8 && origin >= 0 && origin + 4 <= img_len; i++) {
+        uint32_t inst = read_inst(img, origin);
+        int cls = pcrel_class(inst);
+        if (cls == PCREL_B) {
+            origin = inst_target(inst, cls, origin);
+            entry->flags |= HOOKSCAN_F_FOLLOW;
+        } else if (inst == ARM64_BTI_C || inst == ARM64_BTI_J || inst == ARM64_BTI_JC) {
+            origin += 4;
+            entry->flags |= HOOKSCAN_F_BTI;
+        } else {
+            break;
+        }
+    }
+
+    if (entry->flags & HOOKSCAN_F_FOLLOW) {
+        int32_t at = find_symbol(list, origin);
+        if (at >= 0) {
+            start = list->syms[at].offset;
+            end = list->syms[at].end;
+        } else {
+            start = end = 0;
+        }
+    }
+
+    int32_t tramp_num = TRAMP_INST_NUM;
+    if (origin < 0 || origin + (TRAMP_INST_NUM + 1) * 4 > img_len) goto out_of_image;
+    uint32_t first = read_inst(img, origin);
+    if (first == ARM64_PACIASP || first == ARM64_PACIBSP) {
+        tramp_num++;
+        entry->flags |= HOOKSCAN_F_PAC;
+    }
+
+    if (origin + tramp_num * 4 > end) {
+        entry->status = HOOKSCAN_BAD;
+        entry->reason = HOOKSCAN_R_SHORT;
+        return;
+    }
+
+    // relocate_inst()
+    int32_t relo_num = 0;
+    entry->status = HOOKSCAN_OK;
+    for (int32_t i = 0; i < tramp_num; i++) {
+        int64_t pc = origin + i * 4;
+        uint32_t inst = read_inst(img, pc);
+        int cls = pcrel_class(inst);
+        int len = pcrel_relo_len[cls];
+        if (relo_num + len + JUMP_BACK_INST_NUM > RELOCATE_INST_NUM) {
+            entry->status = HOOKSCAN_BAD;
+            entry->reason = HOOKSCAN_R_RELO_LEN;
+            return;
+        }
+        if (is_literal_load(cls) && in_window(inst_target(inst, cls, pc), origin, tramp_num)) {
+            entry->status = HOOKSCAN_BAD;
+            entry->reason = HOOKSCAN_R_LITERAL;
+            return;
+        }
+        if (cls != PCREL_NONE) entry->status = HOOKSCAN_RELO;
+        relo_num += len;
+    }
+    entry->relo_num = relo_num;
+
+    // Branches from the rest of the function would land in the middle of the trampoline.
+    // Those inside it are fixed up by relo_in_tramp().
+    if (end - start > BRANCH_SCAN_MAX) end = start + BRANCH_SCAN_MAX;
+    for (int64_t pc = start & ~3ll; pc + 4 <= end; pc += 4) {
+        if (in_window(pc, origin, tramp_num)) continue;
+        uint32_t inst = read_inst(img, pc);
+        int cls = pcrel_class(inst);
+        if (!is_branch(cls)) continue;
+        int64_t target = inst_target(inst, cls, pc);
+        if (target != origin && in_window(target, origin, tramp_num)) {
+            entry->status = HOOKSCAN_BAD;
+            entry->reason = HOOKSCAN_R_BRANCH_IN;
+            return;
+        }
+    }
+    return;
+
+out_of_image:
+    entry->status = HOOKSCAN_BAD;
+    entry->reason = HOOKSCAN_R_OUT;
+}
+
+int scan_hookable(const char *kimg_path, const char *out_path)
+{
+    if (!kimg_path) tools_loge_exit("empty kernel image\n");
+    set_log_enable(true);
+
+    kernel_file_t kernel_file;
+    read_kernel_file(kimg_path, &kernel_file);
+
+    kallsym_t kallsym;
+    if (analyze_kallsym_info(&kallsym, kernel_file.kimg, kernel_file.kimg_len, ARM64, 1)) {
+        fprintf(stdout, "analyze_kallsym_info error\n");
+        return -1;
+    }
+
+    sym_list_t list = { 0 };
+    on_each_symbol(&kallsym, kernel_file.kimg, &list, collect_symbol);
+    qsort(list.syms, list.num, sizeof(func_sym_t), sym_compare);
+
+    // a function ends where the next symbol at a higher offset starts
+    int32_t next = kernel_file.kimg_len;
+    for (int32_t i = list.num - 1; i >= 0; i--) {
+        list.syms[i].end = next;
+        if (i > 0 && list.syms[i - 1].offset < list.syms[i].offset) next = list.syms[i].offset;
+    }
+
+    struct hookscan_header *table =
+        (struct hookscan_header *)malloc(sizeof(*table) + list.num * sizeof(struct hookscan_entry));
+    if (!table) tools_loge_exit("no memory for hookscan table\n");
+    memset(table, 0, sizeof(*table));
+    table->magic = HOOKSCAN_MAGIC;
+    table->version = HOOKSCAN_VERSION;
+
+    int32_t counts[HOOKSCAN_BAD + 1] = { 0 };
+    struct hookscan_entry entry = { 0 };
+    int32_t last = -1;
+
+    for (int32_t i = 0; i < list.num; i++) {
+        func_sym_t *sym = &list.syms[i];
+        if (!is_text(sym->type)) continue;
+        if (sym->offset < 0 || sym->offset >= kernel_file.kimg_len) continue;
+
+        // aliases share the result
+        if (sym->offset != last) {
+            scan_func(kernel_file.kimg, kernel_file.kimg_len, &list, i, &entry);
+            last = sym->offset;
+            table->func_num++;
+            counts[entry.status]++;
+            if (entry.status != HOOKSCAN_OK) table->entries[table->entry_num++] = entry;
+        }
+
+        if (!out_path) {
+            fprintf(stdout, "0x%08x %-10s %-9s %c%c%c %2d %s\n", entry.offset, status_str[entry.status],
+                    reason_str[entry.reason], entry.flags & HOOKSCAN_F_FOLLOW ? 'b' : '-',
+                    entry.flags & HOOKSCAN_F_BTI ? 't' : '-', entry.flags & HOOKSCAN_F_PAC ? 'p' : '-',
+                    entry.relo_num, sym->name);
+        }
+    }
+
+    tools_logi("functions: %d, hookable: %d, relocate: %d, unhookable: %d\n", table->func_num, counts[HOOKSCAN_OK],
+               counts[HOOKSCAN_RELO], counts[HOOKSCAN_BAD]);
+
+    if (out_path) {
+        int len = sizeof(*table) + table->entry_num * sizeof(struct hookscan_entry);
+        write_file(out_path, (const char *)table, len, false);
+        tools_logi("hookscan table: %s, entries: %d, size: %d\n", out_path, table->entry_num, len);
+    }
+
+    for (int32_t i = 0; i < list.num; i++) {
+        free(list.syms[i].name);
+    }
+    free(list.syms);
+    free(table);
+    set_log_enable(false);
+    free_kernel_file(&kernel_file);
+    return 0;
+}
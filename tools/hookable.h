@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2024 bmax121. All Rights Reserved.
+ */
+
+#ifndef _KP_TOOL_HOOKABLE_H_
+#define _KP_TOOL_HOOKABLE_H_
+
+#include <stdint.h>
+
+#include "hookscan.h"
+
+int scan_hookable(const char *kimg_path, const char *out_path);
+
+#endif
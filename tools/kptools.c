@@ -24,6 +24,7 @@
 #include "patch.h"
 #include "common.h"
 #include "kpm.h"
+#include "hookable.h"
 
 uint32_t version = 0;
 const char *program_name = NULL;
@@ -40,10 +41,14 @@ void print_usage(char **argv)
         "  -v, --version                    Print version number. Print kpimg version if -k specified.\n"
 
         "  -p, --patch                      Patch or Update patch of kernel image(-i) with specified kpimg(-k) and superkey(-s).\n"
+        "  -U, --update-extra               Add, replace or detach extra items of patched image(-i) in place, or in (-o).\n"
+        "                                   Items not named are kept, only the changed bytes are written.\n"
         "  -u, --unpatch                    Unpatch patched kernel image(-i).\n"
         "  -r, --reset-skey                 Reset superkey of patched image(-i).\n"
         "  -d, --dump                       Dump kallsyms infomations of kernel image(-i).\n"
         "  -f, --flag                       Dump ikconfig infomations of kernel image(-i).\n"
+        "  -H, --hookscan                   Classify every function of kernel image(-i) as hookable, relocate or unhookable.\n"
+        "                                   Write the table for modules (see hookscan.h) to (-o) if specified.\n"
         "  -l, --list                       Print all patch informations of kernel image if (-i) specified.\n"
         "                                   Print extra item informations if (-M) specified.\n"
         "                                   Print KernelPatch image informations if (-k) specified.\n"
@@ -65,6 +70,7 @@ void print_usage(char **argv)
         "  -N, --extra-name NAME            Set name of previous extra item.\n"
         "  -V, --extra-event EVENT          Set trigger event of previous extra item.\n"
         "  -A, --extra-args ARGS            Set arguments of previous extra item.\n"
+        "  -C, --extra-compress             Compress previous kpm item with lz4, decompressed when it is loaded.\n"
         "  -D, --extra-detach               Detach previous extra item from patches.\n"
         "\n";
     fprintf(stdout, c, version, program_name);
@@ -80,9 +86,11 @@ int main(int argc, char *argv[])
 
                                  { "patch", no_argument, NULL, 'p' },
                                  { "unpatch", no_argument, NULL, 'u' },
+                                 { "update-extra", no_argument, NULL, 'U' },
                                  { "resetkey", no_argument, NULL, 'r' },
                                  { "dump", no_argument, NULL, 'd' },
                                  { "flag", no_argument, NULL, 'f' },
+                                 { "hookscan", no_argument, NULL, 'H' },
                                  { "list", no_argument, NULL, 'l' },
 
                                  { "image", required_argument, NULL, 'i' },
@@ -98,8 +106,10 @@ int main(int argc, char *argv[])
                                  { "extra-name", required_argument, NULL, 'N' },
                                  { "extra-event", required_argument, NULL, 'V' },
                                  { "extra-args", required_argument, NULL, 'A' },
+                                 { "extra-detach", no_argument, NULL, 'D' },
+                                 { "extra-compress", no_argument, NULL, 'C' },
                                  { 0, 0, 0, 0 } };
-    char *optstr = "hvpurdfli:s:S:k:o:a:M:E:T:N:V:A:";
+    char *optstr = "hvpuUrdfHli:s:S:k:o:a:M:E:T:N:V:A:DC";
 
     char *kimg_path = NULL;
     char *kpimg_path = NULL;
@@ -125,9 +135,11 @@ int main(int argc, char *argv[])
         case 'v':
         case 'p':
         case 'u':
+        case 'U':
         case 'r':
         case 'd':
         case 'f':
+        case 'H':
         case 'l':
             cmd = opt;
             break;
@@ -168,11 +180,17 @@ int main(int argc, char *argv[])
             config->set_event = optarg;
             break;
         case 'N':
-            config->name = optarg;
+            config->set_name = optarg;
             break;
         case 'A':
             config->set_args = optarg;
             break;
+        case 'D':
+            config->detach = true;
+            break;
+        case 'C':
+            config->compress = true;
+            break;
         default:
             break;
         }
@@ -193,6 +211,10 @@ int main(int argc, char *argv[])
         ret = dump_kallsym(kimg_path);
     } else if (cmd == 'f') {
         ret = dump_ikconfig(kimg_path);
+    } else if (cmd == 'H') {
+        ret = scan_hookable(kimg_path, out_path);
+    } else if (cmd == 'U') {
+        ret = update_extra_img(kimg_path, out_path, extra_configs, extra_config_num);
     } else if (cmd == 'u') {
         ret = unpatch_img(kimg_path, out_path);
     } else if (cmd == 'r') {
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2024 bmax121. All Rights Reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz4.h"
+
+#define HASH_LOG 16
+#define MIN_MATCH 4
+#define MAX_OFFSET 0xFFFF
+// the last match starts this far from the end at the latest, the last literals are at least LAST_LITERALS
+#define MF_LIMIT 12
+#define LAST_LITERALS 5
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+static uint8_t *put_length(uint8_t *op, int len)
+{
+    for (; len >= 255; len -= 255) *op++ = 255;
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *lit, int lit_len, int offset, int match_len)
+{
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15) op = put_length(op, lit_len - 15);
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+    if (!match_len) return op;
+
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    match_len -= MIN_MATCH;
+    *token |= match_len < 15 ? match_len : 15;
+    if (match_len >= 15) op = put_length(op, match_len - 15);
+    return op;
+}
+
+int lz4_compress(const void *src, int len, void *dst, int cap)
+{
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + cap;
+    int ip = 0, anchor = 0;
+
+    int32_t *table = (int32_t *)malloc(sizeof(int32_t) << HASH_LOG);
+    if (!table) return -1;
+    memset(table, 0xFF, sizeof(int32_t) << HASH_LOG);
+
+    while (ip < len - MF_LIMIT) {
+        uint32_t v = read32(in + ip);
+        uint32_t h = hash4(v);
+        int ref = table[h];
+        table[h] = ip;
+        if (ref < 0 || ip - ref > MAX_OFFSET || read32(in + ref) != v) {
+            ip++;
+            continue;
+        }
+
+        int match_len = MIN_MATCH;
+        int max_len = len - LAST_LITERALS - ip;
+        while (match_len < max_len && in[ref + match_len] == in[ip + match_len]) match_len++;
+        while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+            ip--;
+            ref--;
+            match_len++;
+        }
+
+        int lit_len = ip - anchor;
+        if (oend - op < lit_len + lit_len / 255 + match_len / 255 + 8) goto overflow;
+        op = put_sequence(op, in + anchor, lit_len, ip - ref, match_len);
+        ip += match_len;
+        anchor = ip;
+    }
+
+    int lit_len = len - anchor;
+    if (oend - op < lit_len + lit_len / 255 + 2) goto overflow;
+    op = put_sequence(op, in + anchor, lit_len, 0, 0);
+    free(table);
+    return op - (uint8_t *)dst;
+
+overflow:
+    free(table);
+    return -1;
+}
+
+static int get_length(const uint8_t **ip, const uint8_t *iend, int len)
+{
+    uint8_t b;
+    if (len != 15) return len;
+    do {
+        if (*ip >= iend) return -1;
+        b = *(*ip)++;
+        len += b;
+        if (len > (1 << 28)) return -1;
+    } while (b == 255);
+    return len;
+}
+
+int lz4_decompress(const void *src, int src_len, void *dst, int dst_len)
+{
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + src_len;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + dst_len;
+
+    while (ip < iend) {
+        int token = *ip++;
+        int len = get_length(&ip, iend, token >> 4);
+        if (len < 0 || len > iend - ip || len > oend - op) return -1;
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+        if (op == oend) break;
+
+        if (iend - ip < 2) return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > op - (uint8_t *)dst) return -1;
+        len = get_length(&ip, iend, token & 15);
+        if (len < 0) return -1;
+        len += MIN_MATCH;
+        if (len > oend - op) return -1;
+        const uint8_t *match = op - offset;
+        while (len--) *op++ = *match++;
+    }
+    return op - (uint8_t *)dst;
+}
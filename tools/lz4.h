@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2024 bmax121. All Rights Reserved.
+ */
+
+#ifndef _KP_TOOL_LZ4_H_
+#define _KP_TOOL_LZ4_H_
+
+#include <stdint.h>
+
+// Worst case of lz4_compress() for len bytes
+#define LZ4_BOUND(len) ((len) + (len) / 255 + 16)
+
+/**
+ * Compress src into a single lz4 block, as kernel/base/lz4.c decompresses it.
+ * Returns the compressed length, or -1 if it doesn't fit in cap bytes.
+ */
+int lz4_compress(const void *src, int len, void *dst, int cap);
+
+int lz4_decompress(const void *src, int src_len, void *dst, int dst_len);
+
+#endif
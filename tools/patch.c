@@ -13,6 +13,13 @@
 #include <assert.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "patch.h"
 #include "kallsym.h"
@@ -23,11 +30,30 @@
 #include "symbol.h"
 #include "kpm.h"
 #include "sha256.h"
+#include "lz4.h"
 
 void read_kernel_file(const char *path, kernel_file_t *kernel_file)
 {
     int img_offset = 0;
-    read_file(path, &kernel_file->kfile, &kernel_file->kfile_len);
+    memset(kernel_file, 0, sizeof(*kernel_file));
+#ifndef _WIN32
+    // private mapping, pages are only read in when used and only copied when changed in memory
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) tools_log_errno_exit("open file %s\n", path);
+    struct stat st;
+    if (fstat(fd, &st)) tools_log_errno_exit("stat file %s\n", path);
+    if (st.st_size > 0 && st.st_size <= INT32_MAX) {
+        void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            kernel_file->kfile = (char *)map;
+            kernel_file->kfile_len = kernel_file->map_len = (int32_t)st.st_size;
+            kernel_file->map_dev = st.st_dev;
+            kernel_file->map_ino = st.st_ino;
+        }
+    }
+    close(fd);
+#endif
+    if (!kernel_file->kfile) read_file(path, &kernel_file->kfile, &kernel_file->kfile_len);
     kernel_file->is_uncompressed_img = kernel_file->kfile_len >= 20 &&
                                        !strncmp("UNCOMPRESSED_IMG", kernel_file->kfile, 16);
     if (kernel_file->is_uncompressed_img) img_offset = 20;
@@ -50,6 +76,7 @@ void new_kernel_file(kernel_file_t *kernel_file, kernel_file_t *old, int kimg_le
 {
     int prefix_len = old->kimg - old->kfile;
     int new_len = kimg_len + prefix_len;
+    memset(kernel_file, 0, sizeof(*kernel_file));
     kernel_file->kfile = (char *)malloc(new_len);
     kernel_file->kimg = kernel_file->kfile + prefix_len;
     memcpy(kernel_file->kfile, old->kfile, prefix_len);
@@ -57,16 +84,112 @@ void new_kernel_file(kernel_file_t *kernel_file, kernel_file_t *old, int kimg_le
     update_kernel_file_img_len(kernel_file, kimg_len, is_different_endian);
 }
 
+#ifndef _WIN32
+// Copy the first len bytes of the file at src to fd, in the kernel where it can
+static void copy_file_head(const char *src, int fd, int64_t len)
+{
+    int in = open(src, O_RDONLY);
+    if (in < 0) tools_log_errno_exit("open file %s\n", src);
+    int64_t done = 0;
+#ifdef __linux__
+    while (done < len) {
+        ssize_t n = copy_file_range(in, NULL, fd, NULL, len - done, 0);
+        if (n <= 0) break;
+        done += n;
+    }
+#endif
+    if (done < len) {
+        char *buf = (char *)malloc(SZ_4K * 64);
+        while (done < len) {
+            ssize_t want = len - done < SZ_4K * 64 ? len - done : SZ_4K * 64;
+            ssize_t n = pread(in, buf, want, done);
+            if (n <= 0 || pwrite(fd, buf, n, done) != n) tools_log_errno_exit("copy file %s\n", src);
+            done += n;
+        }
+        free(buf);
+    }
+    close(in);
+}
+#endif
+
+/**
+ * Create the image file at path with room for kimg_len bytes of kernel image, and map it to be patched in place.
+ * The first keep_len bytes of the image come from old_path as they are on disk, left where they are if path is
+ * old_path, so in memory changes to old must be made again. Without mmap, the image is built in memory instead and
+ * written out by write_kernel_file().
+ */
+void map_kernel_file(kernel_file_t *kernel_file, kernel_file_t *old, const char *old_path, const char *path,
+                     int32_t keep_len, int32_t kimg_len, bool is_different_endian)
+{
+#ifndef _WIN32
+    int prefix_len = old->kimg - old->kfile;
+    int32_t file_len = prefix_len + kimg_len;
+    struct stat in_st, out_st;
+    if (stat(old_path, &in_st)) tools_log_errno_exit("stat file %s\n", old_path);
+    bool in_place = !stat(path, &out_st) && in_st.st_dev == out_st.st_dev && in_st.st_ino == out_st.st_ino;
+
+    int fd = open(path, in_place ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) tools_log_errno_exit("open file %s\n", path);
+    if (!in_place) copy_file_head(old_path, fd, prefix_len + keep_len);
+    if (ftruncate(fd, file_len)) tools_log_errno_exit("truncate file %s\n", path);
+#ifdef __linux__
+    // run out of space here rather than fault on a hole later
+    int err = posix_fallocate(fd, 0, file_len);
+    if (err == ENOSPC || err == EFBIG) {
+        errno = err;
+        tools_log_errno_exit("reserve 0x%x bytes for %s\n", file_len, path);
+    }
+#endif
+
+    void *map = mmap(NULL, file_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map != MAP_FAILED) {
+        memset(kernel_file, 0, sizeof(*kernel_file));
+        kernel_file->kfile = (char *)map;
+        kernel_file->kimg = kernel_file->kfile + prefix_len;
+        kernel_file->map_len = file_len;
+        kernel_file->is_shared = true;
+        kernel_file->is_uncompressed_img = old->is_uncompressed_img;
+        update_kernel_file_img_len(kernel_file, kimg_len, is_different_endian);
+        return;
+    }
+    tools_logw("mmap %s failed, patch in memory\n", path);
+#endif
+    new_kernel_file(kernel_file, old, kimg_len, is_different_endian);
+    memcpy(kernel_file->kimg, old->kimg, keep_len);
+}
+
 void write_kernel_file(kernel_file_t *kernel_file, const char *path)
 {
+    // already in the file
+    if (kernel_file->is_shared) return;
+#ifndef _WIN32
+    // opening path truncates it, the pages of a private mapping of it would go with it
+    struct stat st;
+    if (kernel_file->map_len && !stat(path, &st) && st.st_dev == kernel_file->map_dev &&
+        st.st_ino == kernel_file->map_ino) {
+        char *copy = (char *)malloc(kernel_file->kfile_len);
+        if (!copy) tools_loge_exit("no memory for 0x%x bytes\n", kernel_file->kfile_len);
+        memcpy(copy, kernel_file->kfile, kernel_file->kfile_len);
+        write_file(path, copy, kernel_file->kfile_len, false);
+        free(copy);
+        return;
+    }
+#endif
     write_file(path, kernel_file->kfile, kernel_file->kfile_len, false);
 }
 
 void free_kernel_file(kernel_file_t *kernel_file)
 {
-    free(kernel_file->kfile);
+#ifndef _WIN32
+    if (kernel_file->map_len)
+        munmap(kernel_file->kfile, kernel_file->map_len);
+    else
+#endif
+        free(kernel_file->kfile);
     kernel_file->kfile = NULL;
     kernel_file->kimg = NULL;
+    kernel_file->map_len = 0;
 }
 
 preset_t *get_preset(const char *kimg, int kimg_len)
@@ -118,6 +241,8 @@ const char *extra_type_str(extra_item_type extra_type)
         return EXTRA_TYPE_RAW_STR;
     case EXTRA_TYPE_ANDROID_RC:
         return EXTRA_TYPE_ANDROID_RC_STR;
+    case EXTRA_TYPE_INDEX:
+        return EXTRA_TYPE_INDEX_STR;
     default:
         return EXTRA_TYPE_NONE_STR;
     }
@@ -246,7 +371,8 @@ int parse_image_patch_info(const char *kimg, int kimg_len, patched_kimg_t *pimg)
         patch_extra_item_t *item = (patch_extra_item_t *)item_pos;
         if (strcmp(EXTRA_HDR_MAGIC, item->magic)) break;
         if (item->type == EXTRA_TYPE_NONE) break;
-        pimg->embed_item[pimg->embed_item_num++] = item;
+        // rebuilt on every patch
+        if (item->type != EXTRA_TYPE_INDEX) pimg->embed_item[pimg->embed_item_num++] = item;
         item_pos += sizeof(patch_extra_item_t);
         item_pos += item->args_size;
         item_pos += item->con_size;
@@ -296,16 +422,27 @@ int print_image_patch_info(patched_kimg_t *pimg)
             fprintf(stdout, "args_size=0x%x\n", item->args_size);
             fprintf(stdout, "args=%s\n", item->args_size > 0 ? (char *)item + sizeof(*item) : "");
             fprintf(stdout, "con_size=0x%x\n", item->con_size);
+            fprintf(stdout, "compressed=%s\n", item->flags & EXTRA_FLAG_LZ4 ? "lz4" : "none");
+            if (item->flags & EXTRA_FLAG_LZ4) fprintf(stdout, "raw_size=0x%x\n", item->raw_size);
 
             if (item->type == EXTRA_TYPE_KPM) {
                 kpm_info_t kpm_info = { 0 };
-                void *kpm = (kpm_info_t *)((uintptr_t)item + sizeof(patch_extra_item_t) + item->args_size);
-                rc = get_kpm_info(kpm, item->con_size, &kpm_info);
+                char *kpm = (char *)item + sizeof(patch_extra_item_t) + item->args_size;
+                int kpm_len = item->con_size;
+                char *raw = NULL;
+                if (item->flags & EXTRA_FLAG_LZ4) {
+                    raw = (char *)malloc(item->raw_size);
+                    kpm_len = lz4_decompress(kpm, item->con_size, raw, item->raw_size);
+                    if (kpm_len != item->raw_size) tools_loge_exit("decompress kpm %s error\n", item->name);
+                    kpm = raw;
+                }
+                rc = get_kpm_info(kpm, kpm_len, &kpm_info);
                 if (rc) tools_loge_exit("get kpm infomation error: %d\n", rc);
                 fprintf(stdout, "version=%s\n", kpm_info.version);
                 fprintf(stdout, "license=%s\n", kpm_info.license);
                 fprintf(stdout, "author=%s\n", kpm_info.author);
                 fprintf(stdout, "description=%s\n", kpm_info.description);
+                free(raw);
             }
         }
     }
@@ -327,80 +464,83 @@ static int extra_compare(const void *a, const void *b)
 {
     extra_config_t *pa = (extra_config_t *)a;
     extra_config_t *pb = (extra_config_t *)b;
-    return -(pa->priority - pb->priority);
+    if (pa->item->priority != pb->item->priority) return -(pa->item->priority - pb->item->priority);
+    // stable across patches, so an update rewrites as little as possible
+    return strcmp(pa->item->name, pb->item->name);
 }
 
-static void extra_append(char *kimg, const void *data, int len, int *offset)
+typedef struct
 {
-    memcpy(kimg + *offset, data, len);
-    *offset += len;
-}
+    extra_config_t *config;
+    char *buf;
+} extra_job_t;
 
-static void disable_pi_map(char *img, int32_t imglen)
+// Compress if asked and it pays off, then digest what gets stored
+static void *extra_prepare(void *arg)
 {
-    
-    const unsigned char pattern[] = {
-        0xE6, 0x03, 0x16, 0xAA,
-        0xE7, 0x03, 0x1F, 0x2A,
-        0x34, 0x11, 0x88, 0x9A
-    };
-    const size_t pattern_len = sizeof(pattern);
-
-    const unsigned char replace[] = {
-        0xE6, 0x03, 0x16, 0xAA,
-        0xE7, 0x03, 0x1F, 0x2A,
-        0xF4, 0x03, 0x09, 0xAA
-    };
-
-    unsigned char *p = memmem(img, imglen, pattern, pattern_len);
-    if (p) {
-        memcpy(p, replace, pattern_len);
+    extra_job_t *job = (extra_job_t *)arg;
+    extra_config_t *config = job->config;
+    patch_extra_item_t *item = config->item;
+
+    if (config->compress && !(item->flags & EXTRA_FLAG_LZ4)) {
+        int raw_len = item->con_size;
+        int cap = align_ceil(LZ4_BOUND(raw_len), EXTRA_ALIGN);
+        char *buf = (char *)malloc(cap);
+        int len = buf ? lz4_compress(config->data, raw_len, buf, cap) : -1;
+        int align_len = align_ceil(len, EXTRA_ALIGN);
+        if (len > 0 && align_len < raw_len) {
+            memset(buf + len, 0, align_len - len);
+            job->buf = buf;
+            config->data = buf;
+            item->raw_size = raw_len;
+            item->con_size = align_len;
+            item->flags |= EXTRA_FLAG_LZ4;
+        } else {
+            free(buf);
+        }
     }
 
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, (const BYTE *)config->data, item->con_size);
+    sha256_final(&ctx, item->digest);
+    item->flags |= EXTRA_FLAG_SHA256;
+    return NULL;
 }
 
-int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *out_path, const char *superkey,
-                     bool root_key, const char **additional, extra_config_t *extra_configs, int extra_config_num)
+// One thread each, there are at most EXTRA_ITEM_MAX_NUM
+static void extra_prepare_all(extra_job_t *jobs, int num)
 {
-    set_log_enable(true);
-
-    if (!kpimg_path) tools_loge_exit("empty kpimg\n");
-    if (!out_path) tools_loge_exit("empty out image path\n");
-    if (!superkey) tools_loge_exit("empty superkey\n");
-
-    patched_kimg_t pimg = { 0 };
-    kernel_file_t kernel_file;
-    read_kernel_file(kimg_path, &kernel_file);
-    if (kernel_file.is_uncompressed_img) tools_logw("kernel image with UNCOMPRESSED_IMG header\n");
-
-    int rc = parse_image_patch_info(kernel_file.kimg, kernel_file.kimg_len, &pimg);
-    if (rc) tools_loge_exit("parse kernel image error\n");
-    // print_image_patch_info(&pimg);
-
-    // kimg base info
-    kernel_info_t *kinfo = &pimg.kinfo;
-    int align_kernel_size = align_ceil(kinfo->kernel_size, SZ_4K);
-
-    // kimg kallsym
-    char *kallsym_kimg = (char *)malloc(pimg.ori_kimg_len);
-    memcpy(kallsym_kimg, pimg.kimg, pimg.ori_kimg_len);
-    kallsym_t kallsym = { 0 };
-
-    if (kernel_if_need_patch(&kallsym, kallsym_kimg ,pimg.ori_kimg_len))disable_pi_map(kernel_file.kimg, kernel_file.kimg_len);
-    
-    if (analyze_kallsym_info(&kallsym, kallsym_kimg, pimg.ori_kimg_len, ARM64, 1)) {
-        tools_loge_exit("analyze_kallsym_info error\n");
+    pthread_t threads[EXTRA_ITEM_MAX_NUM];
+    bool started[EXTRA_ITEM_MAX_NUM] = { 0 };
+    for (int i = 0; i < num; i++) {
+        started[i] = !pthread_create(&threads[i], NULL, extra_prepare, &jobs[i]);
+        if (!started[i]) extra_prepare(&jobs[i]);
     }
+    for (int i = 0; i < num; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+}
 
-    // kpimg
-    char *kpimg = NULL;
-    int kpimg_len = 0;
-    read_file_align(kpimg_path, &kpimg, &kpimg_len, 0x10);
-
-    // extra
-    int extra_size = 0;
-    int extra_num = 0;
+static int extra_drop_detached(extra_config_t *configs, int num)
+{
+    int n = 0;
+    for (int i = 0; i < num; i++) {
+        if (configs[i].detach) {
+            tools_logi("detach extra item: %s\n", configs[i].name);
+            continue;
+        }
+        configs[n++] = configs[i];
+    }
+    return n;
+}
 
+/**
+ * Give each config its item header, read from path for new items, found by name among the embedded ones otherwise.
+ * Embedded headers are converted to host byte order in place.
+ */
+static void extra_resolve(extra_config_t *extra_configs, int extra_config_num, patched_kimg_t *pimg)
+{
     for (int i = 0; i < extra_config_num; i++) {
         extra_config_t *config = extra_configs + i;
         if (config->is_path && config->extra_type == EXTRA_TYPE_NONE) {
@@ -410,7 +550,7 @@ int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *
             tools_loge_exit("extra event too long: %s\n", config->set_event);
         }
         if (config->set_name && strnlen(config->set_name, EXTRA_NAME_LEN) >= EXTRA_NAME_LEN) {
-            tools_loge_exit("extra name too long: %s\n", config->set_event);
+            tools_loge_exit("extra name too long: %s\n", config->set_name);
         }
 
         patch_extra_item_t *item = NULL;
@@ -438,14 +578,16 @@ int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *
             }
         } else {
             const char *name = config->name;
-            for (int j = 0; j < pimg.embed_item_num; j++) {
-                item = pimg.embed_item[j];
-                if (strcmp(name, item->name)) continue;
-                if (is_be() ^ kinfo->is_be) {
+            for (int j = 0; j < pimg->embed_item_num; j++) {
+                if (strcmp(name, pimg->embed_item[j]->name)) continue;
+                item = pimg->embed_item[j];
+                if (is_be() ^ pimg->kinfo.is_be) {
                     item->type = i32swp(item->type);
                     item->priority = i32swp(item->priority);
                     item->con_size = i32swp(item->con_size);
                     item->args_size = i32swp(item->args_size);
+                    item->flags = i32swp(item->flags);
+                    item->raw_size = i32swp(item->raw_size);
                 }
                 if (!config->set_args && item->args_size > 0) {
                     config->set_args = (char *)item + sizeof(*item);
@@ -455,28 +597,179 @@ int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *
                 break;
             }
         }
-        if (!item) tools_loge_exit("empty extra item\n");
+        if (!item) tools_loge_exit("no extra item named %s\n", config->name);
         strcpy(item->magic, EXTRA_HDR_MAGIC);
         config->item = item;
         item->type = config->extra_type;
+        // only kpms are decompressed on load, see extra_event_load_kpm
+        if (config->compress && item->type != EXTRA_TYPE_KPM) {
+            tools_loge_exit("extra item %s: only kpm can be compressed\n", item->name);
+        }
         if (config->set_args) item->args_size = align_ceil(strlen(config->set_args), EXTRA_ALIGN);
         if (config->set_name) strcpy(item->name, config->set_name);
         if (config->set_event) strcpy(item->event, config->set_event);
         if (config->priority) item->priority = config->priority;
     }
+}
 
-    qsort(extra_configs, extra_config_num, sizeof(extra_config_t), extra_compare);
+/**
+ * Sort, compress and digest the items, then lay them out after their index and before the empty guard item.
+ * Returns the size of *out, in kernel byte order if swap.
+ */
+static int extra_build(extra_config_t *configs, int num, bool swap, char **out)
+{
+    qsort(configs, num, sizeof(extra_config_t), extra_compare);
 
-    extra_size += sizeof(patch_extra_item_t); // ending with empty item
+    extra_job_t jobs[EXTRA_ITEM_MAX_NUM] = { 0 };
+    for (int i = 0; i < num; i++) {
+        jobs[i].config = configs + i;
+    }
+    extra_prepare_all(jobs, num);
 
-    for (int i = 0; i < extra_config_num; i++) {
-        extra_config_t *config = extra_configs + i;
-        extra_num++;
-        extra_size += sizeof(patch_extra_item_t);
-        extra_size += config->item->args_size;
-        extra_size += config->item->con_size;
+    // room for every item, adding one later doesn't move the others
+    int index_len = EXTRA_ITEM_MAX_NUM * sizeof(patch_extra_index_t);
+    int size = num > 0 ? sizeof(patch_extra_item_t) + index_len : 0;
+    for (int i = 0; i < num; i++) {
+        size += sizeof(patch_extra_item_t) + configs[i].item->args_size + configs[i].item->con_size;
+    }
+    size += sizeof(patch_extra_item_t); // ending with empty item
+
+    char *extra = (char *)malloc(size);
+    if (!extra) tools_loge_exit("no memory for extra items\n");
+    memset(extra, 0, size);
+    int offset = 0;
+
+    // index of the items after it, so the kernel finds an event's items without walking them
+    if (num > 0) {
+        patch_extra_item_t *index_item = (patch_extra_item_t *)extra;
+        patch_extra_index_t *index = (patch_extra_index_t *)(index_item + 1);
+        strcpy(index_item->magic, EXTRA_HDR_MAGIC);
+        strcpy(index_item->name, EXTRA_TYPE_INDEX_STR);
+        index_item->type = EXTRA_TYPE_INDEX;
+        index_item->con_size = index_len;
+        offset = sizeof(*index_item) + index_len;
+        for (int i = 0; i < num; i++) {
+            patch_extra_item_t *item = configs[i].item;
+            index[i].offset = offset;
+            index[i].type = item->type;
+            index[i].flags = item->flags;
+            strcpy(index[i].event, item->event);
+            offset += sizeof(patch_extra_item_t) + item->args_size + item->con_size;
+            if (swap) {
+                index[i].offset = i32swp(index[i].offset);
+                index[i].type = i32swp(index[i].type);
+                index[i].flags = i32swp(index[i].flags);
+            }
+        }
+        if (swap) {
+            index_item->type = i32swp(index_item->type);
+            index_item->con_size = i32swp(index_item->con_size);
+        }
+        offset = sizeof(*index_item) + index_len;
+    }
+
+    for (int i = 0; i < num; i++) {
+        extra_config_t *config = configs + i;
+        patch_extra_item_t *item = (patch_extra_item_t *)(extra + offset);
+        memcpy(item, config->item, sizeof(*item));
+
+        const char *type = extra_type_str(item->type);
+        tools_logi("embedding %s, name: %s, priority: %d, event: %s, args: %s, size: 0x%x+0x%x+0x%x\n", type,
+                   item->name, item->priority, item->event, config->set_args ?: "", (int)sizeof(*item), item->args_size,
+                   item->con_size);
+        if (item->flags & EXTRA_FLAG_LZ4) tools_logi("    lz4 compressed from 0x%x\n", item->raw_size);
+
+        int args_len = item->args_size;
+        int con_len = item->con_size;
+
+        if (swap) {
+            item->type = i32swp(item->type);
+            item->priority = i32swp(item->priority);
+            item->con_size = i32swp(item->con_size);
+            item->args_size = i32swp(item->args_size);
+            item->flags = i32swp(item->flags);
+            item->raw_size = i32swp(item->raw_size);
+        }
+
+        offset += sizeof(*item);
+        if (args_len > 0) memcpy(extra + offset, config->set_args, strnlen(config->set_args, args_len));
+        offset += args_len;
+        memcpy(extra + offset, config->data, con_len);
+        offset += con_len;
+        free(jobs[i].buf);
+    }
+
+    *out = extra;
+    return size;
+}
+
+static void disable_pi_map(char *img, int32_t imglen)
+{
+    
+    const unsigned char pattern[] = {
+        0xE6, 0x03, 0x16, 0xAA,
+        0xE7, 0x03, 0x1F, 0x2A,
+        0x34, 0x11, 0x88, 0x9A
+    };
+    const size_t pattern_len = sizeof(pattern);
+
+    const unsigned char replace[] = {
+        0xE6, 0x03, 0x16, 0xAA,
+        0xE7, 0x03, 0x1F, 0x2A,
+        0xF4, 0x03, 0x09, 0xAA
+    };
+
+    unsigned char *p = memmem(img, imglen, pattern, pattern_len);
+    if (p) {
+        memcpy(p, replace, pattern_len);
+    }
+
+}
+
+int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *out_path, const char *superkey,
+                     bool root_key, const char **additional, extra_config_t *extra_configs, int extra_config_num)
+{
+    set_log_enable(true);
+
+    if (!kpimg_path) tools_loge_exit("empty kpimg\n");
+    if (!out_path) tools_loge_exit("empty out image path\n");
+    if (!superkey) tools_loge_exit("empty superkey\n");
+
+    patched_kimg_t pimg = { 0 };
+    kernel_file_t kernel_file;
+    read_kernel_file(kimg_path, &kernel_file);
+    if (kernel_file.is_uncompressed_img) tools_logw("kernel image with UNCOMPRESSED_IMG header\n");
+
+    int rc = parse_image_patch_info(kernel_file.kimg, kernel_file.kimg_len, &pimg);
+    if (rc) tools_loge_exit("parse kernel image error\n");
+    // print_image_patch_info(&pimg);
+
+    // kimg base info
+    kernel_info_t *kinfo = &pimg.kinfo;
+    int align_kernel_size = align_ceil(kinfo->kernel_size, SZ_4K);
+
+    // kimg kallsym
+    char *kallsym_kimg = (char *)malloc(pimg.ori_kimg_len);
+    memcpy(kallsym_kimg, pimg.kimg, pimg.ori_kimg_len);
+    kallsym_t kallsym = { 0 };
+
+    bool need_pi_patch = kernel_if_need_patch(&kallsym, kallsym_kimg, pimg.ori_kimg_len);
+
+    if (analyze_kallsym_info(&kallsym, kallsym_kimg, pimg.ori_kimg_len, ARM64, 1)) {
+        tools_loge_exit("analyze_kallsym_info error\n");
     }
 
+    // kpimg
+    char *kpimg = NULL;
+    int kpimg_len = 0;
+    read_file_align(kpimg_path, &kpimg, &kpimg_len, 0x10);
+
+    // extra
+    extra_config_num = extra_drop_detached(extra_configs, extra_config_num);
+    extra_resolve(extra_configs, extra_config_num, &pimg);
+    char *extra = NULL;
+    int extra_size = extra_build(extra_configs, extra_config_num, is_be() ^ kinfo->is_be, &extra);
+
     // copy to out image
     int ori_kimg_len = pimg.ori_kimg_len;
     int align_kimg_len = align_ceil(ori_kimg_len, SZ_4K);
@@ -491,9 +784,12 @@ int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *
     tools_logi("layout kimg: 0x0,0x%x, kpimg: 0x%x,0x%x, extra: 0x%x,0x%x, end: 0x%x, start: 0x%x\n", ori_kimg_len,
                align_kimg_len, kpimg_len, out_img_len, extra_size, out_all_len, start_offset);
 
+    // the kernel is carried over as it is on disk, only the regions patched below are written
     kernel_file_t out_kernel_file;
-    new_kernel_file(&out_kernel_file, &kernel_file, out_all_len, (bool)(is_be() ^ kinfo->is_be));
-    memcpy(out_kernel_file.kimg, pimg.kimg, ori_kimg_len);
+    map_kernel_file(&out_kernel_file, &kernel_file, kimg_path, out_path, ori_kimg_len, out_all_len,
+                    (bool)(is_be() ^ kinfo->is_be));
+    memcpy(out_kernel_file.kimg, pimg.kimg, HDR_BACKUP_SIZE);
+    if (need_pi_patch) disable_pi_map(out_kernel_file.kimg, ori_kimg_len);
     memset(out_kernel_file.kimg + ori_kimg_len, 0, align_kimg_len - ori_kimg_len);
     memcpy(out_kernel_file.kimg + align_kimg_len, kpimg, kpimg_len);
 
@@ -614,37 +910,12 @@ int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *
     }
 
     // append extra
-    int current_offset = out_img_len;
-    for (int i = 0; i < extra_config_num; i++) {
-        extra_config_t *config = extra_configs + i;
-        patch_extra_item_t *item = config->item;
-        const char *type = extra_type_str(item->type);
-        tools_logi("embedding %s, name: %s, priority: %d, event: %s, args: %s, size: 0x%x+0x%x+0x%x\n", type,
-                   item->name, item->priority, item->event, config->set_args ?: "", (int)sizeof(*item), item->args_size,
-                   item->con_size);
-
-        int args_len = item->args_size;
-        int con_len = item->con_size;
-
-        if (is_be() ^ kinfo->is_be) {
-            item->type = i32swp(item->type);
-            item->priority = i32swp(item->priority);
-            item->con_size = i32swp(item->con_size);
-            item->args_size = i32swp(item->args_size);
-        }
-
-        extra_append(out_kernel_file.kimg, (void *)item, sizeof(*item), &current_offset);
-        if (args_len > 0) extra_append(out_kernel_file.kimg, (void *)config->set_args, args_len, &current_offset);
-        extra_append(out_kernel_file.kimg, (void *)config->data, con_len, &current_offset);
-    }
-
-    // guard extra
-    patch_extra_item_t empty_item = { 0 };
-    extra_append(out_kernel_file.kimg, (void *)&empty_item, sizeof(empty_item), &current_offset);
+    memcpy(out_kernel_file.kimg + out_img_len, extra, extra_size);
 
     write_kernel_file(&out_kernel_file, out_path);
 
     // free
+    free(extra);
     free(kallsym_kimg);
     free(kpimg);
     free_kernel_file(&out_kernel_file);
@@ -656,6 +927,149 @@ int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *
     return 0;
 }
 
+// Write the runs where new differs from old, a few equal bytes apart ones in one go. Returns the bytes written.
+static int write_changed(FILE *fp, long pos, const char *old, const char *new, int len)
+{
+    int written = 0;
+    for (int i = 0; i < len;) {
+        if (old[i] == new[i]) {
+            i++;
+            continue;
+        }
+        int last = i;
+        for (int j = i + 1; j < len && j - last <= 16; j++) {
+            if (old[j] != new[j]) last = j;
+        }
+        int n = last + 1 - i;
+        if (fseek(fp, pos + i, SEEK_SET) || fwrite(new + i, 1, n, fp) != (size_t)n) tools_log_errno_exit("write error\n");
+        written += n;
+        i = last + 1;
+    }
+    return written;
+}
+
+int update_extra_img(const char *kimg_path, const char *out_path, extra_config_t *extra_configs, int extra_config_num)
+{
+    set_log_enable(true);
+    if (!kimg_path) tools_loge_exit("empty kernel image\n");
+
+    // the output starts as a copy, then gets the same in place update
+    if (out_path && strcmp(out_path, kimg_path)) {
+#ifndef _WIN32
+        struct stat st;
+        if (stat(kimg_path, &st)) tools_log_errno_exit("stat file %s\n", kimg_path);
+        int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) tools_log_errno_exit("open file %s\n", out_path);
+        copy_file_head(kimg_path, fd, st.st_size);
+        close(fd);
+#else
+        char *con = NULL;
+        int len = 0;
+        read_file(kimg_path, &con, &len);
+        write_file(out_path, con, len, false);
+        free(con);
+#endif
+        kimg_path = out_path;
+    }
+
+    patched_kimg_t pimg = { 0 };
+    kernel_file_t kernel_file;
+    read_kernel_file(kimg_path, &kernel_file);
+    int prefix_len = kernel_file.kimg - kernel_file.kfile;
+
+    int rc = parse_image_patch_info(kernel_file.kimg, kernel_file.kimg_len, &pimg);
+    if (rc) tools_loge_exit("parse kernel image error\n");
+    if (!pimg.preset) tools_loge_exit("not patched kernel image, patch it with -p first\n");
+
+    kernel_info_t *kinfo = &pimg.kinfo;
+    bool swap = is_be() ^ kinfo->is_be;
+    preset_t *preset = pimg.preset;
+    setup_preset_t *setup = &preset->setup;
+
+    int align_kimg_len = (char *)preset - kernel_file.kimg;
+    int64_t kpimg_len = swap ? i64swp(setup->kpimg_size) : setup->kpimg_size;
+    int extra_offset = align_kimg_len + (int)kpimg_len;
+    int old_extra_size = kernel_file.kimg_len - extra_offset;
+
+    // the preset and extras as they are on disk, resolving converts embedded headers in place
+    char *old_preset = (char *)malloc(sizeof(preset_t));
+    memcpy(old_preset, preset, sizeof(preset_t));
+    char *old_extra = (char *)malloc(old_extra_size);
+    memcpy(old_extra, kernel_file.kimg + extra_offset, old_extra_size);
+
+    // named items are replaced or changed, the rest stay as they are
+    extra_config_t *configs = (extra_config_t *)malloc(sizeof(extra_config_t) * EXTRA_ITEM_MAX_NUM);
+    memset(configs, 0, sizeof(extra_config_t) * EXTRA_ITEM_MAX_NUM);
+    memcpy(configs, extra_configs, sizeof(extra_config_t) * extra_config_num);
+    int num = extra_drop_detached(configs, extra_config_num);
+    extra_resolve(configs, num, &pimg);
+
+    for (int j = 0; j < pimg.embed_item_num; j++) {
+        const char *name = pimg.embed_item[j]->name;
+        bool keep = true;
+        for (int i = 0; i < extra_config_num && keep; i++) {
+            extra_config_t *config = extra_configs + i;
+            if (config->detach && !strcmp(config->name, name)) keep = false;
+        }
+        for (int i = 0; i < num && keep; i++) {
+            if (configs[i].item == pimg.embed_item[j] || !strcmp(configs[i].item->name, name)) keep = false;
+        }
+        if (!keep) continue;
+        if (num >= EXTRA_ITEM_MAX_NUM) tools_loge_exit("too many extra items\n");
+        configs[num].is_path = false;
+        configs[num].name = name;
+        extra_resolve(&configs[num], 1, &pimg);
+        num++;
+    }
+
+    char *extra = NULL;
+    int extra_size = extra_build(configs, num, swap, &extra);
+    int out_all_len = extra_offset + extra_size;
+
+    // same layout rule as patch_update_img()
+    int align_kernel_size = align_ceil(kinfo->kernel_size, SZ_4K);
+    int start_offset = align_kernel_size;
+    if (out_all_len > start_offset) start_offset = align_ceil(out_all_len, SZ_4K);
+    setup->extra_size = swap ? i64swp(extra_size) : extra_size;
+    setup->start_offset = swap ? i64swp(start_offset) : start_offset;
+    tools_logi("layout extra: 0x%x,0x%x, was 0x%x, end: 0x%x, start: 0x%x\n", extra_offset, extra_size,
+               old_extra_size, out_all_len, start_offset);
+
+    FILE *fp = fopen(kimg_path, "r+b");
+    if (!fp) tools_log_errno_exit("open file %s\n", kimg_path);
+
+    int written = write_changed(fp, prefix_len + align_kimg_len, old_preset, (char *)preset, sizeof(preset_t));
+    int common_len = extra_size < old_extra_size ? extra_size : old_extra_size;
+    written += write_changed(fp, prefix_len + extra_offset, old_extra, extra, common_len);
+    if (extra_size > old_extra_size) {
+        int n = extra_size - old_extra_size;
+        if (fseek(fp, prefix_len + extra_offset + common_len, SEEK_SET) ||
+            fwrite(extra + common_len, 1, n, fp) != (size_t)n)
+            tools_log_errno_exit("write %s\n", kimg_path);
+        written += n;
+    }
+    if (extra_size != old_extra_size) {
+        if (kernel_file.is_uncompressed_img) {
+            uint32_t len = swap ? i32swp(out_all_len) : out_all_len;
+            if (fseek(fp, 16, SEEK_SET) || fwrite(&len, 1, sizeof(len), fp) != sizeof(len))
+                tools_log_errno_exit("write %s\n", kimg_path);
+        }
+        fflush(fp);
+        if (ftruncate(fileno(fp), prefix_len + out_all_len)) tools_log_errno_exit("truncate %s\n", kimg_path);
+    }
+    fclose(fp);
+
+    tools_logi("update done: %s, 0x%x bytes written\n", kimg_path, written);
+
+    free(extra);
+    free(configs);
+    free(old_extra);
+    free(old_preset);
+    free_kernel_file(&kernel_file);
+    set_log_enable(false);
+    return 0;
+}
+
 int unpatch_img(const char *kimg_path, const char *out_path)
 {
     if (!kimg_path) tools_loge_exit("empty kernel image\n");
@@ -46,6 +46,8 @@ typedef struct
     const char *set_name;
     const char *set_event;
     int32_t priority;
+    bool compress;
+    bool detach;
     const char *data;
     patch_extra_item_t *item;
 } extra_config_t;
@@ -55,10 +57,17 @@ typedef struct
     char *kfile, *kimg;
     int32_t kfile_len, kimg_len;
     bool is_uncompressed_img;
+    // kfile is a file mapping of map_len bytes, shared ones are written in place
+    int32_t map_len;
+    bool is_shared;
+    // the mapped file, a private mapping must not be written back over itself
+    uint64_t map_dev, map_ino;
 } kernel_file_t;
 
 void read_kernel_file(const char *path, kernel_file_t *kernel_file);
 void new_kernel_file(kernel_file_t *kernel_file, kernel_file_t *old, int32_t kimg_len, bool is_different_endian);
+void map_kernel_file(kernel_file_t *kernel_file, kernel_file_t *old, const char *old_path, const char *path,
+                     int32_t keep_len, int32_t kimg_len, bool is_different_endian);
 void update_kernel_file_img_len(kernel_file_t *kernel_file, int32_t kimg_len, bool is_different_endian);
 void write_kernel_file(kernel_file_t *kernel_file, const char *path);
 void free_kernel_file(kernel_file_t *kernel_file);
@@ -70,6 +79,7 @@ int extra_str_type(const char *extra_str);
 const char *extra_type_str(extra_item_type extra_type);
 int patch_update_img(const char *kimg_path, const char *kpimg_path, const char *out_path, const char *superkey,
                      bool root_skey, const char **additional, extra_config_t *extra_configs, int extra_config_num);
+int update_extra_img(const char *kimg_path, const char *out_path, extra_config_t *extra_configs, int extra_config_num);
 int unpatch_img(const char *kimg_path, const char *out_path);
 int reset_key(const char *kimg_path, const char *out_path, const char *key);
 int dump_kallsym(const char *kimg_path);
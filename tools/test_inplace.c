@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * kptools -r and -u with -o the same file as -i, on a fake patched image.
+ * The input is mapped privately, writing it back must not truncate it under the mapping.
+ *
+ * usage: test_inplace <kptools> [dir]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "preset.h"
+
+#define KIMG_LEN 0x2000
+#define TAIL_LEN 0x100
+
+static const char header[HDR_BACKUP_SIZE] = "MZ@\0\0\0\0";
+
+static int failed = 0;
+
+#define check(cond, ...)                           \
+    do {                                           \
+        if (!(cond)) {                             \
+            fprintf(stderr, "FAIL: " __VA_ARGS__); \
+            failed++;                              \
+        }                                          \
+    } while (0)
+
+static int build_image(char **out)
+{
+    int len = KIMG_LEN + sizeof(preset_t) + TAIL_LEN;
+    char *img = (char *)calloc(1, len);
+    for (int i = 0; i < len; i++)
+        img[i] = (char)(i * 7 + 3);
+    // the patched header, the original is in the backup
+    memset(img, 0x5a, HDR_BACKUP_SIZE);
+
+    preset_t *preset = (preset_t *)(img + KIMG_LEN);
+    memset(preset, 0, sizeof(*preset));
+    memcpy(preset->header.magic, KP_MAGIC, sizeof(KP_MAGIC));
+    preset->setup.kimg_size = KIMG_LEN;
+    memcpy(preset->setup.header_backup, header, HDR_BACKUP_SIZE);
+    strcpy((char *)preset->setup.superkey, "oldkey");
+    *out = img;
+    return len;
+}
+
+static void write_all(const char *path, const char *con, int len)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp || fwrite(con, 1, len, fp) != (size_t)len) {
+        perror(path);
+        exit(2);
+    }
+    fclose(fp);
+}
+
+static int read_all(const char *path, char **con)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    int len = (int)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    *con = (char *)malloc(len + 1);
+    if (fread(*con, 1, len, fp) != (size_t)len) len = -1;
+    fclose(fp);
+    return len;
+}
+
+static int run(const char *cmd)
+{
+    int status = system(cmd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <kptools> [dir]\n", argv[0]);
+        return 2;
+    }
+    const char *dir = argc > 2 ? argv[2] : ".";
+    char path[512], cmd[1536];
+    snprintf(path, sizeof(path), "%s/test_inplace.img", dir);
+
+    char *img, *got;
+    int len = build_image(&img);
+    int key_off = KIMG_LEN + offsetof(preset_t, setup) + offsetof(setup_preset_t, superkey);
+
+    // reset key, same length, only the key changes
+    write_all(path, img, len);
+    snprintf(cmd, sizeof(cmd), "%s -r -i %s -o %s -s newkey > /dev/null", argv[1], path, path);
+    int rc = run(cmd);
+    check(rc == 0, "-r in place exited with %d\n", rc);
+    int got_len = read_all(path, &got);
+    check(got_len == len, "-r in place left 0x%x bytes, expected 0x%x\n", got_len, len);
+    if (got_len == len) {
+        check(!strcmp(got + key_off, "newkey"), "-r in place: superkey is '%s'\n", got + key_off);
+        strcpy(img + key_off, "newkey");
+        check(!memcmp(got, img, len), "-r in place changed more than the superkey\n");
+    }
+    if (got_len >= 0) free(got);
+
+    // unpatch, cut back to the kernel with its header restored
+    write_all(path, img, len);
+    snprintf(cmd, sizeof(cmd), "%s -u -i %s -o %s > /dev/null", argv[1], path, path);
+    rc = run(cmd);
+    check(rc == 0, "-u in place exited with %d\n", rc);
+    got_len = read_all(path, &got);
+    check(got_len == KIMG_LEN, "-u in place left 0x%x bytes, expected 0x%x\n", got_len, KIMG_LEN);
+    if (got_len == KIMG_LEN) {
+        memcpy(img, header, HDR_BACKUP_SIZE);
+        check(!memcmp(got, img, KIMG_LEN), "-u in place: kernel differs from the original\n");
+    }
+    if (got_len >= 0) free(got);
+
+    remove(path);
+    free(img);
+    printf("test_inplace: %s\n", failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
@@ -526,6 +526,53 @@ static inline long sc_su_get_safemode(const char *key)
     return syscall(__NR_supercall, key, ver_and_cmd(key, SUPERCALL_SU_GET_SAFEMODE));
 }
 
+/**
+ * @brief Read the KernelPatch log ring
+ *
+ * @param key : superkey
+ * @param seq : first record to read, 0 for the oldest one kept, updated to the next unread record
+ * @param buf : receives struct kp_log_entry records, each padded to 8 bytes
+ * @param buf_len
+ * @return long : bytes written, or error
+ */
+static inline long sc_klog_read(const char *key, uint64_t *seq, void *buf, int buf_len)
+{
+    if (!key || !key[0]) return -EINVAL;
+    if (!seq || !buf || buf_len <= 0) return -EINVAL;
+    long ret = syscall(__NR_supercall, key, ver_and_cmd(key, SUPERCALL_KLOG_READ), seq, buf, buf_len);
+    return ret;
+}
+
+/**
+ * @brief Set the runtime log levels
+ *
+ * @param key : superkey
+ * @param ring_level : records below are not kept in the ring
+ * @param console_level : records below are not printed to dmesg
+ * @return long : 0 if succeed
+ */
+static inline long sc_klog_level(const char *key, int ring_level, int console_level)
+{
+    if (!key || !key[0]) return -EINVAL;
+    long ret = syscall(__NR_supercall, key, ver_and_cmd(key, SUPERCALL_KLOG_LEVEL), ring_level, console_level);
+    return ret;
+}
+
+/**
+ * @brief Get how often each branch of the selinux hooks was taken
+ *
+ * @param key : superkey
+ * @param out_stats : may be NULL when only resetting
+ * @param reset : clear the counters after reading
+ * @return long : 0 if succeed
+ */
+static inline long sc_sel_stats(const char *key, struct sel_stats *out_stats, bool reset)
+{
+    if (!key || !key[0]) return -EINVAL;
+    long ret = syscall(__NR_supercall, key, ver_and_cmd(key, SUPERCALL_SEL_STATS), out_stats, reset);
+    return ret;
+}
+
 static inline long sc_bootlog(const char *key)
 {
     long ret = syscall(__NR_supercall, key, ver_and_cmd(key, SUPERCALL_BOOTLOG));